@@ -1,5 +1,7 @@
 #include <iostream>
 #include <random>
+#include "../comun/hrtimer.h"
+#include "../comun/perfcount.h"
 #define MAX 1000
 
 int get_random(int low, int high) {
@@ -11,8 +13,10 @@ int get_random(int low, int high) {
 
 int main()
 {
-    std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+    unsigned long long start, end;
     double A[MAX][MAX], x[MAX], y[MAX];
+    double duration, sum;
+    pc_counters_t pc;
 
     /*  Inicializamos A y x con valores aleatorios  */
     for (int i = 0; i < MAX; i++){
@@ -26,26 +30,47 @@ int main()
         //std::cout<<x[j]<<std::endl;
     }
 
+    /*  Los contadores de hardware muestran por qué un orden es más
+        rápido: el segundo recorre A por columnas y falla en L1d y TLB  */
+    pc_open(&pc);
+
     /*  Primer Par de loops  */    
-    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < MAX; i++) y[i] = 0.0;
+    pc_start(&pc);
+    start = hr_start();
     for (int i = 0; i < MAX; i++){
         for (int j = 0; j < MAX; j++){
-            y[i] = A[i][j]*x[j];
+            y[i] += A[i][j]*x[j];
         }
     }
-    end = std::chrono::high_resolution_clock::now();
+    end = hr_stop();
+    pc_stop(&pc);
+    sum = 0.0;
+    for (int i = 0; i < MAX; i++) sum += y[i];
+
+    duration = 1.0e-3*hr_ticks_to_ns(end - start);
+    std::cout << "\tPrimer par (i, j). Duración: " + std::to_string(duration) + " micros. Suma de y: " + std::to_string(sum) << std::endl;
+    pc_report(&pc, "primer par", stdout);
 
     /*  Segundo Par de loops  */
-    // start = std::chrono::high_resolution_clock::now();
-    // for (int j = 0; j < MAX; j++){
-    //     for (int i = 0; i < MAX; i++){
-    //         y[i] = A[i][j]*x[j];
-    //     }
-    // }
-    // end = std::chrono::high_resolution_clock::now();
-
-    long long duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "\tDuración: " + std::to_string(duration) + "micros.\n" << std::endl;
+    for (int i = 0; i < MAX; i++) y[i] = 0.0;
+    pc_start(&pc);
+    start = hr_start();
+    for (int j = 0; j < MAX; j++){
+        for (int i = 0; i < MAX; i++){
+            y[i] += A[i][j]*x[j];
+        }
+    }
+    end = hr_stop();
+    pc_stop(&pc);
+    sum = 0.0;
+    for (int i = 0; i < MAX; i++) sum += y[i];
+
+    duration = 1.0e-3*hr_ticks_to_ns(end - start);
+    std::cout << "\tSegundo par (j, i). Duración: " + std::to_string(duration) + " micros. Suma de y: " + std::to_string(sum) << std::endl;
+    pc_report(&pc, "segundo par", stdout);
+
+    pc_close(&pc);
     return 0;
 }
 
@@ -0,0 +1,304 @@
+//  Convierte matrices de CSV o Matrix Market al formato binario de
+//  matfile.h, y de ese formato a CSV o a otro dtype/layout. Los valores se
+//  escriben directamente en el archivo mapeado a medida que se leen, así
+//  que la memoria usada es una línea de la entrada aunque la matriz tenga
+//  varios GB. Compilar: g++ -O2 -Wall -o convertir convertirMatriz.cpp
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include "../comun/hrtimer.h"
+#include "../comun/matfile.h"
+
+bool ends_with(const std::string& s, const char* suffix){
+    size_t len = strlen(suffix);
+    return s.size() >= len && s.compare(s.size()-len, len, suffix) == 0;
+}
+
+bool is_separator(char c){
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Lee los valores de una línea de CSV (separados por coma, punto y coma,
+// espacios o tabuladores) y los escribe en la fila i de f. Con f == NULL
+// solo los cuenta. Devuelve cuántos valores tenía la línea, o -1 si alguno
+// no es un número
+long parse_line(char* line, mf_file_t* f, size_t i){
+    char* p = line;
+    char* end;
+    long j = 0;
+
+    while(true){
+        while(*p != '\0' && is_separator(*p)) p++;
+        if(*p == '\0') return j;
+        double x = strtod(p, &end);
+        if(end == p || (*end != '\0' && !is_separator(*end))) return -1;
+        if(f != NULL){
+            if((size_t) j >= f->header->cols) return j+1;
+            mf_set(f, i, j, x);
+        }
+        j++;
+        p = end;
+    }
+}
+
+bool blank(const char* line){
+    while(*line != '\0' && isspace((unsigned char) *line)) line++;
+    return *line == '\0' || *line == '#';
+}
+
+// Dos pasadas: la primera cuenta filas y columnas para poder crear el
+// archivo de salida, la segunda lee los valores y los escribe en él
+int csv_to_mat(const char* in, const char* out, mf_dtype_t dtype, mf_layout_t layout, size_t align){
+    FILE* fp = fopen(in, "r");
+    char* line = NULL;
+    size_t cap = 0, rows = 0, cols = 0, lineno = 0;
+    long count;
+    mf_file_t f;
+
+    if(fp == NULL){
+        fprintf(stderr, "No se pudo abrir %s\n", in);
+        return -1;
+    }
+    while(getline(&line, &cap, fp) > 0){
+        lineno++;
+        if(blank(line)) continue;
+        count = parse_line(line, NULL, 0);
+        if(count < 0 || (rows > 0 && (size_t) count != cols)){
+            fprintf(stderr, "%s:%zu: %s\n", in, lineno, count < 0 ? "valor inválido" : "número de columnas distinto");
+            free(line);
+            fclose(fp);
+            return -1;
+        }
+        cols = count;
+        rows++;
+    }
+    if(mf_create(&f, out, rows, cols, dtype, layout, align) != 0){
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+    rewind(fp);
+    rows = 0;
+    while(getline(&line, &cap, fp) > 0){
+        if(!blank(line)) parse_line(line, &f, rows++);
+    }
+    free(line);
+    fclose(fp);
+    mf_report(&f, out, stdout);
+    mf_close(&f);
+    return 0;
+}
+
+// Matrix Market: "%%MatrixMarket matrix coordinate|array real|integer|pattern
+// general|symmetric|skew-symmetric", comentarios con %, la línea de tamaño
+// y los valores. En array van por columnas y, si es simétrica, solo el
+// triángulo inferior; en coordinate son "i j valor" con índices desde 1.
+// Lo que no está en coordinate queda en cero (ver nota 3 de matfile.h)
+int mtx_to_mat(const char* in, const char* out, mf_dtype_t dtype, mf_layout_t layout, size_t align){
+    FILE* fp = fopen(in, "r");
+    char* line = NULL;
+    char object[64], format[64], field[64], symmetry[64];
+    size_t cap = 0, lineno = 1, rows, cols, entries = 0, read = 0;
+    int fields;
+    mf_file_t f;
+    bool ok = true;
+
+    if(fp == NULL){
+        fprintf(stderr, "No se pudo abrir %s\n", in);
+        return -1;
+    }
+    if(getline(&line, &cap, fp) <= 0 ||
+            sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4){
+        fprintf(stderr, "%s: falta la línea %%%%MatrixMarket\n", in);
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+    for(char* s : { object, format, field, symmetry })
+        for(; *s != '\0'; s++) *s = tolower((unsigned char) *s);
+    bool coordinate = strcmp(format, "coordinate") == 0;
+    bool pattern = strcmp(field, "pattern") == 0;
+    bool symmetric = strcmp(symmetry, "symmetric") == 0 || strcmp(symmetry, "hermitian") == 0;
+    bool skew = strcmp(symmetry, "skew-symmetric") == 0;
+    if(strcmp(object, "matrix") != 0 || (!coordinate && strcmp(format, "array") != 0) ||
+            (strcmp(field, "real") != 0 && strcmp(field, "integer") != 0 && strcmp(field, "double") != 0 && !pattern) ||
+            (!symmetric && !skew && strcmp(symmetry, "general") != 0) || (pattern && !coordinate)){
+        fprintf(stderr, "%s: matrix %s %s %s no está soportado\n", in, format, field, symmetry);
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+    do{
+        lineno++;
+        if(getline(&line, &cap, fp) <= 0){
+            fprintf(stderr, "%s: falta la línea de tamaño\n", in);
+            free(line);
+            fclose(fp);
+            return -1;
+        }
+    } while(line[0] == '%' || blank(line));
+    fields = sscanf(line, "%zu %zu %zu", &rows, &cols, &entries);
+    if(fields < 2 || (coordinate && fields < 3) || ((symmetric || skew) && rows != cols)){
+        fprintf(stderr, "%s:%zu: línea de tamaño inválida\n", in, lineno);
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+    if(!coordinate){
+        // Los elementos que trae el archivo, por columnas
+        entries = symmetric ? cols*(cols+1)/2 : skew ? cols*(cols-1)/2 : rows*cols;
+    }
+    if(mf_create(&f, out, rows, cols, dtype, layout, align) != 0){
+        free(line);
+        fclose(fp);
+        return -1;
+    }
+
+    size_t i = skew ? 1 : 0, j = 0;
+    while(ok && read < entries && getline(&line, &cap, fp) > 0){
+        lineno++;
+        if(line[0] == '%' || blank(line)) continue;
+        char* p = line;
+        char* end;
+        double x = 1.0;
+        if(coordinate){
+            i = strtoull(p, &end, 10) - 1;
+            ok = end != p;
+            p = end;
+            j = strtoull(p, &end, 10) - 1;
+            ok = ok && end != p && i < rows && j < cols && (!(symmetric || skew) || i >= j);
+            p = end;
+        }
+        if(ok && !pattern){
+            x = strtod(p, &end);
+            ok = end != p;
+        }
+        if(!ok) break;
+        mf_set(&f, i, j, x);
+        if((symmetric || skew) && i != j) mf_set(&f, j, i, skew ? -x : x);
+        read++;
+        if(!coordinate && ++i == rows){
+            // Siguiente columna; si es simétrica empieza en la diagonal
+            j++;
+            i = symmetric ? j : skew ? j+1 : 0;
+        }
+    }
+    free(line);
+    fclose(fp);
+    if(!ok || read < entries){
+        fprintf(stderr, "%s:%zu: %s\n", in, lineno, ok ? "faltan valores" : "valor inválido");
+        mf_close(&f);
+        unlink(out);
+        return -1;
+    }
+    mf_report(&f, out, stdout);
+    mf_close(&f);
+    return 0;
+}
+
+// De binario a binario (cambiando dtype, layout o alineamiento) o a CSV.
+// La entrada se recorre en el orden en que está guardada. La salida se
+// escribe en out.tmp y se renombra al final: si out es la entrada (el mismo
+// nombre, un enlace o un symlink), mf_create la truncaría antes de leerla
+int mat_to_other(const char* in, const char* out, bool csv, mf_dtype_t dtype, mf_layout_t layout, size_t align){
+    mf_file_t f, g;
+    std::string tmp = std::string(out) + ".tmp";
+
+    if(mf_open(&f, in, 0) != 0) return -1;
+    mf_advise(&f, MADV_SEQUENTIAL);
+    size_t rows = f.header->rows, cols = f.header->cols;
+    if(csv){
+        FILE* fp = fopen(tmp.c_str(), "w");
+        if(fp == NULL){
+            fprintf(stderr, "No se pudo crear %s\n", tmp.c_str());
+            mf_close(&f);
+            return -1;
+        }
+        for(size_t i=0; i<rows; i++){
+            for(size_t j=0; j<cols; j++){
+                fprintf(fp, j+1 < cols ? "%.17g," : "%.17g\n", mf_get(&f, i, j));
+            }
+        }
+        mf_close(&f);
+        if(fclose(fp) != 0 || rename(tmp.c_str(), out) != 0){
+            fprintf(stderr, "No se pudo escribir %s\n", out);
+            unlink(tmp.c_str());
+            return -1;
+        }
+        return 0;
+    }
+    if(mf_create(&g, tmp.c_str(), rows, cols, dtype, layout, align) != 0){
+        mf_close(&f);
+        return -1;
+    }
+    if(f.header->layout == MF_ROW){
+        for(size_t i=0; i<rows; i++)
+            for(size_t j=0; j<cols; j++) mf_set(&g, i, j, mf_get(&f, i, j));
+    }
+    else{
+        for(size_t j=0; j<cols; j++)
+            for(size_t i=0; i<rows; i++) mf_set(&g, i, j, mf_get(&f, i, j));
+    }
+    mf_close(&f);
+    mf_report(&g, out, stdout);
+    mf_close(&g);
+    if(rename(tmp.c_str(), out) != 0){
+        fprintf(stderr, "No se pudo renombrar %s a %s\n", tmp.c_str(), out);
+        unlink(tmp.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+// Uso: ./convertir entrada [salida] [-t f64|f32|i32|i64] [-l row|col] [-a alineación]
+// El formato sale de la extensión: la entrada puede ser .csv, .mtx o .mat
+// y la salida .mat o .csv (solo desde .mat). Sin salida se imprime la
+// cabecera de un .mat. Por defecto f64, row y alineamiento de 4096, que
+// es lo que multiplicacionBloques.cpp usa sin copiar.
+int main(int argc, char* argv[])
+{
+    mf_dtype_t dtype = MF_F64;
+    mf_layout_t layout = MF_ROW;
+    size_t align = MF_DEFAULT_ALIGN;
+    std::string in, out;
+    int result;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        std::string s = argv[arg];
+        if (s == "-t" && arg+1 < argc && mf_parse_dtype(argv[arg+1], &dtype)) arg++;
+        else if (s == "-l" && arg+1 < argc && mf_parse_layout(argv[arg+1], &layout)) arg++;
+        else if (s == "-a" && arg+1 < argc && atol(argv[arg+1]) > 0) align = atol(argv[++arg]);
+        else if (s[0] != '-' && in.empty()) in = s;
+        else if (s[0] != '-' && out.empty()) out = s;
+        else in.clear(), arg = argc;
+    }
+    bool valid = ends_with(in, ".mat") ? out.empty() || ends_with(out, ".mat") || ends_with(out, ".csv")
+               : (ends_with(in, ".csv") || ends_with(in, ".mtx")) && ends_with(out, ".mat");
+    if (!valid)
+    {
+        std::cout<<"Uso: "<<argv[0]<<" entrada.{csv,mtx,mat} [salida.{mat,csv}] [-t f64|f32|i32|i64] [-l row|col] [-a alineación]"<<std::endl;
+        exit(1);
+    }
+    if (out.empty())
+    {
+        mf_file_t f;
+        if (mf_open(&f, in.c_str(), 0) != 0) exit(1);
+        mf_report(&f, in.c_str(), stdout);
+        mf_close(&f);
+        return 0;
+    }
+
+    double start = hr_now();
+    if (ends_with(in, ".csv")) result = csv_to_mat(in.c_str(), out.c_str(), dtype, layout, align);
+    else if (ends_with(in, ".mtx")) result = mtx_to_mat(in.c_str(), out.c_str(), dtype, layout, align);
+    else result = mat_to_other(in.c_str(), out.c_str(), ends_with(out, ".csv"), dtype, layout, align);
+    double end = hr_now();
+    if (result != 0) exit(1);
+    std::cout << "\tConvertido en " + std::to_string(1.0e3*(end - start)) + " milliseconds." << std::endl;
+    return 0;
+}
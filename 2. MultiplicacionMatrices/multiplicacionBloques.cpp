@@ -6,6 +6,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../comun/hrtimer.h"
+#include "../comun/perfcount.h"
+#include "../comun/matalloc.h"
+#include "../comun/matfile.h"
 
 int get_random(int low, int high) {
   std::random_device rd;
@@ -23,17 +30,21 @@ void print_matrix(double** Matrix, int fila, int columna){
     }
 }
  
-void block_multiplication(int n, double** a, double** b, double** c){
+// Los bloques del borde se recortan cuando n no es múltiplo de blockSize
+void block_multiplication(int n, int blockSize, double** a, double** b, double** c){
+    HR_SCOPE("block_multiplication");
     int bi, bj, bk, i, j, k;
     bi = bj = bk = i =  j = k = 0;
-    int blockSize=10; 
     
     for(bi=0; bi<n; bi+=blockSize){
+        int iEnd = std::min(blockSize, n-bi);
         for(bj=0; bj<n; bj+=blockSize){
+            int jEnd = std::min(blockSize, n-bj);
             for(bk=0; bk<n; bk+=blockSize){
-                for(i=0; i<blockSize; i++){
-                    for(j=0; j<blockSize; j++){
-                        for(k=0; k<blockSize; k++){
+                int kEnd = std::min(blockSize, n-bk);
+                for(i=0; i<iEnd; i++){
+                    for(j=0; j<jEnd; j++){
+                        for(k=0; k<kEnd; k++){
                             c[bi+i][bj+j] += a[bi+i][bk+k]*b[bk+k][bj+j];
                         }
                     }
@@ -43,90 +54,188 @@ void block_multiplication(int n, double** a, double** b, double** c){
     }
 }
  
-int main(void)
+// Matriz de n x n: sus filas apuntan a la zona de datos de file si es f64
+// por filas (sin copiar nada), o a una reserva de matalloc.h con los
+// valores convertidos si el archivo usa otro dtype o layout
+double** load_matrix(mf_file_t* file, ma_block_t* block, ma_pages_t pages, ma_numa_t numa){
+    HR_SCOPE("load_matrix");
+    size_t n = file->header->rows;
+    double** M = (double **)malloc(n*sizeof(double *));
+    if(!M)
+    {
+        printf("memory failed \n");
+        exit(1);
+    }
+    if(file->header->dtype == MF_F64 && file->header->layout == MF_ROW)
+    {
+        mf_advise(file, MADV_WILLNEED);
+        M[0] = (double *)file->data;
+        block->ptr = NULL;
+    }
+    else
+    {
+        M[0] = (double *)ma_alloc(block, n*n*sizeof(double), pages, numa);
+        for(size_t i=0; i<n; i++)
+            for(size_t j=0; j<n; j++) M[0][i*n+j] = mf_get(file, i, j);
+    }
+    for(size_t i=1; i<n; i++) M[i] = M[0]+i*n;
+    return M;
+}
+
+// Uso: ./ejecutable [n] [tamaño de bloque ...] [-p 4k|thp|2m|1g] [-N none|local|interleave]
+//                   [-i A.mat B.mat] [-o C.mat]
+// Sin n se pide por teclado; sin tamaños se usa un bloque de 10. Con
+// varios tamaños se multiplica una vez con cada uno y se imprimen el
+// tiempo y los contadores de hardware (perfcount.h) de cada multiplicación.
+// -p y -N eligen el tamaño de página y la ubicación NUMA de las matrices
+// (matalloc.h); por defecto 4k y none.
+// -i lee A y B de archivos binarios (matfile.h; convertirMatriz.cpp los
+// genera desde CSV o Matrix Market) en lugar de generarlas al azar; n sale
+// de los archivos y todos los números son tamaños de bloque. -o escribe C
+// en un archivo binario f64 por filas: la multiplicación escribe
+// directamente en el archivo mapeado.
+// Al final hr_report imprime los contadores HR_SCOPE (hrtimer.h): cuántas
+// veces se llamó a block_multiplication y load_matrix y cuánto tardaron.
+int main(int argc, char* argv[])
 {
-    std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
-    int n;
+    double start, end;
+    int n = 0;
     double** A;
     double** B;
     double** C;
     int i=0;
     int j=0;
-    std::cout<<"Ingrese la dimensión de Matriz (n): "; std::cin>>n;
-    // Asignar memoria para las matrices
-     
-    ///////////////////// Matrix A //////////////////////////
-     
-    A =(double **)malloc(n*sizeof(double *));
-    A[0] = (double *)malloc(n*n*sizeof(double));
-    if(!A)
+    pc_counters_t pc;
+    ma_block_t blockA, blockB, blockC;
+    ma_pages_t pages = MA_4K;
+    ma_numa_t numa = MA_NUMA_NONE;
+    std::vector<int> numbers, blockSizes;
+    const char* fileNames[3] = { NULL, NULL, NULL };
+    mf_file_t fileA, fileB, fileC;
+
+    for (int arg = 1; arg < argc; arg++)
     {
-        printf("memory failed \n");
-        exit(1);
+        if (std::string(argv[arg]) == "-p" && arg+1 < argc && ma_parse_pages(argv[arg+1], &pages)) arg++;
+        else if (std::string(argv[arg]) == "-N" && arg+1 < argc && ma_parse_numa(argv[arg+1], &numa)) arg++;
+        else if (std::string(argv[arg]) == "-i" && arg+2 < argc) { fileNames[0] = argv[arg+1]; fileNames[1] = argv[arg+2]; arg += 2; }
+        else if (std::string(argv[arg]) == "-o" && arg+1 < argc) fileNames[2] = argv[++arg];
+        else if (atoi(argv[arg]) > 0) numbers.push_back(atoi(argv[arg]));
+        else
+        {
+            std::cout<<"Uso: "<<argv[0]<<" [n] [tamaño de bloque ...] [-p 4k|thp|2m|1g] [-N none|local|interleave] [-i A.mat B.mat] [-o C.mat]"<<std::endl;
+            exit(1);
+        }
     }
-    for(i=1; i<n; i++)
+    if (fileNames[0] != NULL)
     {
-        A[i] = A[0]+i*n;
-        if (!A[i])
+        if (mf_open(&fileA, fileNames[0], 0) != 0 || mf_open(&fileB, fileNames[1], 0) != 0) exit(1);
+        n = fileA.header->rows;
+        if (fileA.header->cols != (uint64_t) n || fileB.header->rows != (uint64_t) n || fileB.header->cols != (uint64_t) n)
         {
-            printf("memory failed \n");
+            std::cout<<"A y B tienen que ser cuadradas y del mismo tamaño"<<std::endl;
             exit(1);
         }
+        blockSizes = numbers;
     }
- 
-    ///////////////////// Matrix B //////////////////////////
-    B =(double **)malloc(n*sizeof(double *));
-    B[0] = (double *)malloc(n*n*sizeof(double));
-    if(!B)
+    else if (!numbers.empty())
     {
-        printf("memory failed \n");
-        exit(1);
+        n = numbers[0];
+        blockSizes.assign(numbers.begin()+1, numbers.end());
     }
-    for(i=1; i<n; i++)
+    else { std::cout<<"Ingrese la dimensión de Matriz (n): "; std::cin>>n; }
+    if (blockSizes.empty()) blockSizes.push_back(10);
+    // Asignar memoria para las matrices
+     
+    if (fileNames[0] != NULL)
+    {
+        A = load_matrix(&fileA, &blockA, pages, numa);
+        B = load_matrix(&fileB, &blockB, pages, numa);
+    }
+    else
     {
-        B[i] = B[0]+i*n;
-        if (!B[i])
+        ///////////////////// Matrix A //////////////////////////
+        A =(double **)malloc(n*sizeof(double *));
+        if(!A)
+        {
+            printf("memory failed \n");
+            exit(1);
+        }
+        A[0] = (double *)ma_alloc(&blockA, (size_t) n*n*sizeof(double), pages, numa);
+        for(i=1; i<n; i++)
+        {
+            A[i] = A[0]+(size_t) i*n;
+        }
+
+        ///////////////////// Matrix B //////////////////////////
+        B =(double **)malloc(n*sizeof(double *));
+        if(!B)
         {
             printf("memory failed \n");
             exit(1);
         }
+        B[0] = (double *)ma_alloc(&blockB, (size_t) n*n*sizeof(double), pages, numa);
+        for(i=1; i<n; i++)
+        {
+            B[i] = B[0]+(size_t) i*n;
+        }
+
+        // Inicializamos la matriz A y B
+        for(i=0; i<n; i++)
+        {
+            for(j=0; j<n; j++)
+            {
+                A[i][j] = get_random(1, 100);
+                B[i][j] = get_random(1, 100);
+            }
+        }
     }
  
     ///////////////////// Matrix C //////////////////////////
     C =(double **)malloc(n*sizeof(double *));
-    C[0] = (double *)malloc(n*n*sizeof(double));
     if(!C)
     {
         printf("memory failed \n");
         exit(1);
     }
-    for(i=1; i<n; i++)
+    if (fileNames[2] != NULL)
     {
-        C[i] = C[0]+i*n;
-        if (!C[i])
-        {
-            printf("memory failed \n");
-            exit(1);
-        }
+        if (mf_create(&fileC, fileNames[2], n, n, MF_F64, MF_ROW, MF_DEFAULT_ALIGN) != 0) exit(1);
+        C[0] = (double *)fileC.data;
+        blockC.ptr = NULL;
     }
- 
-    // Inicializamos la matriz A y B
-    for(i=0; i<n; i++)
+    else C[0] = (double *)ma_alloc(&blockC, (size_t) n*n*sizeof(double), pages, numa);
+    for(i=1; i<n; i++)
     {
-        for(j=0; j<n; j++)
-        {
-            A[i][j] = get_random(1, 100);
-            B[i][j] = get_random(1, 100);
-        }
+        C[i] = C[0]+(size_t) i*n;
     }
  
     /*  
         Multiplicación principal 
         
     */
-    start = std::chrono::high_resolution_clock::now();
-    block_multiplication(n,A,B,C);
-    end = std::chrono::high_resolution_clock::now();
+    pc_open(&pc);
+    for (int blockSize : blockSizes)
+    {
+        std::fill(C[0], C[0]+(size_t) n*n, 0.0);
+
+        pc_start(&pc);
+        start = hr_now();
+        block_multiplication(n,blockSize,A,B,C);
+        end = hr_now();
+        pc_stop(&pc);
+
+        double duration = 1.0e3*(end - start);
+        std::cout << "\tBloque " + std::to_string(blockSize) + ". Tiempo: " + std::to_string(duration) + " milliseconds." << std::endl;
+        pc_report(&pc, ("bloque " + std::to_string(blockSize)).c_str(), stdout);
+    }
+    pc_close(&pc);
+    hr_report(stdout);
+    if (fileNames[0] != NULL) mf_report(&fileA, fileNames[0], stdout);
+    if (fileNames[0] != NULL) mf_report(&fileB, fileNames[1], stdout);
+    if (fileNames[2] != NULL) mf_report(&fileC, fileNames[2], stdout);
+    if (blockA.ptr != NULL) ma_report(&blockA, "A", stdout);
+    if (blockB.ptr != NULL) ma_report(&blockB, "B", stdout);
+    if (blockC.ptr != NULL) ma_report(&blockC, "C", stdout);
 
     /*  Imprimimos las matrices A, B y C  */
     // std::cout<<"\tMatriz A"<<std::endl;
@@ -137,14 +246,13 @@ int main(void)
     // print_matrix(C, n, n);
      
     // Desasignar memoria para las matrices
-    free(A[0]);
+    ma_free(&blockA);
     free(A);
-    free(B[0]);
+    ma_free(&blockB);
     free(B);
-    free(C[0]);
+    ma_free(&blockC);
     free(C);
-
-    long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    std::cout << "\tTiempo: " + std::to_string(duration) + " milliseconds.\n" << std::endl;
+    if (fileNames[0] != NULL) { mf_close(&fileA); mf_close(&fileB); }
+    if (fileNames[2] != NULL) mf_close(&fileC);
     return 0;
 }
\ No newline at end of file
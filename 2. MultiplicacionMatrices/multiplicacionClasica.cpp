@@ -6,6 +6,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include "../comun/hrtimer.h"
+#include "../comun/perfcount.h"
 
 int get_random(int low, int high) {
   std::random_device rd;
@@ -35,7 +37,8 @@ void simple_multiplication(int k, int m, int n, double** A, double** B, double**
  
 int main()
 {
-    std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+    double start, end;
+    pc_counters_t pc;
     int n;
     double** A;
     double** B;
@@ -113,9 +116,12 @@ int main()
         Multiplicación principal 
         C[i][j] = A[i][0] * B[0][j] + A[i][1] * B[1][j] + A[i][2] * B[2][j] + ... + A[i][m-1] * B[m-1][j] 
     */
-    start = std::chrono::high_resolution_clock::now();
+    pc_open(&pc);
+    pc_start(&pc);
+    start = hr_now();
     simple_multiplication(n,n,n,A,B,C);
-    end = std::chrono::high_resolution_clock::now();
+    end = hr_now();
+    pc_stop(&pc);
 
     /*  Imprimimos las matrices A, B y C  */
     // std::cout<<"\tMatriz A"<<std::endl;
@@ -133,7 +139,9 @@ int main()
     free(C[0]);
     free(C);
 
-    long long duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    double duration = 1.0e3*(end - start);
     std::cout << "\tTiempo: " + std::to_string(duration) + " milliseconds.\n" << std::endl;
+    pc_report(&pc, "simple_multiplication", stdout);
+    pc_close(&pc);
     return 0;
 }
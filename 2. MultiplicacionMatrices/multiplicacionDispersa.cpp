@@ -0,0 +1,239 @@
+//  Matrices dispersas (sparse.h) contra las densas: para varias densidades
+//  se convierte A a CSR, CSC y BCSR y se mide A*x (como el primer par de
+//  loops de pair-of-loops.cpp) y A*X con X de n x k, en paralelo con robo
+//  de trabajo. Compilar: g++ -O2 -Wall -o ejecutable multiplicacionDispersa.cpp -lpthread
+
+#include <iostream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "../comun/hrtimer.h"
+#include "../comun/worksteal.h"
+#include "../comun/sparse.h"
+
+#define GRAIN 32768    // Multiplicaciones por tarea, más o menos
+#define MAX_REPS 1000  // Con n chico cada ws_run cuesta más que el kernel
+
+// Ejecuta body(first, last, arg) sobre [first, last) partiendo el rango
+// en dos mientras tenga más de GRAIN multiplicaciones. Si cost no es NULL,
+// cost[last] - cost[first] es el trabajo del rango (el ptr de CSR, CSC o
+// BCSR, así una fila con muchos elementos no queda en una sola tarea con
+// otras mil); si es NULL, cada índice cuesta unit
+struct range_task {
+    long first, last;
+    const long* cost;
+    long unit;
+    void (*body)(long first, long last, void* arg);
+    void* arg;
+};
+
+void parallel_range(void* arg){
+    range_task* t = (range_task*) arg;
+    long work = t->cost ? (t->cost[t->last] - t->cost[t->first])*t->unit : (t->last - t->first)*t->unit;
+    ws_task_t task;
+
+    if(t->last - t->first > 1 && work > GRAIN){
+        range_task top = *t, bottom = *t;
+        top.last = bottom.first = t->first + (t->last - t->first)/2;
+        ws_spawn(&task, parallel_range, &top);
+        parallel_range(&bottom);
+        ws_sync(&task);
+        return;
+    }
+    t->body(t->first, t->last, t->arg);
+}
+
+// Todo lo que usan los kernels; cada uno recibe un rango
+struct problem {
+    long n, k;
+    const double* a;       // Densa, n x n por filas
+    const double* x;       // n
+    const double* X;       // n x k por filas
+    double* y;
+    double* Y;
+    sp_csr_t csr;
+    sp_csc_t csc;
+    sp_bcsr_t bcsr;
+    std::vector<double*> partial;   // Un y por worker para CSC
+};
+
+void dense_mv(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    for(long i=first; i<last; i++){
+        double sum = 0.0;
+        for(long j=0; j<p->n; j++){
+            sum += p->a[i*p->n+j]*p->x[j];
+        }
+        p->y[i] = sum;
+    }
+}
+
+void csr_mv(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    sp_csr_spmv(&p->csr, p->x, p->y, first, last);
+}
+
+void csc_mv(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    sp_csc_spmv(&p->csc, p->x, p->partial[ws_self->id], first, last);
+}
+
+// Suma los y de cada worker de CSC en y, por filas
+void csc_reduce(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    for(long i=first; i<last; i++){
+        double sum = 0.0;
+        for(double* partial : p->partial) sum += partial[i];
+        p->y[i] = sum;
+    }
+}
+
+void bcsr_mv(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    sp_bcsr_spmv(&p->bcsr, p->x, p->y, first, last);
+}
+
+// Y = A*X con el orden (i, z, j) de simple_multiplication cambiado para
+// que el loop interno recorra una fila de X y una de Y seguidas, igual
+// que sp_csr_spmm: así la diferencia es solo saltearse los ceros
+void dense_mm(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    long k = p->k;
+    for(long i=first; i<last; i++){
+        double* yrow = p->Y + i*k;
+        std::fill(yrow, yrow+k, 0.0);
+        for(long z=0; z<p->n; z++){
+            double v = p->a[i*p->n+z];
+            const double* xrow = p->X + z*k;
+            for(long j=0; j<k; j++) yrow[j] += v*xrow[j];
+        }
+    }
+}
+
+void csr_mm(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    sp_csr_spmm(&p->csr, p->X, p->k, p->Y, p->k, p->k, first, last);
+}
+
+void bcsr_mm(long first, long last, void* arg){
+    problem* p = (problem*) arg;
+    sp_bcsr_spmm(&p->bcsr, p->X, p->k, p->Y, p->k, p->k, first, last);
+}
+
+// Ejecuta el kernel reps veces en paralelo y devuelve los ms por vez
+double timed(ws_sched_t* sched, int reps, range_task root){
+    double start = hr_now();
+    for(int r=0; r<reps; r++){
+        range_task t = root;
+        ws_run(sched, parallel_range, &t);
+    }
+    return 1.0e3*(hr_now() - start)/reps;
+}
+
+double max_diff(const double* a, const double* b, long count){
+    double diff = 0.0;
+    for(long i=0; i<count; i++) diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+
+// Uso: ./ejecutable [n] [workers] [k] [bloque BCSR] [densidad ...]
+// Por defecto n = 2000, un worker por CPU, k = 16 columnas en X, bloques
+// de 4 x 4 y densidades 0.001 0.01 0.05 0.1 0.25 0.5. Para cada densidad
+// se imprime: elementos distintos de cero, relleno de BCSR (valores
+// guardados / distintos de cero), ms por multiplicación de cada kernel y
+// la diferencia máxima de los dispersos con los densos.
+int main(int argc, char* argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 2000;
+    int workers = argc > 2 ? atoi(argv[2]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    long k = argc > 3 ? atol(argv[3]) : 16;
+    int block = argc > 4 ? atoi(argv[4]) : 4;
+    std::vector<double> densities;
+    ws_sched_t sched;
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<> value(1, 100);
+    std::uniform_real_distribution<> coin(0.0, 1.0);
+
+    for (int arg = 5; arg < argc; arg++) densities.push_back(atof(argv[arg]));
+    if (densities.empty()) densities = { 0.001, 0.01, 0.05, 0.1, 0.25, 0.5 };
+    if (n <= 0 || workers <= 0 || k <= 0 || block <= 0 || block > SP_MAX_BLOCK)
+    {
+        std::cout<<"Uso: "<<argv[0]<<" [n] [workers] [k] [bloque BCSR <= "<<SP_MAX_BLOCK<<"] [densidad ...]"<<std::endl;
+        exit(1);
+    }
+    ws_init(&sched, workers, NULL);
+
+    std::vector<double> a(n*n), x(n), X(n*k), y(n), Y(n*k), yDense(n), YDense(n*k);
+    for (long j = 0; j < n; j++) x[j] = value(gen);
+    for (long i = 0; i < n*k; i++) X[i] = value(gen);
+
+    problem p;
+    p.n = n;
+    p.k = k;
+    p.a = a.data();
+    p.x = x.data();
+    p.X = X.data();
+    for (int w = 0; w < workers; w++) p.partial.push_back(new double[n]);
+
+    printf("n = %ld, %d workers, X de %ld columnas, bloques de %d x %d; ms por multiplicación\n",
+            n, workers, k, block, block);
+    printf("%9s %10s %7s | %9s %9s %9s %9s | %9s %9s %9s | %9s\n", "densidad", "nnz", "relleno",
+            "mv densa", "mv csr", "mv csc", "mv bcsr", "mm densa", "mm csr", "mm bcsr", "dif máx");
+    for (double density : densities)
+    {
+        for (long i = 0; i < n*n; i++) a[i] = coin(gen) < density ? value(gen) : 0.0;
+        sp_csr_from_dense(&p.csr, p.a, n, n, n);
+        sp_csc_from_dense(&p.csc, p.a, n, n, n);
+        sp_bcsr_from_dense(&p.bcsr, p.a, n, n, n, block, block);
+        // Tantas repeticiones como hagan falta para unas 2*10^8 multiplicaciones
+        // densas, hasta MAX_REPS
+        int reps = std::min((long) MAX_REPS, std::max(1L, 200000000L/(n*n)));
+        int repsMM = std::min((long) MAX_REPS, std::max(1L, 200000000L/(n*n*k)));
+        double diff = 0.0;
+
+        p.y = yDense.data();
+        double mvDense = timed(&sched, reps, { 0, n, NULL, n, dense_mv, &p });
+        p.y = y.data();
+        double mvCSR = timed(&sched, reps, { 0, n, p.csr.ptr, 1, csr_mv, &p });
+        diff = std::max(diff, max_diff(y.data(), yDense.data(), n));
+
+        double start = hr_now();
+        for (int r = 0; r < reps; r++)
+        {
+            for (double* partial : p.partial) std::fill(partial, partial+n, 0.0);
+            range_task mv = { 0, n, p.csc.ptr, 1, csc_mv, &p };
+            ws_run(&sched, parallel_range, &mv);
+            range_task reduce = { 0, n, NULL, workers, csc_reduce, &p };
+            ws_run(&sched, parallel_range, &reduce);
+        }
+        double mvCSC = 1.0e3*(hr_now() - start)/reps;
+        diff = std::max(diff, max_diff(y.data(), yDense.data(), n));
+
+        double mvBCSR = timed(&sched, reps, { 0, p.bcsr.brows, p.bcsr.ptr, (long) block*block, bcsr_mv, &p });
+        diff = std::max(diff, max_diff(y.data(), yDense.data(), n));
+
+        p.Y = YDense.data();
+        double mmDense = timed(&sched, repsMM, { 0, n, NULL, n*k, dense_mm, &p });
+        p.Y = Y.data();
+        double mmCSR = timed(&sched, repsMM, { 0, n, p.csr.ptr, k, csr_mm, &p });
+        diff = std::max(diff, max_diff(Y.data(), YDense.data(), n*k));
+        double mmBCSR = timed(&sched, repsMM, { 0, p.bcsr.brows, p.bcsr.ptr, (long) block*block*k, bcsr_mm, &p });
+        diff = std::max(diff, max_diff(Y.data(), YDense.data(), n*k));
+
+        printf("%9.4f %10ld %7.2f | %9.3f %9.3f %9.3f %9.3f | %9.3f %9.3f %9.3f | %9.2g\n",
+                density, p.csr.nnz, sp_bcsr_fill(&p.bcsr), mvDense, mvCSR, mvCSC, mvBCSR,
+                mmDense, mmCSR, mmBCSR, diff);
+        sp_csr_free(&p.csr);
+        sp_csc_free(&p.csc);
+        sp_bcsr_free(&p.bcsr);
+    }
+
+    for (double* partial : p.partial) delete[] partial;
+    ws_destroy(&sched);
+    return 0;
+}
@@ -0,0 +1,346 @@
+//  Multiplicación por bloques fuera de memoria: A, B y C están en archivos
+//  binarios (matfile.h) y solo hay en memoria unos pocos tiles de T x T.
+//  Un thread auxiliar lee el siguiente par de tiles de A y B con pread
+//  mientras se multiplica el par actual, y escribe cada tile de C
+//  terminado mientras se calcula el siguiente.
+//  Compilar: g++ -O2 -Wall -o ejecutable multiplicacionExterna.cpp -lpthread
+
+#include <iostream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include "../comun/hrtimer.h"
+#include "../comun/matfile.h"
+
+// Una lectura o escritura de un tile: las filas [r0, r0+rows) y las
+// columnas [c0, c0+cols) de la matriz de file, guardadas en buf una fila
+// tras otra (cols doubles por fila)
+struct io_request {
+    mf_file_t* file;
+    bool write;
+    double* buf;
+    size_t r0, c0, rows, cols;
+    bool done;
+    io_request* next;
+};
+
+// Cola FIFO de pedidos que atiende un solo thread auxiliar. busy es el
+// tiempo que ese thread pasó haciendo E/S
+struct io_queue {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    io_request* head;
+    io_request* tail;
+    bool stop;
+    bool drop;
+    double busy;
+    size_t bytes_read, bytes_written;
+};
+
+// Cada fila del tile es un trozo contiguo del archivo: un pread o pwrite
+// por fila, repitiendo si el kernel transfiere menos de lo pedido
+void transfer(io_queue* q, io_request* r){
+    const mf_header_t* h = r->file->header;
+    size_t len = r->cols*sizeof(double);
+
+    for(size_t i=0; i<r->rows; i++){
+        off_t offset = h->data_offset + ((r->r0+i)*h->cols + r->c0)*sizeof(double);
+        char* p = (char *)(r->buf + i*r->cols);
+        size_t left = len;
+        while(left > 0){
+            ssize_t count = r->write ? pwrite(r->file->fd, p, left, offset) : pread(r->file->fd, p, left, offset);
+            if(count <= 0){
+                perror(r->write ? "pwrite" : "pread");
+                exit(1);
+            }
+            p += count;
+            offset += count;
+            left -= count;
+        }
+    }
+    if(r->write) q->bytes_written += r->rows*len;
+    else q->bytes_read += r->rows*len;
+    // Con -d las filas leídas se sacan del page cache, para que la
+    // siguiente lectura del mismo tile vaya al disco como si la matriz no
+    // entrara en memoria
+    if(q->drop && !r->write){
+        off_t first = h->data_offset + r->r0*h->cols*sizeof(double);
+        posix_fadvise(r->file->fd, first, r->rows*h->cols*sizeof(double), POSIX_FADV_DONTNEED);
+    }
+}
+
+void* io_thread(void* arg){
+    io_queue* q = (io_queue*) arg;
+    io_request* r;
+
+    pthread_mutex_lock(&q->mutex);
+    while(true){
+        while(q->head == NULL && !q->stop) pthread_cond_wait(&q->cond, &q->mutex);
+        if(q->head == NULL) break;
+        r = q->head;
+        q->head = r->next;
+        if(q->head == NULL) q->tail = NULL;
+        pthread_mutex_unlock(&q->mutex);
+
+        double start = hr_now();
+        transfer(q, r);
+        double end = hr_now();
+
+        pthread_mutex_lock(&q->mutex);
+        q->busy += end - start;
+        r->done = true;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return NULL;
+}
+
+void io_start(io_queue* q, bool drop){
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->head = q->tail = NULL;
+    q->stop = false;
+    q->drop = drop;
+    q->busy = 0.0;
+    q->bytes_read = q->bytes_written = 0;
+    pthread_create(&q->thread, NULL, io_thread, q);
+}
+
+void io_submit(io_queue* q, io_request* r, mf_file_t* file, bool write, double* buf,
+        size_t r0, size_t c0, size_t rows, size_t cols){
+    r->file = file;
+    r->write = write;
+    r->buf = buf;
+    r->r0 = r0;
+    r->c0 = c0;
+    r->rows = rows;
+    r->cols = cols;
+    r->done = false;
+    r->next = NULL;
+    pthread_mutex_lock(&q->mutex);
+    if(q->tail == NULL) q->head = r;
+    else q->tail->next = r;
+    q->tail = r;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+// Espera a que termine r y devuelve cuánto tiempo hubo que esperar
+double io_wait(io_queue* q, io_request* r){
+    double start = hr_now();
+    pthread_mutex_lock(&q->mutex);
+    while(!r->done) pthread_cond_wait(&q->cond, &q->mutex);
+    pthread_mutex_unlock(&q->mutex);
+    return hr_now() - start;
+}
+
+void io_stop(io_queue* q){
+    pthread_mutex_lock(&q->mutex);
+    q->stop = true;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+    pthread_join(q->thread, NULL);
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->cond);
+}
+
+// c (ti x tj) += a (ti x tk) * b (tk x tj), con el mismo recorrido por
+// bloques que block_multiplication pero sobre tiles guardados por filas
+void tile_multiplication(size_t ti, size_t tj, size_t tk, int blockSize,
+        const double* a, const double* b, double* c){
+    for(size_t bi=0; bi<ti; bi+=blockSize){
+        size_t iEnd = std::min((size_t) blockSize, ti-bi);
+        for(size_t bj=0; bj<tj; bj+=blockSize){
+            size_t jEnd = std::min((size_t) blockSize, tj-bj);
+            for(size_t bk=0; bk<tk; bk+=blockSize){
+                size_t kEnd = std::min((size_t) blockSize, tk-bk);
+                for(size_t i=bi; i<bi+iEnd; i++){
+                    for(size_t j=bj; j<bj+jEnd; j++){
+                        double sum = c[i*tj+j];
+                        for(size_t k=bk; k<bk+kEnd; k++){
+                            sum += a[i*tk+k]*b[k*tj+j];
+                        }
+                        c[i*tj+j] = sum;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Crea path con una matriz de rows x cols de enteros al azar entre 1 y
+// 100, escribiendo fila por fila en el archivo mapeado
+void generate(const char* path, size_t rows, size_t cols, unsigned seed){
+    mf_file_t f;
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> distribution(1, 100);
+
+    if(mf_create(&f, path, rows, cols, MF_F64, MF_ROW, MF_DEFAULT_ALIGN) != 0) exit(1);
+    mf_advise(&f, MADV_SEQUENTIAL);
+    double* data = (double *)f.data;
+    for(size_t i=0; i<rows*cols; i++) data[i] = distribution(gen);
+    mf_close(&f);
+}
+
+double* new_tile(size_t T){
+    double* t = (double *)malloc(T*T*sizeof(double));
+    if(!t)
+    {
+        printf("La memoria falló. \n");
+        exit(1);
+    }
+    return t;
+}
+
+// Uso: ./ejecutable A.mat B.mat C.mat [tile] [tamaño de bloque] [-g n] [-d] [-c]
+// A y B tienen que ser f64 por filas (convertirMatriz.cpp -t f64 -l row);
+// C se crea. Por defecto tiles de 1024 (8 MB cada uno; en memoria hay
+// 2 de A, 2 de B y 2 de C) y bloques de 64 dentro de cada tile.
+// -g n genera antes A y B de n x n al azar; -d saca del page cache lo que
+// se lee, para medir el disco aunque las matrices entren en memoria; -c
+// compara C con la multiplicación en memoria (solo para n chicos).
+// Se imprime cuánto tiempo se pasó calculando, cuánto haciendo E/S, cuánto
+// tuvo que esperar el cálculo a la E/S y qué parte de la E/S quedó oculta
+// detrás del cálculo.
+int main(int argc, char* argv[])
+{
+    const char* paths[3];
+    int count = 0, blockSize = 64;
+    size_t T = 1024, generated = 0;
+    bool drop = false, check = false;
+    mf_file_t fa, fb, fc;
+    io_queue q;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        std::string s = argv[arg];
+        if (s == "-g" && arg+1 < argc && atol(argv[arg+1]) > 0) generated = atol(argv[++arg]);
+        else if (s == "-d") drop = true;
+        else if (s == "-c") check = true;
+        else if (s[0] != '-' && count < 3) paths[count++] = argv[arg];
+        else if (s[0] != '-' && count == 3 && atol(argv[arg]) > 0) T = atol(argv[arg]), count++;
+        else if (s[0] != '-' && count == 4 && atoi(argv[arg]) > 0) blockSize = atoi(argv[arg]), count++;
+        else count = -1, arg = argc;
+    }
+    if (count < 3)
+    {
+        std::cout<<"Uso: "<<argv[0]<<" A.mat B.mat C.mat [tile] [tamaño de bloque] [-g n] [-d] [-c]"<<std::endl;
+        exit(1);
+    }
+    if (generated > 0)
+    {
+        generate(paths[0], generated, generated, 1);
+        generate(paths[1], generated, generated, 2);
+    }
+    if (mf_open(&fa, paths[0], 0) != 0 || mf_open(&fb, paths[1], 0) != 0) exit(1);
+    if (fa.header->dtype != MF_F64 || fa.header->layout != MF_ROW ||
+            fb.header->dtype != MF_F64 || fb.header->layout != MF_ROW ||
+            fa.header->cols != fb.header->rows)
+    {
+        std::cout<<"A y B tienen que ser f64 por filas y A.cols = B.rows"<<std::endl;
+        exit(1);
+    }
+    size_t m = fa.header->rows, p = fa.header->cols, n = fb.header->cols;
+    if (mf_create(&fc, paths[2], m, n, MF_F64, MF_ROW, MF_DEFAULT_ALIGN) != 0) exit(1);
+    printf("C (%zu x %zu) = A (%zu x %zu) * B (%zu x %zu), tiles de %zu, bloques de %d\n",
+            m, n, m, p, p, n, T, blockSize);
+
+    // Dos juegos de tiles de A y B: mientras se multiplica uno se lee el
+    // otro. Dos tiles de C: mientras se escribe uno se acumula el otro
+    double* tileA[2] = { new_tile(T), new_tile(T) };
+    double* tileB[2] = { new_tile(T), new_tile(T) };
+    double* tileC[2] = { new_tile(T), new_tile(T) };
+    io_request readA[2], readB[2], writeC[2];
+    bool pendingC[2] = { false, false };
+    size_t tilesI = (m+T-1)/T, tilesJ = (n+T-1)/T, tilesK = (p+T-1)/T;
+    size_t steps = tilesI*tilesJ*tilesK;
+    double compute = 0.0, stall = 0.0;
+    int slotC = 0;
+
+    io_start(&q, drop);
+    double start = hr_now();
+    // El paso s multiplica A(bi, bk) por B(bk, bj), con bk el índice más
+    // interno: los tiles de un mismo C(bi, bj) se suman seguidos
+    for (size_t s = 0; s <= steps; s++)
+    {
+        // Pedir los tiles del paso s; se esperan en el paso s+1, que
+        // mientras tanto multiplica los del paso anterior
+        if (s < steps)
+        {
+            size_t bi = s/(tilesJ*tilesK)*T, bj = s/tilesK%tilesJ*T, bk = s%tilesK*T;
+            size_t ti = std::min(T, m-bi), tj = std::min(T, n-bj), tk = std::min(T, p-bk);
+            io_submit(&q, &readA[s%2], &fa, false, tileA[s%2], bi, bk, ti, tk);
+            io_submit(&q, &readB[s%2], &fb, false, tileB[s%2], bk, bj, tk, tj);
+        }
+        if (s == 0) continue;
+
+        size_t t = s-1;
+        size_t bi = t/(tilesJ*tilesK)*T, bj = t/tilesK%tilesJ*T, bk = t%tilesK*T;
+        size_t ti = std::min(T, m-bi), tj = std::min(T, n-bj), tk = std::min(T, p-bk);
+        stall += io_wait(&q, &readA[t%2]);
+        stall += io_wait(&q, &readB[t%2]);
+        if (bk == 0)
+        {
+            // Un tile de C nuevo: el buffer tiene que haberse escrito
+            if (pendingC[slotC]) stall += io_wait(&q, &writeC[slotC]);
+            std::fill(tileC[slotC], tileC[slotC]+ti*tj, 0.0);
+        }
+        double computeStart = hr_now();
+        tile_multiplication(ti, tj, tk, blockSize, tileA[t%2], tileB[t%2], tileC[slotC]);
+        compute += hr_now() - computeStart;
+        if (bk + tk == p)
+        {
+            io_submit(&q, &writeC[slotC], &fc, true, tileC[slotC], bi, bj, ti, tj);
+            pendingC[slotC] = true;
+            slotC = 1 - slotC;
+        }
+    }
+    for (int c = 0; c < 2; c++)
+        if (pendingC[c]) stall += io_wait(&q, &writeC[c]);
+    double end = hr_now();
+    io_stop(&q);
+
+    double wall = end - start;
+    printf("Tiempo total:     %10.2f ms\n", 1.0e3*wall);
+    // Con matrices muy chicas compute o q.busy pueden quedar en cero
+    printf("Cálculo:          %10.2f ms (%.2f GFLOP/s)\n", 1.0e3*compute,
+            compute > 0.0 ? 2.0*m*n*p/compute/1.0e9 : 0.0);
+    printf("E/S:              %10.2f ms (%.1f MB leídos, %.1f MB escritos, %.1f MB/s)\n",
+            1.0e3*q.busy, q.bytes_read/1048576.0, q.bytes_written/1048576.0,
+            q.busy > 0.0 ? (q.bytes_read + q.bytes_written)/1048576.0/q.busy : 0.0);
+    printf("Espera por E/S:   %10.2f ms\n", 1.0e3*stall);
+    printf("E/S solapada con el cálculo: %.1f%%\n",
+            q.busy > 0.0 ? 100.0*std::max(0.0, q.busy - stall)/q.busy : 100.0);
+
+    if (check)
+    {
+        const double* a = (const double *)fa.data;
+        const double* b = (const double *)fb.data;
+        const double* c = (const double *)fc.data;
+        double max_diff = 0.0;
+        for (size_t i = 0; i < m; i++)
+            for (size_t j = 0; j < n; j++)
+            {
+                double sum = 0.0;
+                for (size_t k = 0; k < p; k++) sum += a[i*p+k]*b[k*n+j];
+                max_diff = std::max(max_diff, std::abs(sum - c[i*n+j]));
+            }
+        std::cout << "\tDiferencia máxima con la multiplicación en memoria: " + std::to_string(max_diff) << std::endl;
+    }
+
+    for (int c = 0; c < 2; c++)
+    {
+        free(tileA[c]);
+        free(tileB[c]);
+        free(tileC[c]);
+    }
+    mf_close(&fa);
+    mf_close(&fb);
+    mf_close(&fc);
+    return 0;
+}
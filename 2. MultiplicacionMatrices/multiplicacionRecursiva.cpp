@@ -0,0 +1,227 @@
+//  Multiplicación recursiva (divide y vencerás) en paralelo con robo de
+//  trabajo. Compilar: g++ -O2 -Wall -o ejecutable multiplicacionRecursiva.cpp -lpthread
+
+#include <iostream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include "../comun/hrtimer.h"
+#include "../comun/worksteal.h"
+
+int get_random(int low, int high) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> distribution(low, high);
+  return distribution(gen);
+}
+
+// Igual que en multiplicacionBloques.cpp; es la referencia secuencial
+void block_multiplication(int n, int blockSize, double** a, double** b, double** c){
+    int bi, bj, bk, i, j, k;
+    bi = bj = bk = i =  j = k = 0;
+
+    for(bi=0; bi<n; bi+=blockSize){
+        int iEnd = std::min(blockSize, n-bi);
+        for(bj=0; bj<n; bj+=blockSize){
+            int jEnd = std::min(blockSize, n-bj);
+            for(bk=0; bk<n; bk+=blockSize){
+                int kEnd = std::min(blockSize, n-bk);
+                for(i=0; i<iEnd; i++){
+                    for(j=0; j<jEnd; j++){
+                        for(k=0; k<kEnd; k++){
+                            c[bi+i][bj+j] += a[bi+i][bk+k]*b[bk+k][bj+j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// C[bi..bi+iEnd)[bj..bj+jEnd) += A[bi..][bk..bk+kEnd) * B[bk..][bj..]
+struct block_task {
+    double** a;
+    double** b;
+    double** c;
+    int bi, bj, bk;
+    int iEnd, jEnd, kEnd;
+    int leaf;
+};
+
+// Parte el bloque en dos por su dimensión más larga hasta que las tres
+// son <= leaf, y entonces hace el mismo recorrido que block_multiplication.
+// Las dos mitades de bi o de bj escriben partes distintas de C y se
+// ejecutan en paralelo; las dos de bk escriben el mismo bloque de C y van
+// una después de la otra.
+void recursive_multiplication(void* arg){
+    block_task* t = (block_task*) arg;
+    block_task first = *t, second = *t;
+    ws_task_t task;
+
+    if(t->iEnd <= t->leaf && t->jEnd <= t->leaf && t->kEnd <= t->leaf){
+        double** a = t->a;
+        double** b = t->b;
+        double** c = t->c;
+        int bi = t->bi, bj = t->bj, bk = t->bk;
+        for(int i=0; i<t->iEnd; i++){
+            for(int j=0; j<t->jEnd; j++){
+                double sum = c[bi+i][bj+j];
+                for(int k=0; k<t->kEnd; k++){
+                    sum += a[bi+i][bk+k]*b[bk+k][bj+j];
+                }
+                c[bi+i][bj+j] = sum;
+            }
+        }
+        return;
+    }
+
+    if(t->iEnd >= t->jEnd && t->iEnd >= t->kEnd){
+        first.iEnd = t->iEnd/2;
+        second.bi = t->bi + first.iEnd;
+        second.iEnd = t->iEnd - first.iEnd;
+    }
+    else if(t->jEnd >= t->kEnd){
+        first.jEnd = t->jEnd/2;
+        second.bj = t->bj + first.jEnd;
+        second.jEnd = t->jEnd - first.jEnd;
+    }
+    else{
+        first.kEnd = t->kEnd/2;
+        second.bk = t->bk + first.kEnd;
+        second.kEnd = t->kEnd - first.kEnd;
+        recursive_multiplication(&first);
+        recursive_multiplication(&second);
+        return;
+    }
+    ws_spawn(&task, recursive_multiplication, &first);
+    recursive_multiplication(&second);
+    ws_sync(&task);
+}
+
+// Inicializa las filas [first, last) de A, B y C dividiendo el rango entre
+// los workers: con una política de afinidad, cada página de las matrices
+// queda en el nodo NUMA del worker que la escribió primero (first touch)
+struct init_task {
+    double** a;
+    double** b;
+    double** c;
+    int n, first, last;
+};
+
+void init_rows(void* arg){
+    init_task* t = (init_task*) arg;
+    ws_task_t task;
+
+    if(t->last - t->first > 16){
+        init_task top = *t, bottom = *t;
+        top.last = bottom.first = t->first + (t->last - t->first)/2;
+        ws_spawn(&task, init_rows, &top);
+        init_rows(&bottom);
+        ws_sync(&task);
+        return;
+    }
+    for(int i=t->first; i<t->last; i++)
+    {
+        for(int j=0; j<t->n; j++)
+        {
+            t->a[i][j] = get_random(1, 100);
+            t->b[i][j] = get_random(1, 100);
+            t->c[i][j] = 0.0;
+        }
+    }
+}
+
+double** new_matrix(int n){
+    double** M = (double **)malloc(n*sizeof(double *));
+    if(!M)
+    {
+        printf("La memoria falló. \n");
+        exit(1);
+    }
+    M[0] = (double *)malloc(n*n*sizeof(double));
+    if(!M[0])
+    {
+        printf("La memoria falló. \n");
+        exit(1);
+    }
+    for(int i=1; i<n; i++) M[i] = M[0]+i*n;
+    return M;
+}
+
+void free_matrix(double** M){
+    free(M[0]);
+    free(M);
+}
+
+// Uso: ./ejecutable [n] [workers] [hoja] [afinidad]
+// Sin n se pide por teclado; por defecto un worker por CPU, hojas de 32 y
+// afinidad none (las demás: compact, scatter, node; ver affinity.h).
+// Se multiplica una vez con block_multiplication (bloque = hoja) y otra
+// con la versión recursiva; se imprimen los dos tiempos, la diferencia
+// máxima entre los resultados y, por worker, cuántas tareas ejecutó,
+// cuántas robó y qué fracción del tiempo tuvo trabajo.
+int main(int argc, char* argv[])
+{
+    double start, end;
+    int n, workers, leaf;
+    double** A;
+    double** B;
+    double** C;
+    double** R;
+    ws_sched_t sched;
+    af_placement_t placement;
+    af_policy_t policy = AF_NONE;
+
+    if (argc > 1) n = atoi(argv[1]);
+    else { std::cout<<"Ingrese la dimensión de Matriz (n): "; std::cin>>n; }
+    workers = argc > 2 ? atoi(argv[2]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    leaf = argc > 3 ? atoi(argv[3]) : 32;
+    if (n <= 0 || workers <= 0 || leaf <= 0 || (argc > 4 && !af_parse_policy(argv[4], &policy)))
+    {
+        std::cout<<"Uso: "<<argv[0]<<" [n] [workers] [hoja] [none|compact|scatter|node]"<<std::endl;
+        exit(1);
+    }
+    af_init(&placement, policy, workers);
+    af_report(&placement, stdout);
+    ws_init(&sched, workers, &placement);
+
+    A = new_matrix(n);
+    B = new_matrix(n);
+    C = new_matrix(n);
+    R = new_matrix(n);
+
+    // Inicializamos la matriz A y B, y C en cero, en paralelo
+    init_task rows = { A, B, C, n, 0, n };
+    ws_run(&sched, init_rows, &rows);
+
+    /*  Referencia secuencial  */
+    std::fill(R[0], R[0]+n*n, 0.0);
+    start = hr_now();
+    block_multiplication(n,leaf,A,B,R);
+    end = hr_now();
+    double serial = 1.0e3*(end - start);
+    std::cout << "\tBloques, secuencial. Tiempo: " + std::to_string(serial) + " milliseconds." << std::endl;
+
+    /*  Multiplicación recursiva con robo de trabajo  */
+    block_task root = { A, B, C, 0, 0, 0, n, n, n, leaf };
+    start = hr_now();
+    ws_run(&sched, recursive_multiplication, &root);
+    end = hr_now();
+    double parallel = 1.0e3*(end - start);
+    std::cout << "\tRecursiva, " + std::to_string(workers) + " workers. Tiempo: " + std::to_string(parallel) + " milliseconds. Aceleración: " + std::to_string(serial/parallel) << std::endl;
+
+    double max_diff = 0.0;
+    for(int i=0; i<n*n; i++) max_diff = std::max(max_diff, std::abs(C[0][i] - R[0][i]));
+    std::cout << "\tDiferencia máxima con la secuencial: " + std::to_string(max_diff) << std::endl;
+    ws_report(&sched, stdout);
+    ws_destroy(&sched);
+
+    free_matrix(A);
+    free_matrix(B);
+    free_matrix(C);
+    free_matrix(R);
+    return 0;
+}
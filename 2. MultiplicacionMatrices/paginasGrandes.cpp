@@ -0,0 +1,140 @@
+//  Compara páginas de 4 KB con páginas grandes (matalloc.h) en la
+//  multiplicación por bloques y en un recorrido de B por columnas, que es
+//  el acceso con salto de n doubles que falla en el TLB.
+//  Compilar: g++ -O2 -Wall -o ejecutable paginasGrandes.cpp
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "../comun/hrtimer.h"
+#include "../comun/perfcount.h"
+#include "../comun/matalloc.h"
+
+void block_multiplication(int n, int blockSize, double** a, double** b, double** c){
+    int bi, bj, bk, i, j, k;
+    bi = bj = bk = i =  j = k = 0;
+
+    for(bi=0; bi<n; bi+=blockSize){
+        int iEnd = std::min(blockSize, n-bi);
+        for(bj=0; bj<n; bj+=blockSize){
+            int jEnd = std::min(blockSize, n-bj);
+            for(bk=0; bk<n; bk+=blockSize){
+                int kEnd = std::min(blockSize, n-bk);
+                for(i=0; i<iEnd; i++){
+                    for(j=0; j<jEnd; j++){
+                        for(k=0; k<kEnd; k++){
+                            c[bi+i][bj+j] += a[bi+i][bk+k]*b[bk+k][bj+j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Suma B columna por columna: cada acceso está n*8 bytes después del
+// anterior, así que con n >= 512 cada uno cae en otra página de 4 KB
+double column_sum(int n, double** b){
+    double sum = 0.0;
+    for(int j=0; j<n; j++){
+        for(int i=0; i<n; i++){
+            sum += b[i][j];
+        }
+    }
+    return sum;
+}
+
+// Matriz de n x n con las filas en una sola reserva de matalloc.h
+double** new_matrix(int n, ma_block_t* block, ma_pages_t pages, ma_numa_t numa){
+    double** M = (double **)malloc(n*sizeof(double *));
+    if(!M)
+    {
+        printf("La memoria falló. \n");
+        exit(1);
+    }
+    M[0] = (double *)ma_alloc(block, (size_t) n*n*sizeof(double), pages, numa);
+    for(int i=1; i<n; i++) M[i] = M[0]+(size_t) i*n;
+    return M;
+}
+
+// Uso: ./ejecutable [n] [tamaño de bloque] [none|local|interleave]
+// Por defecto n = 1024, bloques de 64 y NUMA none. Para cada tipo de
+// página (4k, thp, 2m, 1g) se reservan A, B y C, se multiplican por
+// bloques y se recorre B por columnas; se imprimen los tiempos, los fallos
+// de dTLB (perfcount.h) y cuánto quedó de verdad en páginas grandes. Si no
+// hay páginas 2m o 1g reservadas esas filas usan thp (columna "usadas").
+int main(int argc, char* argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 1024;
+    int blockSize = argc > 2 ? atoi(argv[2]) : 64;
+    ma_numa_t numa = MA_NUMA_NONE;
+    pc_counters_t pc;
+
+    if (n <= 0 || blockSize <= 0 || (argc > 3 && !ma_parse_numa(argv[3], &numa)))
+    {
+        std::cout<<"Uso: "<<argv[0]<<" [n] [tamaño de bloque] [none|local|interleave]"<<std::endl;
+        exit(1);
+    }
+    printf("n = %d (%.1f MB por matriz), bloques de %d, NUMA %s\n", n,
+            (double) n*n*sizeof(double)/1048576.0, blockSize, ma_numa_name(numa));
+    printf("%-8s %-8s %10s %14s %16s %14s %16s\n", "páginas", "usadas",
+            "MB grandes", "bloques (ms)", "dTLB bloques", "columnas (ms)", "dTLB columnas");
+
+    pc_open(&pc);
+    for (int p = 0; p < MA_PAGE_KINDS; p++)
+    {
+        ma_block_t blockA, blockB, blockC;
+        double** A = new_matrix(n, &blockA, (ma_pages_t) p, numa);
+        double** B = new_matrix(n, &blockB, (ma_pages_t) p, numa);
+        double** C = new_matrix(n, &blockC, (ma_pages_t) p, numa);
+        double start, end, blocks, columns, sum;
+        double tlbBlocks, tlbColumns;
+
+        for(int i=0; i<n; i++)
+        {
+            for(int j=0; j<n; j++)
+            {
+                A[i][j] = (i*7 + j*3) % 100 + 1;
+                B[i][j] = (i*3 + j*7) % 100 + 1;
+                C[i][j] = 0.0;
+            }
+        }
+
+        pc_start(&pc);
+        start = hr_now();
+        block_multiplication(n,blockSize,A,B,C);
+        end = hr_now();
+        pc_stop(&pc);
+        blocks = 1.0e3*(end - start);
+        tlbBlocks = pc_value(&pc, PC_DTLB_MISSES);
+
+        pc_start(&pc);
+        start = hr_now();
+        sum = column_sum(n, B);
+        end = hr_now();
+        pc_stop(&pc);
+        columns = 1.0e3*(end - start);
+        tlbColumns = pc_value(&pc, PC_DTLB_MISSES);
+
+        printf("%-8s %-8s %10.1f %14.2f ", ma_pages_name((ma_pages_t) p),
+                ma_pages_name(blockA.pages),
+                (ma_huge_bytes(&blockA) + ma_huge_bytes(&blockB) + ma_huge_bytes(&blockC))/1048576.0,
+                blocks);
+        if (tlbBlocks < 0) printf("%16s ", "n/d");
+        else printf("%16.0f ", tlbBlocks);
+        printf("%14.2f ", columns);
+        if (tlbColumns < 0) printf("%16s\n", "n/d");
+        else printf("%16.0f\n", tlbColumns);
+        if (sum + C[n-1][n-1] == 0.0) printf("\n");   // Usa los resultados
+
+        ma_free(&blockA);
+        ma_free(&blockB);
+        ma_free(&blockC);
+        free(A);
+        free(B);
+        free(C);
+    }
+    pc_close(&pc);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Archivo:   barrido_particiones.sh
+#
+# Propósito: Medir el throughput de listaEnlazada_Particionada.c variando el
+#            número de sublistas y de threads, e imprimir una tabla.
+#
+# Ejecutar:  ./barrido_particiones.sh [ejecutable] [keys] [ops] [busq] [ins]
+#            Por defecto: ./particionada 1000 100000 0.8 0.1
+#
+# Compilar el programa antes con:
+#    gcc -O2 -g -Wall -I. -o particionada listaEnlazada_Particionada.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+
+PROG=${1:-./particionada}
+KEYS=${2:-1000}
+OPS=${3:-100000}
+SEARCH=${4:-0.8}
+INSERT=${5:-0.1}
+MAX_THREADS=$(nproc 2>/dev/null || echo 4)
+
+printf "%8s %8s %14s\n" "sublistas" "threads" "ops/s"
+for shards in 1 4 16 64 256 1024; do
+   threads=1
+   while [ "$threads" -le "$MAX_THREADS" ]; do
+      "$PROG" "$threads" "$shards" -k "$KEYS" -o "$OPS" \
+            -s "$SEARCH" -i "$INSERT" |
+         awk '/^RESUMEN/ { printf "%8d %8d %14.4e\n", $2, $3, $4 }'
+      threads=$((threads * 2))
+   done
+done
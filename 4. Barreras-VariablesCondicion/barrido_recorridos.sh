@@ -0,0 +1,28 @@
+#!/bin/sh
+# Archivo:   barrido_recorridos.sh
+#
+# Propósito: Medir cuántos recorridos de listaEnlazada_MultiMutex.c avanzan
+#            en paralelo más allá de la cabeza, variando el número de
+#            threads, e imprimir una tabla.
+#
+# Ejecutar:  ./barrido_recorridos.sh [ejecutable] [keys] [ops] [busq] [ins]
+#            Por defecto: ./multimutex 1000 20000 0.8 0.1
+#
+# Compilar el programa antes con:
+#    gcc -O2 -g -Wall -I. -DTRAVERSAL_STATS -o multimutex listaEnlazada_MultiMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+# Para la prueba de estrés del protocolo de locks agregar -DLOCK_ORDER_CHECK.
+
+PROG=${1:-./multimutex}
+KEYS=${2:-1000}
+OPS=${3:-20000}
+SEARCH=${4:-0.8}
+INSERT=${5:-0.1}
+MAX_THREADS=$(( 2 * $(nproc 2>/dev/null || echo 4) ))
+
+printf "%8s %12s %8s %14s\n" "threads" "simultáneos" "máximo" "ops/s"
+threads=1
+while [ "$threads" -le "$MAX_THREADS" ]; do
+   "$PROG" "$threads" -k "$KEYS" -o "$OPS" -s "$SEARCH" -i "$INSERT" |
+      awk '/^RECORRIDOS/ { printf "%8d %12.3f %8d %14.4e\n", $2, $3, $4, $5 }'
+   threads=$((threads * 2))
+done
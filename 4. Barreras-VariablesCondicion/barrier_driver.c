@@ -0,0 +1,418 @@
+/* Archivo:
+ *    barrier_driver.c
+ *
+ * Propósito:
+ *    Ejecutar cualquiera de las barreras de barriers.c con el mismo
+ *    programa y medir la distribución de su latencia episodio por
+ *    episodio, en lugar de solo el tiempo total como busy_barrier.c,
+ *    condition_barrier.c y los demás. Con una carga, los threads hacen
+ *    trabajo de cómputo entre barreras, como en un programa
+ *    bulk-synchronous, y se mide cuánto tiempo pasa cada uno esperando.
+ *
+ * Entrada:
+ *    Ninguna
+ * Salida:
+ *    Sin carga: tiempo total y, para cada tipo de medición, número de
+ *    muestras, p50, p99, p99.9 y máximo en nanosegundos:
+ *       espera    desde que un thread llega a la barrera hasta que sale,
+ *                 en cada thread y en cada episodio
+ *       episodio  entre dos salidas consecutivas del thread 0, es decir,
+ *                 lo que dura un episodio completo
+ *    y los contadores de hardware de toda la ejecución (perfcount.h).
+ *    Con carga: una fila por tipo de barrera con el tiempo total, el
+ *    tiempo ideal (la suma del trabajo del thread más lento de cada
+ *    episodio), el trabajo y la espera promedio por thread, la espera del
+ *    thread que más esperó y el porcentaje del tiempo de los threads que
+ *    se fue en sincronización
+ *
+ * Compilar:
+ *    gcc -O2 -g -Wall -o ejecutable barrier_driver.c barriers.c futex_sync.c pool.c latency.c my_rand.c -lpthread
+ *    timer.h, barriers.h, futex_sync.h, pool.h, latency.h y my_rand.h deben
+ *    estar disponibles
+ *
+ * Ejecutar:
+ *    ./ejecutable <tipo|all> <thread_count> [episodios] [carga] [trabajo_us]
+ *                 [afinidad]
+ *    tipo:  busy, cond, sem, sense, tree, dissemination, tournament, futex,
+ *           futex-cond; all las ejecuta todas, una detrás de otra
+ *    carga: none       barreras seguidas, sin trabajo (por defecto)
+ *           uniform    todos los threads hacen trabajo_us por episodio
+ *           random     cada thread hace entre (1 - IMBALANCE)*trabajo_us y
+ *                      (1 + IMBALANCE)*trabajo_us, sorteado por episodio
+ *           straggler  el último thread hace STRAGGLER veces trabajo_us
+ *                      y los demás trabajo_us
+ *    afinidad: none, compact, scatter o node (comun/affinity.h)
+ *    Por defecto DEFAULT_EPISODES episodios, DEFAULT_WORK_US
+ *    microsegundos de trabajo y afinidad none.
+ *
+ * Notas:
+ *    1. Antes de medir se hacen WARMUP barreras.
+ *    2. La espera de un thread incluye el tiempo que pasa aguardando a los
+ *       que llegan después, así que su p50 depende del orden de llegada;
+ *       la cola (p99.9, máximo) muestra las veces que un thread perdió la
+ *       CPU o se durmió en el kernel.
+ *    3. El trabajo es una cadena de operaciones de punto flotante
+ *       dependientes entre sí; main calibra cuántas iteraciones hace por
+ *       microsegundo. La cantidad de trabajo de cada thread en cada
+ *       episodio se sortea una sola vez, así que todas las barreras
+ *       ejecutan exactamente la misma carga.
+ *    4. Con carga, tiempo total - ideal es lo que cuesta sincronizar por
+ *       encima del desbalance, que ninguna barrera puede evitar. La espera
+ *       incluye las dos cosas. El ideal supone un núcleo por thread.
+ *    5. Con el flag de compilación DEBUG se verifica en cada episodio que
+ *       ningún thread se adelantó a la barrera y que barrier_wait no
+ *       devolvió 1 en más de un thread.
+ *    6. Los threads se crean una sola vez, en un pool (pool.c), y cada
+ *       tipo de barrera es una fase de pool_run: el tiempo medido no
+ *       incluye pthread_create ni pthread_join. Los contadores se abren
+ *       antes de crear el pool para que cuenten también sus threads.
+ *
+ * IPP:   Sección 4.8 (págs. 176 y sigs.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+#include "barriers.h"
+#include "latency.h"
+#include "pool.h"
+#include "../comun/perfcount.h"
+#include "../comun/hrtimer.h"
+#include "my_rand.h"
+
+#define DEFAULT_EPISODES 100000
+#define DEFAULT_WORK_US 10.0
+#define WARMUP 1000
+#define IMBALANCE 0.5
+#define STRAGGLER 2.0
+#define CALIBRATION_ITERS 10000000L
+
+enum { OP_WAIT, OP_EPISODE, OP_COUNT };
+const char* op_names[] = { "espera", "episodio" };
+
+typedef enum { LOAD_NONE, LOAD_UNIFORM, LOAD_RANDOM, LOAD_STRAGGLER,
+   LOAD_KINDS } load_t;
+const char* load_names[] = { "none", "uniform", "random", "straggler" };
+
+/* Tiempos de un thread con carga, en su propia línea de cache */
+struct thread_times_s {
+   long long work_ns;
+   long long wait_ns;
+   double sink;           /* Para que el compilador no elimine el trabajo */
+} __attribute__((aligned(BARRIER_CACHE_LINE)));
+
+int thread_count;
+long episodes;
+barrier_t barrier;
+load_t load = LOAD_NONE;
+double work_us = DEFAULT_WORK_US;
+long* work_iters;                  /* [episodio*thread_count + rank] */
+struct thread_times_s* times;
+pool_t pool;
+pc_counters_t pc;
+#ifdef DEBUG
+int arrivals[2];
+int serials[2];
+#endif
+
+void   Usage(char* prog_name);
+void*  Thread_work(void* rank);
+void*  Thread_load(void* rank);
+double Work(long iters);
+double Calibrate(void);
+double Build_load(void);
+void   Run(barrier_kind_t kind, double ideal);
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   barrier_kind_t kinds[BARRIER_KINDS];
+   int kind_count = 0, k;
+   double ideal = 0.0;
+   af_policy_t policy = AF_NONE;
+   af_placement_t placement;
+
+   if (argc < 3 || argc > 7) Usage(argv[0]);
+   if (strcmp(argv[1], "all") == 0)
+      for (k = 0; k < BARRIER_KINDS; k++)
+         kinds[kind_count++] = (barrier_kind_t) k;
+   else if (barrier_parse_kind(argv[1], &kinds[0]))
+      kind_count = 1;
+   else
+      Usage(argv[0]);
+   thread_count = strtol(argv[2], NULL, 10);
+   episodes = argc > 3 ? strtol(argv[3], NULL, 10) : DEFAULT_EPISODES;
+   if (argc > 4) {
+      for (k = 0; k < LOAD_KINDS; k++)
+         if (strcmp(argv[4], load_names[k]) == 0) break;
+      if (k == LOAD_KINDS) Usage(argv[0]);
+      load = (load_t) k;
+   }
+   if (argc > 5) work_us = strtod(argv[5], NULL);
+   if (argc > 6 && !af_parse_policy(argv[6], &policy)) Usage(argv[0]);
+   if (thread_count <= 0 || episodes <= 0 || work_us < 0) Usage(argv[0]);
+
+   af_init(&placement, policy, thread_count);
+   af_report(&placement, stdout);
+   if (load != LOAD_NONE) {
+      ideal = Build_load();
+      printf("%d threads, %ld episodios, carga %s de %.1f us\n",
+            thread_count, episodes, load_names[load], work_us);
+      printf("%-14s %11s %11s %11s %11s %11s %8s\n", "barrera", "total (s)",
+            "ideal (s)", "trabajo", "espera", "espera máx", "sinc %");
+   }
+   if (load == LOAD_NONE) pc_open(&pc);
+   pool_init(&pool, thread_count, &placement);
+   for (k = 0; k < kind_count; k++)
+      Run(kinds[k], ideal);
+   pool_destroy(&pool);
+   if (load == LOAD_NONE) pc_close(&pc);
+
+   if (load != LOAD_NONE) {
+      free(work_iters);
+      free(times);
+   }
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Usage
+ * Propósito:   Imprimir línea de comando para función y terminar
+ * En arg:      prog_name
+ */
+void Usage(char* prog_name) {
+   int k;
+
+   fprintf(stderr, "Usar: %s <tipo|all> <numero de threads> [episodios] "
+         "[carga] [trabajo_us] [afinidad]\n", prog_name);
+   fprintf(stderr, "   tipo:");
+   for (k = 0; k < BARRIER_KINDS; k++)
+      fprintf(stderr, " %s", barrier_kind_name((barrier_kind_t) k));
+   fprintf(stderr, "\n   carga:");
+   for (k = 0; k < LOAD_KINDS; k++)
+      fprintf(stderr, " %s", load_names[k]);
+   fprintf(stderr, "\n   afinidad:");
+   for (k = 0; k < AF_POLICIES; k++)
+      fprintf(stderr, " %s", af_policy_name((af_policy_t) k));
+   fprintf(stderr, "\n");
+   exit(0);
+}  /* Usage */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Work
+ * Propósito:   Hacer iters iteraciones de una cadena dependiente de
+ *              multiplicaciones y sumas
+ * Val Retorno: El resultado, para que no se pueda eliminar
+ */
+double Work(long iters) {
+   double x = 1.0;
+   long i;
+
+   for (i = 0; i < iters; i++)
+      x = x*0.999 + 0.5;
+   return x;
+}  /* Work */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Calibrate
+ * Propósito:   Medir cuántas iteraciones de Work entran en un
+ *              microsegundo (el mejor de tres intentos)
+ */
+double Calibrate(void) {
+   long long t0, elapsed, best = 0;
+   double sink = 0.0;
+   int i;
+
+   for (i = 0; i < 3; i++) {
+      t0 = hr_now_ns();
+      sink += Work(CALIBRATION_ITERS);
+      elapsed = hr_now_ns() - t0;
+      if (best == 0 || elapsed < best) best = elapsed;
+   }
+   if (sink == 0.0) printf(" ");
+   return 1000.0*CALIBRATION_ITERS/best;
+}  /* Calibrate */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Build_load
+ * Propósito:   Sortear el trabajo de cada thread en cada episodio según
+ *              load y reservar los tiempos por thread
+ * Var Global:  work_iters, times, load, work_us, episodes, thread_count
+ * Val Retorno: Tiempo ideal en segundos: la suma del trabajo del thread
+ *              más lento de cada episodio
+ */
+double Build_load(void) {
+   double iters_per_us = Calibrate(), us, max_us, ideal_us = 0.0;
+   unsigned seed = 1;
+   long e;
+   int r;
+
+   work_iters = malloc(episodes*thread_count*sizeof(long));
+   if (work_iters == NULL || posix_memalign((void**) &times,
+            BARRIER_CACHE_LINE,
+            thread_count*sizeof(struct thread_times_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   for (e = 0; e < episodes; e++) {
+      max_us = 0.0;
+      for (r = 0; r < thread_count; r++) {
+         us = work_us;
+         if (load == LOAD_RANDOM)
+            us *= 1.0 - IMBALANCE + 2.0*IMBALANCE*my_drand(&seed);
+         else if (load == LOAD_STRAGGLER && r == thread_count - 1)
+            us *= STRAGGLER;
+         work_iters[e*thread_count + r] = (long) (us*iters_per_us);
+         if (us > max_us) max_us = us;
+      }
+      ideal_us += max_us;
+   }
+
+   return 1.0e-6*ideal_us;
+}  /* Build_load */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Run
+ * Propósito:   Ejecutar episodes episodios con una barrera del tipo kind e
+ *              imprimir los resultados
+ * En args:     ideal: tiempo ideal con carga (ver Build_load)
+ */
+void Run(barrier_kind_t kind, double ideal) {
+   long thread;
+   double start, finish, work = 0.0, wait = 0.0, max_wait = 0.0;
+
+   barrier_init(&barrier, kind, thread_count);
+   if (load == LOAD_NONE)
+      lat_init(thread_count, OP_COUNT, op_names);
+   else
+      memset(times, 0, thread_count*sizeof(struct thread_times_s));
+#  ifdef DEBUG
+   arrivals[0] = arrivals[1] = serials[0] = serials[1] = 0;
+#  endif
+
+   if (load == LOAD_NONE) pc_start(&pc);
+   GET_TIME(start);
+   pool_run(&pool, load == LOAD_NONE ? Thread_work : Thread_load);
+   GET_TIME(finish);
+   if (load == LOAD_NONE) pc_stop(&pc);
+
+   if (load == LOAD_NONE) {
+      printf("Barrera %s, %d threads, %ld episodios\n",
+            barrier_kind_name(kind), thread_count, episodes);
+      printf("Tiempo transcurrido = %e segundos\n", finish - start);
+      lat_report();
+      lat_destroy();
+      pc_report(&pc, barrier_kind_name(kind), stdout);
+   } else {
+      for (thread = 0; thread < thread_count; thread++) {
+         work += 1.0e-9*times[thread].work_ns;
+         wait += 1.0e-9*times[thread].wait_ns;
+         if (1.0e-9*times[thread].wait_ns > max_wait)
+            max_wait = 1.0e-9*times[thread].wait_ns;
+      }
+      printf("%-14s %11.4f %11.4f %11.4f %11.4f %11.4f %8.1f\n",
+            barrier_kind_name(kind), finish - start, ideal,
+            work/thread_count, wait/thread_count, max_wait,
+            100.0*wait/(work + wait));
+   }
+   fflush(stdout);
+
+   barrier_destroy(&barrier);
+}  /* Run */
+
+
+/*-------------------------------------------------------------------
+ * Función:     Thread_work
+ * Propósito:   Ejecutar WARMUP + episodes barreras registrando la espera
+ *              de cada una; el thread 0 registra además cada episodio
+ * En arg:      rank
+ * Var Global:  barrier, episodes, thread_count
+ * Val Retorno: Ignorado
+ */
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   long i;
+   unsigned long long t0, last_exit;
+   int serial;
+
+   for (i = 0; i < WARMUP; i++)
+      barrier_wait(&barrier, my_rank);
+
+   last_exit = lat_now();
+   for (i = 0; i < episodes; i++) {
+#     ifdef DEBUG
+      /* Nadie puede estar contando el episodio siguiente todavía */
+      __atomic_add_fetch(&arrivals[i % 2], 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&arrivals[(i + 1) % 2], __ATOMIC_SEQ_CST)
+            % thread_count != 0) {
+         fprintf(stderr, "Thread %ld > barrera violada en el episodio %ld\n",
+               my_rank, i);
+         exit(1);
+      }
+#     endif
+      t0 = lat_now();
+      serial = barrier_wait(&barrier, my_rank);
+      lat_record(my_rank, OP_WAIT, t0);
+      if (my_rank == 0) {
+         lat_record(my_rank, OP_EPISODE, last_exit);
+         last_exit = lat_now();
+      }
+#     ifdef DEBUG
+      if (serial) __atomic_add_fetch(&serials[i % 2], 1, __ATOMIC_SEQ_CST);
+      /* El episodio i - 1 ya terminó en todos los threads */
+      if (i > 0 && __atomic_exchange_n(&serials[(i + 1) % 2], 0,
+               __ATOMIC_SEQ_CST) > 1) {
+         fprintf(stderr, "Thread %ld > dos threads seriales en el episodio "
+               "%ld\n", my_rank, i - 1);
+         exit(1);
+      }
+#     else
+      (void) serial;
+#     endif
+   }
+
+   return NULL;
+}  /* Thread_work */
+
+
+/*-------------------------------------------------------------------
+ * Función:     Thread_load
+ * Propósito:   Ejecutar WARMUP barreras vacías y después episodes
+ *              episodios de trabajo seguido de una barrera, acumulando el
+ *              tiempo de cada parte
+ * En arg:      rank
+ * Var Global:  barrier, episodes, thread_count, work_iters, times
+ * Val Retorno: Ignorado
+ */
+void* Thread_load(void* rank) {
+   long my_rank = (long) rank;
+   struct thread_times_s* my_times = &times[my_rank];
+   long i;
+   long long t0, t1, t2, work_ns = 0, wait_ns = 0;
+   double sink = 0.0;
+
+   for (i = 0; i < WARMUP; i++)
+      barrier_wait(&barrier, my_rank);
+
+   t0 = hr_now_ns();
+   for (i = 0; i < episodes; i++) {
+      sink += Work(work_iters[i*thread_count + my_rank]);
+      t1 = hr_now_ns();
+      barrier_wait(&barrier, my_rank);
+      t2 = hr_now_ns();
+      work_ns += t1 - t0;
+      wait_ns += t2 - t1;
+      t0 = t2;
+   }
+
+   my_times->work_ns = work_ns;
+   my_times->wait_ns = wait_ns;
+   my_times->sink = sink;
+   return NULL;
+}  /* Thread_load */
@@ -0,0 +1,175 @@
+/* Archivo:
+ *    barrier_sweep.c
+ *
+ * Propósito:
+ *    Medir cómo escala la latencia de cada barrera de barriers.c (busy,
+ *    cond, sem, sense, tree, dissemination, tournament, futex, futex-cond)
+ *    desde 2 threads hasta todos los threads de hardware.
+ *
+ * Entrada:
+ *    Ninguna
+ * Salida:
+ *    Tabla con los nanosegundos por barrera de cada tipo para 2, 4, 8, ...
+ *    threads y para el máximo
+ *
+ * Compilar:
+ *    gcc -O2 -g -Wall -o ejecutable barrier_sweep.c barriers.c futex_sync.c -lpthread
+ *    timer.h, barriers.h y futex_sync.h deben estar disponibles
+ *
+ * Ejecutar:
+ *    ./ejecutable [episodios] [max_threads] [tipo ...]
+ *    Por defecto DEFAULT_EPISODES episodios, tantos threads como CPUs en
+ *    línea y todos los tipos.
+ *
+ * Notas:
+ *    1. Cada medición hace WARMUP barreras antes de tomar el tiempo. El
+ *       thread 0 mide desde una barrera inicial hasta la última, así que
+ *       el tiempo incluye la llegada de todos los threads.
+ *    2. Con más threads que núcleos las barreras ceden la CPU mientras
+ *       esperan; los tiempos resultantes miden sobre todo al scheduler.
+ *    3. Con el flag de compilación DEBUG cada thread verifica en cada
+ *       episodio que ningún otro thread se adelantó a la barrera.
+ *
+ * IPP:   Sección 4.8 (págs. 176 y sigs.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "timer.h"
+#include "barriers.h"
+
+#define DEFAULT_EPISODES 100000
+#define WARMUP 1000
+
+int thread_count;
+long episodes;
+barrier_t barrier;
+double elapsed;
+#ifdef DEBUG
+int arrivals[2];
+#endif
+
+void   Usage(char* prog_name);
+void*  Thread_work(void* rank);
+double Measure(barrier_kind_t kind, int threads);
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   barrier_kind_t kinds[BARRIER_KINDS];
+   int kind_count = 0, max_threads, threads, k;
+
+   episodes = argc > 1 ? strtol(argv[1], NULL, 10) : DEFAULT_EPISODES;
+   max_threads = argc > 2 ? strtol(argv[2], NULL, 10)
+                          : sysconf(_SC_NPROCESSORS_ONLN);
+   if (argc <= 2 && max_threads < 2)
+      max_threads = 2;   /* Una sola CPU: medir igual con 2 threads */
+   if (episodes <= 0 || max_threads < 2) Usage(argv[0]);
+   for (k = 3; k < argc && kind_count < BARRIER_KINDS; k++)
+      if (!barrier_parse_kind(argv[k], &kinds[kind_count++]))
+         Usage(argv[0]);
+   if (kind_count == 0)
+      for (k = 0; k < BARRIER_KINDS; k++)
+         kinds[kind_count++] = (barrier_kind_t) k;
+
+   printf("%ld episodios, ns por barrera\n", episodes);
+   printf("%8s", "threads");
+   for (k = 0; k < kind_count; k++)
+      printf(" %14s", barrier_kind_name(kinds[k]));
+   printf("\n");
+
+   threads = 2;
+   for (;;) {
+      printf("%8d", threads);
+      for (k = 0; k < kind_count; k++)
+         printf(" %14.1f", Measure(kinds[k], threads));
+      printf("\n");
+      fflush(stdout);
+      if (threads == max_threads) break;
+      threads = 2*threads < max_threads ? 2*threads : max_threads;
+   }
+
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Usage
+ * Propósito:   Imprimir línea de comando para función y terminar
+ * En arg:      prog_name
+ */
+void Usage(char* prog_name) {
+   int k;
+
+   fprintf(stderr, "Usar: %s [episodios] [max_threads] [tipo ...]\n",
+         prog_name);
+   fprintf(stderr, "   tipo:");
+   for (k = 0; k < BARRIER_KINDS; k++)
+      fprintf(stderr, " %s", barrier_kind_name((barrier_kind_t) k));
+   fprintf(stderr, "\n");
+   exit(0);
+}  /* Usage */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Measure
+ * Propósito:   Ejecutar episodes barreras del tipo kind con threads
+ *              threads
+ * Val Retorno: Nanosegundos por barrera
+ */
+double Measure(barrier_kind_t kind, int threads) {
+   pthread_t* thread_handles = malloc(threads*sizeof(pthread_t));
+   long thread;
+
+   thread_count = threads;
+   barrier_init(&barrier, kind, thread_count);
+#  ifdef DEBUG
+   arrivals[0] = arrivals[1] = 0;
+#  endif
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL, Thread_work,
+            (void*) thread);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_join(thread_handles[thread], NULL);
+   barrier_destroy(&barrier);
+   free(thread_handles);
+
+   return 1.0e9*elapsed/episodes;
+}  /* Measure */
+
+
+/*-------------------------------------------------------------------
+ * Función:     Thread_work
+ * Propósito:   Ejecutar WARMUP + episodes barreras; el thread 0 mide
+ * En arg:      rank
+ * Var Global:  barrier, episodes, elapsed
+ * Val Retorno: Ignorado
+ */
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   long i;
+   double start, finish;
+
+   for (i = 0; i < WARMUP; i++)
+      barrier_wait(&barrier, my_rank);
+
+   GET_TIME(start);
+   for (i = 0; i < episodes; i++) {
+#     ifdef DEBUG
+      /* Nadie puede estar contando el episodio siguiente todavía */
+      __atomic_add_fetch(&arrivals[i % 2], 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&arrivals[(i + 1) % 2], __ATOMIC_SEQ_CST)
+            % thread_count != 0) {
+         fprintf(stderr, "Thread %ld > barrera violada en el episodio %ld\n",
+               my_rank, i);
+         exit(1);
+      }
+#     endif
+      barrier_wait(&barrier, my_rank);
+   }
+   GET_TIME(finish);
+   if (my_rank == 0) elapsed = finish - start;
+
+   return NULL;
+}  /* Thread_work */
@@ -0,0 +1,408 @@
+/* Archivo:   barriers.c
+ *
+ * Propósito: Implementar las barreras intercambiables (ver barriers.h).
+ *
+ * Compilar:  Se enlaza con el programa que las usa, por ejemplo
+ *            gcc -O2 -g -Wall -o ejecutable barrier_sweep.c barriers.c futex_sync.c -lpthread
+ *
+ * Notas:
+ *    1. sense, tree, dissemination y tournament usan inversión de sentido:
+ *       cada thread guarda en su ranura el sentido del episodio actual y
+ *       las banderas se comparan con él, así que nunca hay que volver a
+ *       ponerlas en cero. dissemination usa además dos juegos de banderas
+ *       (parity) y cambia el sentido cada dos episodios (Mellor-Crummey y
+ *       Scott, 1991).
+ *    2. busy, cond y futex-cond esperan a que cambie generation, leída antes de
+ *       llegar, en lugar de a que el contador vuelva a cero: así un thread
+ *       rápido puede entrar al episodio siguiente sin dejar a nadie
+ *       encerrado. sem alterna entre dos semáforos de liberación (parity),
+ *       porque con uno solo un thread rápido podría consumir un sem_post
+ *       del episodio anterior.
+ *    3. La espera activa cede la CPU con sched_yield tras SPIN_LIMIT
+ *       iteraciones para no bloquearse cuando hay más threads que núcleos.
+ *    4. Las banderas se escriben con stores release y se leen con loads
+ *       acquire: lo que un thread escribió antes de la barrera es visible
+ *       para todos después.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "barriers.h"
+
+#define SPIN_LIMIT 64
+
+static const char* kind_names[] = { "busy", "cond", "sem", "sense", "tree",
+   "dissemination", "tournament", "futex", "futex-cond" };
+
+/*-----------------------------------------------------------------*/
+/* Una iteración de espera activa */
+static inline void Relax(int* iter_p) {
+   if (++*iter_p < SPIN_LIMIT) {
+#     if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#     endif
+   } else {
+      *iter_p = 0;
+      sched_yield();
+   }
+}  /* Relax */
+
+/*-----------------------------------------------------------------*/
+/* Esperar hasta que *addr valga val */
+static inline void Spin_until(int* addr, int val) {
+   int iter = 0;
+
+   while (__atomic_load_n(addr, __ATOMIC_ACQUIRE) != val)
+      Relax(&iter);
+}  /* Spin_until */
+
+/*-----------------------------------------------------------------*/
+/* Esperar mientras *addr valga val */
+static inline void Spin_while(int* addr, int val) {
+   int iter = 0;
+
+   while (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == val)
+      Relax(&iter);
+}  /* Spin_while */
+
+/*-----------------------------------------------------------------*/
+/* Función:     barrier_parse_kind
+ * Propósito:   Convertir el nombre de una barrera en su tipo
+ * Val Retorno: 1 si el nombre es válido, 0 si no
+ */
+int barrier_parse_kind(const char* name, barrier_kind_t* kind_p) {
+   int k;
+
+   for (k = 0; k < BARRIER_KINDS; k++)
+      if (strcmp(name, kind_names[k]) == 0) {
+         *kind_p = (barrier_kind_t) k;
+         return 1;
+      }
+   return 0;
+}  /* barrier_parse_kind */
+
+/*-----------------------------------------------------------------*/
+const char* barrier_kind_name(barrier_kind_t kind) {
+   return kind_names[kind];
+}  /* barrier_kind_name */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Build_tree
+ * Propósito:   Armar el árbol de combinación: las hojas (los primeros
+ *              nodos) reciben a los threads de a BARRIER_FAN_IN, cada
+ *              nivel siguiente a los nodos del anterior, hasta una raíz
+ */
+static void Build_tree(barrier_t* barrier_p) {
+   int level_start, level_size, children, n, total, size;
+
+   total = 0;
+   size = barrier_p->thread_count;
+   do {
+      size = (size + BARRIER_FAN_IN - 1)/BARRIER_FAN_IN;
+      total += size;
+   } while (size > 1);
+
+   if (posix_memalign((void**) &barrier_p->nodes, BARRIER_CACHE_LINE,
+            total*sizeof(struct barrier_node_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   memset(barrier_p->nodes, 0, total*sizeof(struct barrier_node_s));
+   barrier_p->node_count = total;
+
+   /* children: cuántos hijos (threads o nodos) tiene el nivel actual */
+   level_start = 0;
+   children = barrier_p->thread_count;
+   do {
+      level_size = (children + BARRIER_FAN_IN - 1)/BARRIER_FAN_IN;
+      for (n = 0; n < level_size; n++) {
+         barrier_p->nodes[level_start + n].fan_in =
+            children - n*BARRIER_FAN_IN < BARRIER_FAN_IN ?
+            children - n*BARRIER_FAN_IN : BARRIER_FAN_IN;
+         barrier_p->nodes[level_start + n].count =
+            barrier_p->nodes[level_start + n].fan_in;
+         barrier_p->nodes[level_start + n].parent = level_size == 1 ? -1 :
+            level_start + level_size + n/BARRIER_FAN_IN;
+      }
+      level_start += level_size;
+      children = level_size;
+   } while (level_size > 1);
+}  /* Build_tree */
+
+/*-----------------------------------------------------------------*/
+/* Función:     barrier_init
+ * Propósito:   Inicializar una barrera del tipo kind para thread_count
+ *              threads
+ */
+void barrier_init(barrier_t* barrier_p, barrier_kind_t kind,
+      int thread_count) {
+   int r;
+
+   memset(barrier_p, 0, sizeof(barrier_t));
+   barrier_p->kind = kind;
+   barrier_p->thread_count = thread_count;
+   barrier_p->count = thread_count;
+   while ((1 << barrier_p->rounds) < thread_count)
+      barrier_p->rounds++;
+   if (barrier_p->rounds > BARRIER_MAX_ROUNDS) {
+      fprintf(stderr, "Demasiados threads para la barrera\n");
+      exit(1);
+   }
+
+   if (posix_memalign((void**) &barrier_p->slots, BARRIER_CACHE_LINE,
+            thread_count*sizeof(struct barrier_slot_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   memset(barrier_p->slots, 0, thread_count*sizeof(struct barrier_slot_s));
+   for (r = 0; r < thread_count; r++)
+      barrier_p->slots[r].sense = 1;
+
+   switch (kind) {
+      case BARRIER_BUSY:
+         pthread_mutex_init(&barrier_p->mutex, NULL);
+         break;
+      case BARRIER_COND:
+         pthread_mutex_init(&barrier_p->mutex, NULL);
+         pthread_cond_init(&barrier_p->cond, NULL);
+         break;
+      case BARRIER_SEM:
+         sem_init(&barrier_p->count_sem, 0, 1);
+         sem_init(&barrier_p->release_sems[0], 0, 0);
+         sem_init(&barrier_p->release_sems[1], 0, 0);
+         break;
+      case BARRIER_TREE:
+         Build_tree(barrier_p);
+         break;
+      case BARRIER_FUTEX:
+         fx_barrier_init(&barrier_p->fx, thread_count, BARRIER_FUTEX_SPIN);
+         break;
+      case BARRIER_FUTEX_COND:
+         fx_mutex_init(&barrier_p->fx_mutex);
+         fx_cond_init(&barrier_p->fx_cond);
+         break;
+      default:
+         break;
+   }
+}  /* barrier_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Busy_wait
+ * Propósito:   busy_barrier.c: contar la llegada con el mutex tomado y
+ *              esperar activamente a que el último cambie generation
+ */
+static int Busy_wait(barrier_t* barrier_p) {
+   int gen, serial = 0;
+
+   pthread_mutex_lock(&barrier_p->mutex);
+   gen = barrier_p->generation;
+   if (++barrier_p->arrived == barrier_p->thread_count) {
+      barrier_p->arrived = 0;
+      __atomic_store_n(&barrier_p->generation, gen + 1, __ATOMIC_RELEASE);
+      serial = 1;
+   }
+   pthread_mutex_unlock(&barrier_p->mutex);
+   if (!serial) Spin_while(&barrier_p->generation, gen);
+   return serial;
+}  /* Busy_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Cond_wait
+ * Propósito:   condition_barrier.c, esperando sobre generation para que
+ *              un despertar espurio no deje pasar a nadie
+ */
+static int Cond_wait(barrier_t* barrier_p) {
+   int gen, serial = 0;
+
+   pthread_mutex_lock(&barrier_p->mutex);
+   gen = barrier_p->generation;
+   if (++barrier_p->arrived == barrier_p->thread_count) {
+      barrier_p->arrived = 0;
+      barrier_p->generation++;
+      pthread_cond_broadcast(&barrier_p->cond);
+      serial = 1;
+   } else {
+      while (gen == barrier_p->generation)
+         pthread_cond_wait(&barrier_p->cond, &barrier_p->mutex);
+   }
+   pthread_mutex_unlock(&barrier_p->mutex);
+   return serial;
+}  /* Cond_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Futex_cond_wait
+ * Propósito:   Cond_wait con fx_mutex y fx_cond, como futex_barrier.c con
+ *              cond: el broadcast pasa a los dormidos a la cola del mutex
+ */
+static int Futex_cond_wait(barrier_t* barrier_p) {
+   int gen, serial = 0;
+
+   fx_mutex_lock(&barrier_p->fx_mutex);
+   gen = barrier_p->generation;
+   if (++barrier_p->arrived == barrier_p->thread_count) {
+      barrier_p->arrived = 0;
+      barrier_p->generation++;
+      fx_cond_broadcast(&barrier_p->fx_cond);
+      serial = 1;
+   } else {
+      while (gen == barrier_p->generation)
+         fx_cond_wait(&barrier_p->fx_cond, &barrier_p->fx_mutex);
+   }
+   fx_mutex_unlock(&barrier_p->fx_mutex);
+   return serial;
+}  /* Futex_cond_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Sem_wait
+ * Propósito:   semaphores_barrier.c: count_sem protege a arrived y el
+ *              último hace thread_count - 1 sem_post sobre el semáforo de
+ *              liberación del episodio
+ */
+static int Sem_wait(barrier_t* barrier_p, struct barrier_slot_s* my_slot) {
+   sem_t* release_p = &barrier_p->release_sems[my_slot->parity];
+   int serial = 0, j;
+
+   my_slot->parity = 1 - my_slot->parity;
+   sem_wait(&barrier_p->count_sem);
+   if (barrier_p->arrived == barrier_p->thread_count - 1) {
+      barrier_p->arrived = 0;
+      sem_post(&barrier_p->count_sem);
+      for (j = 0; j < barrier_p->thread_count - 1; j++)
+         sem_post(release_p);
+      serial = 1;
+   } else {
+      barrier_p->arrived++;
+      sem_post(&barrier_p->count_sem);
+      sem_wait(release_p);
+   }
+   return serial;
+}  /* Sem_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:     Tree_arrive
+ * Propósito:   Llegar al nodo n. El último en llegar sube al padre y, al
+ *              volver, libera a los que esperan en n.
+ * Val Retorno: 1 si el thread completó la raíz
+ */
+static int Tree_arrive(barrier_t* barrier_p, int n, int sense) {
+   struct barrier_node_s* node_p = &barrier_p->nodes[n];
+   int serial;
+
+   if (__atomic_sub_fetch(&node_p->count, 1, __ATOMIC_ACQ_REL) == 0) {
+      serial = node_p->parent < 0 ? 1 :
+         Tree_arrive(barrier_p, node_p->parent, sense);
+      __atomic_store_n(&node_p->count, node_p->fan_in, __ATOMIC_RELAXED);
+      __atomic_store_n(&node_p->sense, sense, __ATOMIC_RELEASE);
+      return serial;
+   }
+   Spin_until(&node_p->sense, sense);
+   return 0;
+}  /* Tree_arrive */
+
+/*-----------------------------------------------------------------*/
+static int Tournament_wait(barrier_t* barrier_p, int rank, int sense) {
+   struct barrier_slot_s* slots = barrier_p->slots;
+   int k, j, step;
+
+   /* Llegada: subir mientras se gana */
+   for (k = 0, step = 1; k < barrier_p->rounds; k++, step *= 2) {
+      if (rank % (2*step) == 0) {
+         if (rank + step < barrier_p->thread_count)
+            Spin_until(&slots[rank].arrive[k], sense);
+      } else {
+         __atomic_store_n(&slots[rank - step].arrive[k], sense,
+               __ATOMIC_RELEASE);
+         Spin_until(&slots[rank].wake, sense);
+         break;
+      }
+   }
+
+   /* Liberación: despertar a los que se les ganó, del último al primero */
+   for (j = k - 1; j >= 0; j--)
+      if (rank + (1 << j) < barrier_p->thread_count)
+         __atomic_store_n(&slots[rank + (1 << j)].wake, sense,
+               __ATOMIC_RELEASE);
+   return rank == 0;
+}  /* Tournament_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:     barrier_wait
+ * Propósito:   Esperar a que lleguen los thread_count threads
+ * Val Retorno: 1 en exactamente un thread por episodio, 0 en los demás
+ */
+int barrier_wait(barrier_t* barrier_p, int rank) {
+   struct barrier_slot_s* my_slot = &barrier_p->slots[rank];
+   int sense = my_slot->sense;
+   int serial = 0, k, partner;
+
+   switch (barrier_p->kind) {
+      case BARRIER_BUSY:
+         return Busy_wait(barrier_p);
+      case BARRIER_COND:
+         return Cond_wait(barrier_p);
+      case BARRIER_SEM:
+         return Sem_wait(barrier_p, my_slot);
+      case BARRIER_FUTEX:
+         return fx_barrier_wait(&barrier_p->fx);
+      case BARRIER_FUTEX_COND:
+         return Futex_cond_wait(barrier_p);
+      case BARRIER_SENSE:
+         if (__atomic_sub_fetch(&barrier_p->count, 1, __ATOMIC_ACQ_REL) == 0) {
+            __atomic_store_n(&barrier_p->count, barrier_p->thread_count,
+                  __ATOMIC_RELAXED);
+            __atomic_store_n(&barrier_p->sense, sense, __ATOMIC_RELEASE);
+            serial = 1;
+         } else {
+            Spin_until(&barrier_p->sense, sense);
+         }
+         break;
+      case BARRIER_TREE:
+         serial = Tree_arrive(barrier_p, rank/BARRIER_FAN_IN, sense);
+         break;
+      case BARRIER_DISSEMINATION:
+         for (k = 0; k < barrier_p->rounds; k++) {
+            partner = (rank + (1 << k)) % barrier_p->thread_count;
+            __atomic_store_n(
+                  &barrier_p->slots[partner].flags[my_slot->parity][k],
+                  sense, __ATOMIC_RELEASE);
+            Spin_until(&my_slot->flags[my_slot->parity][k], sense);
+         }
+         serial = rank == 0;
+         /* Cada juego de banderas se usa un episodio sí y otro no */
+         if (my_slot->parity == 1) my_slot->sense = !sense;
+         my_slot->parity = 1 - my_slot->parity;
+         return serial;
+      case BARRIER_TOURNAMENT:
+         serial = Tournament_wait(barrier_p, rank, sense);
+         break;
+      default:
+         break;
+   }
+   my_slot->sense = !sense;
+   return serial;
+}  /* barrier_wait */
+
+/*-----------------------------------------------------------------*/
+void barrier_destroy(barrier_t* barrier_p) {
+   switch (barrier_p->kind) {
+      case BARRIER_BUSY:
+         pthread_mutex_destroy(&barrier_p->mutex);
+         break;
+      case BARRIER_COND:
+         pthread_mutex_destroy(&barrier_p->mutex);
+         pthread_cond_destroy(&barrier_p->cond);
+         break;
+      case BARRIER_SEM:
+         sem_destroy(&barrier_p->count_sem);
+         sem_destroy(&barrier_p->release_sems[0]);
+         sem_destroy(&barrier_p->release_sems[1]);
+         break;
+      default:
+         break;
+   }
+   free(barrier_p->slots);
+   free(barrier_p->nodes);
+   barrier_p->slots = NULL;
+   barrier_p->nodes = NULL;
+}  /* barrier_destroy */
@@ -0,0 +1,106 @@
+/* Archivo:   barriers.h
+ * Propósito: Archivo de cabecera para barriers.c, que implementa varias
+ *            barreras intercambiables en tiempo de ejecución:
+ *
+ *            busy           Contador protegido por un mutex y espera activa
+ *                           (busy_barrier.c)
+ *            cond           Mutex y variable de condición (condition_barrier.c)
+ *            sem            Semáforos (semaphores_barrier.c), con dos
+ *                           semáforos de liberación alternados en lugar de
+ *                           uno por barrera
+ *            sense          Contador atómico con inversión de sentido: todos
+ *                           los threads esperan sobre la misma bandera
+ *            tree           Árbol de combinación de grado BARRIER_FAN_IN: el
+ *                           último en llegar a un nodo sube al padre, y la
+ *                           liberación baja por el árbol
+ *            dissemination  Diseminación (Hensgen, Finkel y Manber): en la
+ *                           ronda k el thread i avisa a (i + 2^k) mod P
+ *            tournament     Torneo estático: en cada ronda el perdedor avisa
+ *                           al ganador y espera a que lo despierte
+ *            futex          fx_barrier de futex_sync.c: espera activa breve
+ *                           y después FUTEX_WAIT sobre una generación
+ *            futex-cond     El algoritmo de cond con fx_mutex y fx_cond de
+ *                           futex_sync.c (futex_barrier.c con cond)
+ *
+ *            tree, dissemination y tournament esperan sobre banderas en una
+ *            línea de cache propia (o de su nodo del árbol), y la latencia
+ *            crece como O(log P) en lugar de O(P).
+ *
+ *            Todas se pueden reutilizar cualquier número de veces.
+ *
+ * Nota:      rank debe estar en [0, thread_count) y ser distinto en cada
+ *            thread. Las que esperan activamente ceden la CPU cada tanto,
+ *            así que funcionan (lento) con más threads que núcleos.
+ */
+#ifndef _BARRIERS_H_
+#define _BARRIERS_H_
+
+#include <pthread.h>
+#include <semaphore.h>
+#include "futex_sync.h"
+
+#define BARRIER_CACHE_LINE 64
+#define BARRIER_MAX_ROUNDS 32
+#define BARRIER_FAN_IN     4
+#define BARRIER_FUTEX_SPIN 1000
+
+typedef enum { BARRIER_BUSY, BARRIER_COND, BARRIER_SEM, BARRIER_SENSE,
+   BARRIER_TREE, BARRIER_DISSEMINATION, BARRIER_TOURNAMENT, BARRIER_FUTEX,
+   BARRIER_FUTEX_COND, BARRIER_KINDS } barrier_kind_t;
+
+/* Estado de un thread; las banderas las escriben sus compañeros */
+struct barrier_slot_s {
+   int sense;                         /* Sentido local */
+   int parity;                        /* dissemination, sem */
+   int flags[2][BARRIER_MAX_ROUNDS];  /* dissemination */
+   int arrive[BARRIER_MAX_ROUNDS];    /* tournament: llegó el perdedor */
+   int wake;                          /* tournament: liberación */
+} __attribute__((aligned(BARRIER_CACHE_LINE)));
+
+/* Nodo del árbol de combinación */
+struct barrier_node_s {
+   int count __attribute__((aligned(BARRIER_CACHE_LINE)));
+   int fan_in;
+   int parent;                        /* -1 en la raíz */
+   int sense __attribute__((aligned(BARRIER_CACHE_LINE)));
+};
+
+typedef struct {
+   barrier_kind_t kind;
+   int thread_count;
+   int rounds;                        /* ceil(log2(thread_count)) */
+   struct barrier_slot_s* slots;
+
+   /* busy, cond, sem, futex-cond: arrived y generation se protegen con
+    * el mutex, con fx_mutex o con count_sem */
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   sem_t count_sem;
+   sem_t release_sems[2];
+   int arrived;
+   int generation __attribute__((aligned(BARRIER_CACHE_LINE)));
+
+   /* sense */
+   int count __attribute__((aligned(BARRIER_CACHE_LINE)));
+   int sense __attribute__((aligned(BARRIER_CACHE_LINE)));
+
+   /* futex */
+   fx_barrier_t fx;
+
+   /* futex-cond */
+   fx_mutex_t fx_mutex;
+   fx_cond_t  fx_cond;
+
+   /* tree: las hojas son los primeros nodos del arreglo */
+   struct barrier_node_s* nodes;
+   int node_count;
+} barrier_t;
+
+int  barrier_parse_kind(const char* name, barrier_kind_t* kind_p);
+const char* barrier_kind_name(barrier_kind_t kind);
+void barrier_init(barrier_t* barrier_p, barrier_kind_t kind,
+      int thread_count);
+int  barrier_wait(barrier_t* barrier_p, int rank);
+void barrier_destroy(barrier_t* barrier_p);
+
+#endif
@@ -0,0 +1,194 @@
+/* Archivo:   batch.c
+ *
+ * Propósito: Implementar las operaciones por lotes compartidas por los
+ *            programas de listas enlazadas (ver batch.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_OneMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. Las keys de la carga inicial salen de my_rand con semilla 1, como
+ *       en los programas originales: con los mismos argumentos la lista
+ *       inicial es siempre la misma.
+ *    2. Con un pool, main genera cada lote y pool_parallel_for lo reparte
+ *       en un trozo por thread. Cada thread del pool, ya fijado con
+ *       af_bind, inserta su trozo con Insert_many, así que malloc toca
+ *       los nodos nuevos desde ese thread y quedan en su nodo NUMA (first
+ *       touch). Por eso Insert_many debe poder ejecutarse en varios
+ *       threads a la vez.
+ *    3. Después de la carga, si el programa tiene Member_many y
+ *       Delete_many, bt_load los prueba con las primeras BT_CHECK_KEYS
+ *       keys de la semilla 1, que están todas en la lista: se buscan, se
+ *       elimina la mitad, ya no tienen que estar y se vuelven a insertar.
+ *       La lista queda igual. Ante un error el programa aborta.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "my_rand.h"
+#include "batch.h"
+
+/*-----------------------------------------------------------------*/
+static void* Alloc(size_t bytes) {
+   void* p = malloc(bytes > 0 ? bytes : 1);
+
+   if (p == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   return p;
+}  /* Alloc */
+
+/*-----------------------------------------------------------------*/
+static int Compare_int(const void* a_p, const void* b_p) {
+   int a = *((const int*) a_p);
+   int b = *((const int*) b_p);
+   return (a > b) - (a < b);
+}  /* Compare_int */
+
+/*-----------------------------------------------------------------*/
+static int Compare_pair(const void* a_p, const void* b_p) {
+   return Compare_int(&((const bt_pair_t*) a_p)->key,
+         &((const bt_pair_t*) b_p)->key);
+}  /* Compare_pair */
+
+/*-----------------------------------------------------------------*/
+/* Función:     bt_sorted_copy
+ * Propósito:   Copiar y ordenar un lote de keys, para mezclarlo con la
+ *              lista en un solo recorrido
+ * Val Retorno: La copia ordenada (liberar con free)
+ */
+int* bt_sorted_copy(const int values[], int n) {
+   int* sorted = Alloc(n*sizeof(int));
+   int i;
+
+   for (i = 0; i < n; i++)
+      sorted[i] = values[i];
+   qsort(sorted, n, sizeof(int), Compare_int);
+   return sorted;
+}  /* bt_sorted_copy */
+
+/*-----------------------------------------------------------------*/
+/* Función:     bt_sorted_pairs
+ * Propósito:   Ordenar las keys de un lote recordando su posición, y
+ *              poner en cero el bitmap de BT_BITMAP_BYTES(n) bytes
+ * Val Retorno: Los pares ordenados por key (liberar con free)
+ */
+bt_pair_t* bt_sorted_pairs(const int values[], int n,
+      unsigned char bitmap[]) {
+   bt_pair_t* pairs = Alloc(n*sizeof(bt_pair_t));
+   int i;
+
+   for (i = 0; i < n; i++) {
+      pairs[i].key = values[i];
+      pairs[i].idx = i;
+   }
+   qsort(pairs, n, sizeof(bt_pair_t), Compare_pair);
+   for (i = 0; i < BT_BITMAP_BYTES(n); i++)
+      bitmap[i] = 0;
+   return pairs;
+}  /* bt_sorted_pairs */
+
+/*-----------------------------------------------------------------*/
+void bt_set(unsigned char bitmap[], int i) {
+   bitmap[i/8] |= 1 << (i % 8);
+}  /* bt_set */
+
+/*-----------------------------------------------------------------*/
+static void Batch_error(const char* msg, long got, long expected) {
+   fprintf(stderr, "Error en las operaciones por lotes: %s (%ld, se "
+         "esperaba %ld)\n", msg, got, expected);
+   abort();
+}  /* Batch_error */
+
+/*-----------------------------------------------------------------*/
+/* Función:    Check_batch
+ * Propósito:  Probar Member_many y Delete_many con keys que están en la
+ *             lista, y dejarla como estaba (ver nota 3)
+ */
+static void Check_batch(const bt_ops_t* ops, int keys[], int n,
+      int max_key) {
+   unsigned char* bitmap = Alloc(BT_BITMAP_BYTES(n));
+   unsigned seed = 1;
+   int* sorted;
+   int i, found, distinct = 0, deleted, reinserted;
+
+   for (i = 0; i < n; i++)
+      keys[i] = my_rand(&seed) % max_key;
+   sorted = bt_sorted_copy(keys, n/2);
+
+   found = ops->member_many(keys, n, bitmap);
+   if (found != n) Batch_error("Member_many no encontró el lote", found, n);
+   for (i = 0; i < n; i++)
+      if (!BT_BIT(bitmap, i)) Batch_error("bit en cero", i, 1);
+
+   for (i = 0; i < n/2; i++)
+      if (i == 0 || sorted[i] != sorted[i-1]) distinct++;
+   deleted = ops->delete_many(keys, n/2);
+   if (deleted != distinct)
+      Batch_error("Delete_many eliminó otra cantidad", deleted, distinct);
+   found = ops->member_many(keys, n/2, bitmap);
+   if (found != 0)
+      Batch_error("Member_many encontró keys eliminadas", found, 0);
+   reinserted = ops->insert_many(keys, n/2);
+   if (reinserted != deleted)
+      Batch_error("Insert_many no repuso el lote", reinserted, deleted);
+
+   printf("Verificación de lotes correcta: %d keys\n", n);
+   free(sorted);
+   free(bitmap);
+}  /* Check_batch */
+
+/*-----------------------------------------------------------------*/
+/* Argumento de Load_slice: un lote y el total insertado */
+struct load_arg_s {
+   const bt_ops_t* ops;
+   int* keys;
+   long inserted;
+};
+
+/* Insertar el trozo [first, last) del lote desde un thread del pool */
+static void Load_slice(long first, long last, void* arg) {
+   struct load_arg_s* load = (struct load_arg_s*) arg;
+   int inserted = load->ops->insert_many(load->keys + first, last - first);
+
+   __atomic_fetch_add(&load->inserted, inserted, __ATOMIC_RELAXED);
+}  /* Load_slice */
+
+/*-----------------------------------------------------------------*/
+/* Función:     bt_load
+ * Propósito:   Intentar insertar count keys distintas, menores que
+ *              max_key, en lotes que se mezclan con Insert_many en un
+ *              solo recorrido. Abandona después de 2*count intentos.
+ * En arg:      pool: si no es NULL, los lotes se insertan en sus threads
+ *              (ver nota 2); si es NULL, en el thread de llamada
+ * Val Retorno: Número de keys insertadas
+ */
+long bt_load(const bt_ops_t* ops, pool_t* pool, int count, int max_key) {
+   struct load_arg_s load;
+   unsigned seed = 1;
+   long attempts = 0;
+   int j, batch, slice;
+
+   load.ops = ops;
+   load.keys = Alloc(count*sizeof(int));
+   load.inserted = 0;
+   while (load.inserted < count && attempts < 2L*count) {
+      batch = count - load.inserted;
+      if (batch > 2L*count - attempts)
+         batch = 2L*count - attempts;
+      for (j = 0; j < batch; j++)
+         load.keys[j] = my_rand(&seed) % max_key;
+      if (pool != NULL) {
+         slice = (batch + pool->thread_count - 1)/pool->thread_count;
+         pool_parallel_for(pool, 0, batch, slice, Load_slice, &load);
+      } else {
+         Load_slice(0, batch, &load);
+      }
+      attempts += batch;
+   }
+   if (ops->member_many != NULL && ops->delete_many != NULL && count > 0)
+      Check_batch(ops, load.keys,
+            count < BT_CHECK_KEYS ? count : BT_CHECK_KEYS, max_key);
+   free(load.keys);
+   return load.inserted;
+}  /* bt_load */
@@ -0,0 +1,46 @@
+/* Archivo:   batch.h
+ * Propósito: Archivo de cabecera para batch.c, las operaciones por lotes
+ *            de los programas de listas enlazadas: copias ordenadas de un
+ *            lote de keys, la carga inicial de la lista con Insert_many y
+ *            una verificación de Member_many y Delete_many.
+ *
+ *            Cada programa describe sus operaciones por lotes con un
+ *            bt_ops_t; member_many y delete_many pueden ser NULL.
+ *
+ * Ejemplo:
+ *    bt_ops_t ops = { Insert_many, Member_many, Delete_many };
+ *    . . .
+ *    pool_init(&pool, thread_count, &placement);
+ *    inserted = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
+ *
+ * Nota:      El bitmap de Member_many tiene BT_BITMAP_BYTES(n) bytes; el
+ *            bit de values[i] es BT_BIT(bitmap, i).
+ */
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "pool.h"
+
+#define BT_CHECK_KEYS       1000
+
+#define BT_BITMAP_BYTES(n)  (((n) + 7)/8)
+#define BT_BIT(bitmap, i)   (((bitmap)[(i)/8] >> ((i) % 8)) & 1)
+
+/* Par key/posición en el lote, para Member_many */
+typedef struct {
+   int key;
+   int idx;
+} bt_pair_t;
+
+typedef struct {
+   int (*insert_many)(int values[], int n);
+   int (*member_many)(int values[], int n, unsigned char bitmap[]);
+   int (*delete_many)(int values[], int n);
+} bt_ops_t;
+
+int*       bt_sorted_copy(const int values[], int n);
+bt_pair_t* bt_sorted_pairs(const int values[], int n, unsigned char bitmap[]);
+void       bt_set(unsigned char bitmap[], int i);
+long       bt_load(const bt_ops_t* ops, pool_t* pool, int count, int max_key);
+
+#endif
@@ -10,12 +10,16 @@
  *    Time for BARRIER_COUNT barriers
  *
  * Compilar:
- *    gcc -g -Wall -o ejecutable busy_barrier.c -lpthread
+ *    gcc -g -Wall -o ejecutable busy_barrier.c lock_prof.c -lpthread
  * Ejecutar:
  *    ./ejecutable <thread_count>
  *
  * Nota:
  *    El flag compilacion DEBUG imprimirá un mensaje después de cada barrera    
+ *    Con -DLOCK_PROF se imprime al salir la contención de barrier_mutex
+ *    Cada contador ocupa su propia línea de cache y es volatile, para que
+ *    la espera activa vuelva a leerlo aun compilando con -O2. Con
+ *    -DNO_PADDING se empaquetan (cacheline.h)
  *
  * IPP:   Sección 4.8.1 (págs. 177)
  */
@@ -24,12 +28,21 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
 
 #define BARRIER_COUNT 100
 
+/* Contador de una barrera, solo en su línea de cache: los threads que
+ * esperan en la barrera i no se ven invalidados por los que ya llegan
+ * a la barrera i+1 */
+struct barrier_count_s {
+   volatile int count;
+} __attribute__((aligned(SHARED_ALIGN)));
+
 int thread_count;
-int barrier_thread_counts[BARRIER_COUNT];
-pthread_mutex_t barrier_mutex;
+struct barrier_count_s barrier_thread_counts[BARRIER_COUNT];
+struct padded_mutex_s barrier_mutex;
 
 void Usage(char* prog_name);
 void *Thread_work(void* rank);
@@ -46,8 +59,8 @@ int main(int argc, char* argv[]) {
 
    thread_handles = malloc (thread_count*sizeof(pthread_t));
    for (i = 0; i < BARRIER_COUNT; i++)
-      barrier_thread_counts[i] = 0;
-   pthread_mutex_init(&barrier_mutex, NULL);
+      barrier_thread_counts[i].count = 0;
+   prof_mutex_init(&barrier_mutex.mutex, "barrier_mutex");
 
    GET_TIME(start);
    for (thread = 0; thread < thread_count; thread++)
@@ -60,7 +73,7 @@ int main(int argc, char* argv[]) {
    GET_TIME(finish);
    printf("Tiempo transcurrido = %e segundos\n", finish - start);
 
-   pthread_mutex_destroy(&barrier_mutex);
+   prof_mutex_destroy(&barrier_mutex.mutex);
    free(thread_handles);
    return 0;
 }  /* main */
@@ -93,10 +106,10 @@ void *Thread_work(void* rank) {
 
    for (i = 0; i < BARRIER_COUNT; i++) {
       // Barrera
-      pthread_mutex_lock(&barrier_mutex);
-      barrier_thread_counts[i]++;
-      pthread_mutex_unlock(&barrier_mutex);
-      while (barrier_thread_counts[i] < thread_count);
+      prof_mutex_lock(&barrier_mutex.mutex);
+      barrier_thread_counts[i].count++;
+      prof_mutex_unlock(&barrier_mutex.mutex);
+      while (barrier_thread_counts[i].count < thread_count);
 #     ifdef DEBUG
       if (my_rank == 0) {
          printf("Todos los threads entraron en la barrera %d\n", i);
@@ -0,0 +1,38 @@
+/* Archivo:   cacheline.h
+ * Propósito: Alineación a línea de cache de los datos que varios threads
+ *            escriben dentro del loop principal: los contadores de
+ *            busy_barrier.c, los mutex que usan todos los threads de las
+ *            listas enlazadas y las sublistas de listaEnlazada_Particionada.c.
+ *
+ *            Cada uno de esos datos ocupa su propia línea, así la escritura
+ *            de un thread no invalida la línea que otro thread está usando
+ *            para otra cosa (false sharing). Lo que cada thread escribe una
+ *            sola vez, como los contadores de operaciones que main suma al
+ *            final, no necesita relleno.
+ *
+ *            Con -DNO_PADDING los mismos datos quedan empaquetados, para
+ *            medir el efecto con comparar_relleno.sh (ver false_sharing.c).
+ *
+ * Ejemplo:
+ *    struct padded_mutex_s list_mutex;
+ *    prof_mutex_init(&list_mutex.mutex, "lista");
+ */
+#ifndef _CACHELINE_H_
+#define _CACHELINE_H_
+
+#include "lock_prof.h"
+
+#define CACHE_LINE 64
+
+#ifdef NO_PADDING
+#define SHARED_ALIGN 8
+#else
+#define SHARED_ALIGN CACHE_LINE
+#endif
+
+/* Un mutex que usan todos los threads, solo en su línea de cache */
+struct padded_mutex_s {
+   prof_mutex_t mutex;
+} __attribute__((aligned(SHARED_ALIGN)));
+
+#endif
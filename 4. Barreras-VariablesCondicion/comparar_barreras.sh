@@ -0,0 +1,48 @@
+#!/bin/sh
+# Archivo:   comparar_barreras.sh
+#
+# Propósito: Comparar las barreras de busy_barrier.c, condition_barrier.c,
+#            semaphores_barrier.c, sense_barrier.c y futex_barrier.c (con
+#            fx_barrier y con fx_cond) variando el número de threads. Cada
+#            una se ejecuta con barrier_driver, que crea los threads una
+#            sola vez en un pool y mide EPISODES barreras sin contar
+#            pthread_create ni pthread_join. Imprime los nanosegundos por
+#            barrera del mejor de REPS tiempos de cada una.
+#
+# Ejecutar:  ./comparar_barreras.sh [directorio con barrier_driver]
+#            EPISODES (por defecto 100000) y REPS (por defecto 5) se
+#            pueden cambiar con variables de entorno.
+#
+# Compilar antes con:
+#    gcc -O2 -g -Wall -o barrier_driver barrier_driver.c barriers.c futex_sync.c pool.c latency.c my_rand.c -lpthread
+
+DIR=${1:-.}
+REPS=${REPS:-5}
+EPISODES=${EPISODES:-100000}
+MAX_THREADS=$(( 2 * $(nproc 2>/dev/null || echo 4) ))
+KINDS="busy cond sem sense futex futex-cond"
+
+best_time() {
+   i=0
+   while [ "$i" -lt "$REPS" ]; do
+      "$DIR/barrier_driver" "$@" "$EPISODES" 2>/dev/null |
+            awk '/^Tiempo transcurrido/ { print $4 }'
+      i=$((i + 1))
+   done | sort -g | head -n 1
+}
+
+printf "%8s" "threads"
+for kind in $KINDS; do
+   printf " %11s" "$kind"
+done
+printf "\n"
+threads=1
+while [ "$threads" -le "$MAX_THREADS" ]; do
+   printf "%8d" "$threads"
+   for kind in $KINDS; do
+      best=$(best_time "$kind" "$threads")
+      printf " %11.1f" "$(echo "$best $EPISODES" | awk '{ print 1.0e9*$1/$2 }')"
+   done
+   printf "\n"
+   threads=$((threads * 2))
+done
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Archivo:   comparar_relleno.sh
+#
+# Propósito: Comparar un programa compilado con relleno de línea de cache
+#            (por defecto) y con -DNO_PADDING, con los mismos argumentos.
+#            Imprime el mejor tiempo de REPS ejecuciones de cada uno.
+#
+# Ejecutar:  ./comparar_relleno.sh <con relleno> <sin relleno> [args...]
+#            Por ejemplo:
+#            ./comparar_relleno.sh ./busy ./busy_np 8
+#            ./comparar_relleno.sh ./lista ./lista_np 8 -k 1000 -o 400000
+#
+# Compilar antes las dos versiones, por ejemplo:
+#    gcc -O2 -g -Wall -o busy busy_barrier.c lock_prof.c -lpthread
+#    gcc -O2 -g -Wall -DNO_PADDING -o busy_np busy_barrier.c lock_prof.c -lpthread
+
+if [ $# -lt 2 ]; then
+   echo "Usar: $0 <con relleno> <sin relleno> [args...]" >&2
+   exit 1
+fi
+PADDED=$1
+PACKED=$2
+shift 2
+REPS=${REPS:-5}
+
+best_time() {
+   prog=$1
+   shift
+   i=0
+   while [ "$i" -lt "$REPS" ]; do
+      "$prog" "$@" | awk '/^Tiempo transcurrido/ { print $4 }'
+      i=$((i + 1))
+   done | sort -g | head -n 1
+}
+
+t_padded=$(best_time "$PADDED" "$@")
+t_packed=$(best_time "$PACKED" "$@")
+printf "%-14s %14s\n" "versión" "segundos"
+printf "%-14s %14s\n" "con relleno" "$t_padded"
+printf "%-14s %14s\n" "sin relleno" "$t_packed"
+awk -v a="$t_packed" -v b="$t_padded" \
+   'BEGIN { if (b > 0) printf "sin / con = %.2f\n", a / b }'
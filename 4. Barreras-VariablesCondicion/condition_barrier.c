@@ -5,7 +5,7 @@
  *    Use condition wait barriers to synchronize threads.
  *
  * Compilar:
- *    gcc -g -Wall -o ejecutable condition_barrier.c -lpthread
+ *    gcc -g -Wall -o ejecutable condition_barrier.c lock_prof.c -lpthread
  *    timer.h debe estar disponible
  *
  * Ejecutar:
@@ -18,6 +18,8 @@
  *
  * Nota:    
  *    Verbose output can be enabled with the compile flag -DDEBUG
+ *    Con -DLOCK_PROF se imprime al salir la contención de barrier_mutex
+ *    (el tiempo dormido en ok_to_proceed no cuenta como espera)
  *
  * IPP:   Sección 4.8.3 (págs. 179 y sigs.)
  */
@@ -26,12 +28,13 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include "timer.h"
+#include "lock_prof.h"
 
 #define BARRIER_COUNT 100
 
 int thread_count;
 int barrier_thread_count = 0;
-pthread_mutex_t barrier_mutex;
+prof_mutex_t barrier_mutex;
 pthread_cond_t ok_to_proceed;
 
 void Usage(char* prog_name);
@@ -48,7 +51,7 @@ int main(int argc, char* argv[]) {
    thread_count = strtol(argv[1], NULL, 10);
 
    thread_handles = malloc (thread_count*sizeof(pthread_t));
-   pthread_mutex_init(&barrier_mutex, NULL);
+   prof_mutex_init(&barrier_mutex, "barrier_mutex");
    pthread_cond_init(&ok_to_proceed, NULL);
 
    GET_TIME(start);
@@ -62,7 +65,7 @@ int main(int argc, char* argv[]) {
    GET_TIME(finish);
    printf("Tiempo transcurrido = %e segundos\n", finish - start);
 
-   pthread_mutex_destroy(&barrier_mutex);
+   prof_mutex_destroy(&barrier_mutex);
    pthread_cond_destroy(&ok_to_proceed);
    free(thread_handles);
    return 0;
@@ -97,7 +100,7 @@ void *Thread_work(void* rank) {
 
    for (i = 0; i < BARRIER_COUNT; i++) {
       // Barrera
-      pthread_mutex_lock(&barrier_mutex);
+      prof_mutex_lock(&barrier_mutex);
       barrier_thread_count++;
       if (barrier_thread_count == thread_count) {
          barrier_thread_count = 0;
@@ -111,7 +114,7 @@ void *Thread_work(void* rank) {
          // Espere desbloquea el mutex y pone el thread en sleep.
          // Ponga esperar en el ciclo while en caso de que algún otro
          // evento despierte el hilo.
-         while (pthread_cond_wait(&ok_to_proceed,
+         while (prof_cond_wait(&ok_to_proceed,
                    &barrier_mutex) != 0);
          // Mutex se vuelve a bloquear en este punto.
 #        ifdef DEBUG
@@ -119,7 +122,7 @@ void *Thread_work(void* rank) {
          fflush(stdout);
 #        endif
       }
-      pthread_mutex_unlock(&barrier_mutex);
+      prof_mutex_unlock(&barrier_mutex);
 #     ifdef DEBUG
       if (my_rank == 0) {
          printf("Todos los threads completaron la barrera %d\n", i);
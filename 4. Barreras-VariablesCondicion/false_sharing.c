@@ -0,0 +1,140 @@
+/* Archivo:   false_sharing.c
+ *
+ * Propósito: Medir el costo del false sharing: cada thread incrementa
+ *            solo su propio contador, pero los contadores pueden estar
+ *            empaquetados en la misma línea de cache, cada uno en su
+ *            propia línea, o acumularse en una variable local y escribirse
+ *            una vez al final (como hacen ahora los programas de listas).
+ *
+ * Compilar:  gcc -O2 -g -Wall -o false_sharing false_sharing.c -lpthread
+ *            se necesita timer.h
+ * Ejecutar:  ./false_sharing <thread_count> [incrementos por thread]
+ *
+ * Entrada:   Ninguna
+ * Salida:    Tiempo y ns por incremento de cada esquema, y la razón
+ *            empaquetado/relleno
+ *
+ * Notas:
+ *    1. Los incrementos pasan por un puntero volatile para que el
+ *       compilador no los acumule en un registro.
+ *    2. Con un solo núcleo no hay false sharing: los tres esquemas
+ *       cuestan lo mismo. La diferencia aparece con threads en núcleos
+ *       distintos.
+ *    3. Para ver el efecto en los programas existentes, compilar
+ *       busy_barrier.c o listaEnlazada_*.c con y sin -DNO_PADDING y
+ *       compararlos con comparar_relleno.sh.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "timer.h"
+
+#define CACHE_LINE 64
+#define DEFAULT_ITERATIONS 100000000L
+
+/* Esquemas que se miden */
+enum { PACKED, PADDED, LOCAL, SCHEMES };
+const char* scheme_names[] = { "empaquetado", "con relleno", "local" };
+
+struct padded_counter_s {
+   long count;
+} __attribute__((aligned(CACHE_LINE)));
+
+int thread_count;
+long iterations;
+int scheme;
+long* packed;                         /* thread_count longs seguidos */
+struct padded_counter_s* padded;      /* uno por línea de cache */
+
+void Usage(char* prog_name);
+void* Thread_work(void* rank);
+
+/*-----------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long thread;
+   pthread_t* thread_handles;
+   double start, finish, elapsed[SCHEMES];
+   long total;
+
+   if (argc != 2 && argc != 3) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   iterations = argc == 3 ? strtol(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+   if (thread_count <= 0 || iterations <= 0) Usage(argv[0]);
+
+   thread_handles = malloc(thread_count*sizeof(pthread_t));
+   if (posix_memalign((void**) &packed, CACHE_LINE,
+            thread_count*sizeof(long)) != 0 ||
+         posix_memalign((void**) &padded, CACHE_LINE,
+            thread_count*sizeof(struct padded_counter_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+
+   printf("%d threads, %ld incrementos por thread\n", thread_count, iterations);
+   for (scheme = 0; scheme < SCHEMES; scheme++) {
+      for (thread = 0; thread < thread_count; thread++) {
+         packed[thread] = 0;
+         padded[thread].count = 0;
+      }
+
+      GET_TIME(start);
+      for (thread = 0; thread < thread_count; thread++)
+         pthread_create(&thread_handles[thread], NULL, Thread_work,
+               (void*) thread);
+      for (thread = 0; thread < thread_count; thread++)
+         pthread_join(thread_handles[thread], NULL);
+      GET_TIME(finish);
+      elapsed[scheme] = finish - start;
+
+      /* Sumar después del join, como los programas de listas */
+      total = 0;
+      for (thread = 0; thread < thread_count; thread++)
+         total += scheme == PACKED ? packed[thread] : padded[thread].count;
+      printf("   %-12s %e segundos  %8.3f ns/incremento  (total %ld)\n",
+            scheme_names[scheme], elapsed[scheme],
+            1.0e9*elapsed[scheme]/iterations, total);
+   }
+   printf("Empaquetado / con relleno = %.2f\n",
+         elapsed[PACKED]/elapsed[PADDED]);
+
+   free(packed);
+   free(padded);
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+/*-----------------------------------------------------------------*/
+void Usage(char* prog_name) {
+   fprintf(stderr, "Usar: %s <thread_count> [incrementos por thread]\n",
+         prog_name);
+   exit(0);
+}  /* Usage */
+
+/*-----------------------------------------------------------------
+ * Función:     Thread_work
+ * Propósito:   Incrementar iterations veces el contador del thread
+ *              según el esquema actual
+ * En arg:      rank
+ * Var Global:  iterations, scheme, packed, padded
+ * Val Retorno: Ignorado
+ */
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   volatile long* my_counter;
+   long i, my_count;
+
+   if (scheme == LOCAL) {
+      my_count = 0;
+      my_counter = &my_count;
+      for (i = 0; i < iterations; i++)
+         (*my_counter)++;
+      padded[my_rank].count = my_count;
+   } else {
+      my_counter = scheme == PACKED ? &packed[my_rank]
+                                    : &padded[my_rank].count;
+      for (i = 0; i < iterations; i++)
+         (*my_counter)++;
+   }
+
+   return NULL;
+}  /* Thread_work */
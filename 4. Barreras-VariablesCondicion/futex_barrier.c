@@ -0,0 +1,157 @@
+/* Archivo:
+ *    futex_barrier.c
+ *
+ * Propósito:
+ *    Sincronizar threads con barreras construidas sobre futex de Linux
+ *    (futex_sync.c), para compararlas con las versiones POSIX de
+ *    condition_barrier.c y semaphores_barrier.c.
+ *
+ * Entrada:
+ *    Ninguna
+ * Salida:
+ *    Time for BARRIER_COUNT barriers
+ *
+ * Compilar:
+ *    gcc -O2 -g -Wall -o ejecutable futex_barrier.c futex_sync.c -lpthread
+ *    timer.h y futex_sync.h deben estar disponibles
+ *
+ * Ejecutar:
+ *    ./ejecutable <thread_count> [barrier|cond] [spin]
+ *    barrier: fx_barrier, una palabra de generación y un FUTEX_WAKE
+ *             (por defecto; spin iteraciones de espera activa, por
+ *             defecto 0)
+ *    cond:    el mismo algoritmo de condition_barrier.c con fx_mutex y
+ *             fx_cond en lugar de pthread_mutex_t y pthread_cond_t
+ *
+ * Notas:
+ *    1. Con cond, fx_cond_broadcast pasa a los threads dormidos a la cola
+ *       del mutex en lugar de despertarlos a todos a la vez. Además se
+ *       espera sobre un número de generación, así que un despertar
+ *       espurio no deja pasar a nadie antes de tiempo.
+ *    2. Este programa mide solo BARRIER_COUNT barreras y el tiempo incluye
+ *       crear y esperar a los threads. Para comparar estas versiones con
+ *       las demás está comparar_barreras.sh, que usa los tipos futex y
+ *       futex-cond de barrier_driver.c sobre un pool de threads.
+ *    3. El flag de compilación DEBUG imprimirá un mensaje después de cada
+ *       barrera.
+ *
+ * IPP:   Sección 4.8.3 (págs. 179 y sigs.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "timer.h"
+#include "futex_sync.h"
+
+#define BARRIER_COUNT 100
+
+int thread_count;
+int use_cond;
+
+/* barrier */
+fx_barrier_t barrier;
+
+/* cond */
+fx_mutex_t barrier_mutex;
+fx_cond_t ok_to_proceed;
+int barrier_thread_count = 0;
+int barrier_generation = 0;
+
+void Usage(char* prog_name);
+void *Thread_work(void* rank);
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread;
+   pthread_t* thread_handles;
+   double start, finish;
+   int spin = 0;
+
+   if (argc < 2 || argc > 4)
+      Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   if (argc > 2) {
+      if (strcmp(argv[2], "cond") == 0)
+         use_cond = 1;
+      else if (strcmp(argv[2], "barrier") != 0)
+         Usage(argv[0]);
+   }
+   if (argc > 3) spin = strtol(argv[3], NULL, 10);
+
+   thread_handles = malloc (thread_count*sizeof(pthread_t));
+   fx_barrier_init(&barrier, thread_count, spin);
+   fx_mutex_init(&barrier_mutex);
+   fx_cond_init(&ok_to_proceed);
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+          Thread_work, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++) {
+      pthread_join(thread_handles[thread], NULL);
+   }
+   GET_TIME(finish);
+   printf("Tiempo transcurrido = %e segundos\n", finish - start);
+
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Usage
+ * Propósito:   Imprimir línea de comando para función y terminar
+ * En arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "Usar: %s <numero de threads> [barrier|cond] [spin]\n",
+         prog_name);
+   exit(0);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------
+ * Función:     Thread_work
+ * Propósito:   Ejecutar las barreras BARRIER_COUNT
+ * En arg:      rank
+ * Var Global:  thread_count, use_cond, barrier, barrier_mutex,
+ *              ok_to_proceed, barrier_thread_count, barrier_generation
+ * Val Retorno: Ignorado
+ */
+void *Thread_work(void* rank) {
+#  ifdef DEBUG
+   long my_rank = (long) rank;
+#  endif
+   int i, my_generation;
+
+   for (i = 0; i < BARRIER_COUNT; i++) {
+      if (!use_cond) {
+         fx_barrier_wait(&barrier);
+      } else {
+         fx_mutex_lock(&barrier_mutex);
+         my_generation = barrier_generation;
+         barrier_thread_count++;
+         if (barrier_thread_count == thread_count) {
+            barrier_thread_count = 0;
+            barrier_generation++;
+            fx_cond_broadcast(&ok_to_proceed);
+         } else {
+            while (my_generation == barrier_generation)
+               fx_cond_wait(&ok_to_proceed, &barrier_mutex);
+         }
+         fx_mutex_unlock(&barrier_mutex);
+      }
+#     ifdef DEBUG
+      if (my_rank == 0) {
+         printf("Todos los threads completaron la barrera %d\n", i);
+         fflush(stdout);
+      }
+#     endif
+   }
+
+   return NULL;
+}  /* Thread_work */
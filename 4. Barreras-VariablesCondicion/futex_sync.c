@@ -0,0 +1,167 @@
+/* Archivo:   futex_sync.c
+ *
+ * Propósito: Implementar el mutex, la variable de condición y la barrera
+ *            sobre futex (ver futex_sync.h).
+ *
+ * Compilar:  Se enlaza con el programa que los usa, por ejemplo
+ *            gcc -O2 -g -Wall -o ejecutable futex_barrier.c futex_sync.c -lpthread
+ *
+ * Notas:
+ *    1. fx_mutex: 0 libre, 1 tomado, 2 tomado con posibles esperas. Solo
+ *       el unlock que encuentra 2 llama a FUTEX_WAKE.
+ *    2. fx_cond_wait lee seq antes de liberar el mutex y duerme con
+ *       FUTEX_WAIT(seq): si hubo un signal en el medio, seq ya cambió y no
+ *       duerme. Al despertar vuelve a tomar el mutex en el estado 2, porque
+ *       puede haber otros threads pasados a la cola del mutex.
+ *    3. fx_barrier: cada thread lee generation antes de decrementar
+ *       count. El último repone count, incrementa generation y solo llama a
+ *       FUTEX_WAKE si waiters no es 0. Un thread que va a dormir incrementa
+ *       waiters antes de volver a mirar generation y lo decrementa al
+ *       despertar; todos estos accesos son seq_cst, así que o ve la
+ *       generación nueva o el último ve su anuncio. Nadie pone waiters en
+ *       0 por otro: un thread que ya espera el episodio siguiente no
+ *       pierde su anuncio (a lo sumo se despierta una vez de más).
+ *    4. fx_cond guarda el mutex de los que esperan con un store release y
+ *       fx_cond_broadcast lo lee con acquire, así que broadcast se puede
+ *       llamar con o sin el mutex tomado. Todos los que esperan en una
+ *       misma fx_cond tienen que usar el mismo mutex.
+ */
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "futex_sync.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/*-----------------------------------------------------------------*/
+static long Futex(int* addr, int op, int val, void* arg, int* addr2,
+      int val3) {
+   return syscall(SYS_futex, addr, op, val, arg, addr2, val3);
+}  /* Futex */
+
+/*-----------------------------------------------------------------*/
+void fx_mutex_init(fx_mutex_t* mutex_p) {
+   mutex_p->state = 0;
+}  /* fx_mutex_init */
+
+/*-----------------------------------------------------------------*/
+void fx_mutex_lock(fx_mutex_t* mutex_p) {
+   int c = 0;
+
+   if (__atomic_compare_exchange_n(&mutex_p->state, &c, 1, 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      return;
+   if (c != 2)
+      c = __atomic_exchange_n(&mutex_p->state, 2, __ATOMIC_ACQUIRE);
+   while (c != 0) {
+      Futex(&mutex_p->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+      c = __atomic_exchange_n(&mutex_p->state, 2, __ATOMIC_ACQUIRE);
+   }
+}  /* fx_mutex_lock */
+
+/*-----------------------------------------------------------------*/
+void fx_mutex_unlock(fx_mutex_t* mutex_p) {
+   if (__atomic_fetch_sub(&mutex_p->state, 1, __ATOMIC_RELEASE) != 1) {
+      __atomic_store_n(&mutex_p->state, 0, __ATOMIC_RELEASE);
+      Futex(&mutex_p->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+   }
+}  /* fx_mutex_unlock */
+
+/*-----------------------------------------------------------------*/
+void fx_cond_init(fx_cond_t* cond_p) {
+   cond_p->seq = 0;
+   cond_p->mutex = NULL;
+}  /* fx_cond_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:    fx_cond_wait
+ * Propósito:  Liberar mutex_p, dormir hasta un signal o broadcast y
+ *             volver a tomar mutex_p. Como con pthreads, puede volver
+ *             sin que la condición se cumpla.
+ */
+void fx_cond_wait(fx_cond_t* cond_p, fx_mutex_t* mutex_p) {
+   int seq = __atomic_load_n(&cond_p->seq, __ATOMIC_RELAXED);
+
+   __atomic_store_n(&cond_p->mutex, mutex_p, __ATOMIC_RELEASE);
+   fx_mutex_unlock(mutex_p);
+   Futex(&cond_p->seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+   while (__atomic_exchange_n(&mutex_p->state, 2, __ATOMIC_ACQUIRE) != 0)
+      Futex(&mutex_p->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+}  /* fx_cond_wait */
+
+/*-----------------------------------------------------------------*/
+void fx_cond_signal(fx_cond_t* cond_p) {
+   __atomic_add_fetch(&cond_p->seq, 1, __ATOMIC_RELEASE);
+   Futex(&cond_p->seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}  /* fx_cond_signal */
+
+/*-----------------------------------------------------------------*/
+/* Función:    fx_cond_broadcast
+ * Propósito:  Despertar a un thread y pasar a los demás a la cola del
+ *             mutex: se despiertan de a uno a medida que se libera
+ */
+void fx_cond_broadcast(fx_cond_t* cond_p) {
+   fx_mutex_t* mutex_p = __atomic_load_n(&cond_p->mutex, __ATOMIC_ACQUIRE);
+   int seq = __atomic_add_fetch(&cond_p->seq, 1, __ATOMIC_RELEASE);
+
+   if (mutex_p == NULL) return;   /* Nunca esperó nadie */
+   while (Futex(&cond_p->seq, FUTEX_CMP_REQUEUE_PRIVATE, 1,
+            (void*) (long) INT_MAX, &mutex_p->state, seq) < 0 &&
+         errno == EAGAIN)
+      seq = __atomic_load_n(&cond_p->seq, __ATOMIC_RELAXED);
+}  /* fx_cond_broadcast */
+
+/*-----------------------------------------------------------------*/
+/* Función:    fx_barrier_init
+ * Propósito:  Preparar la barrera para thread_count threads
+ * En args:    spin: iteraciones de espera activa antes de dormir
+ */
+void fx_barrier_init(fx_barrier_t* barrier_p, int thread_count, int spin) {
+   barrier_p->count = thread_count;
+   barrier_p->generation = 0;
+   barrier_p->waiters = 0;
+   barrier_p->thread_count = thread_count;
+   barrier_p->spin = spin;
+}  /* fx_barrier_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:    fx_barrier_wait
+ * Propósito:  Esperar a que lleguen los thread_count threads
+ * Val Retorno: 1 en el último thread en llegar, 0 en los demás
+ */
+int fx_barrier_wait(fx_barrier_t* barrier_p) {
+   int gen = __atomic_load_n(&barrier_p->generation, __ATOMIC_ACQUIRE);
+   int i;
+
+   if (__atomic_sub_fetch(&barrier_p->count, 1, __ATOMIC_ACQ_REL) == 0) {
+      __atomic_store_n(&barrier_p->count, barrier_p->thread_count,
+            __ATOMIC_RELAXED);
+      __atomic_store_n(&barrier_p->generation, gen + 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&barrier_p->waiters, __ATOMIC_SEQ_CST) != 0)
+         Futex(&barrier_p->generation, FUTEX_WAKE_PRIVATE, INT_MAX, NULL,
+               NULL, 0);
+      return 1;
+   }
+
+   for (i = 0; i < barrier_p->spin; i++) {
+      if (__atomic_load_n(&barrier_p->generation, __ATOMIC_ACQUIRE) != gen)
+         return 0;
+      CPU_RELAX();
+   }
+   for (;;) {
+      __atomic_add_fetch(&barrier_p->waiters, 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&barrier_p->generation, __ATOMIC_SEQ_CST) != gen) {
+         __atomic_sub_fetch(&barrier_p->waiters, 1, __ATOMIC_RELAXED);
+         return 0;
+      }
+      Futex(&barrier_p->generation, FUTEX_WAIT_PRIVATE, gen, NULL, NULL, 0);
+      __atomic_sub_fetch(&barrier_p->waiters, 1, __ATOMIC_RELAXED);
+   }
+}  /* fx_barrier_wait */
@@ -0,0 +1,54 @@
+/* Archivo:   futex_sync.h
+ * Propósito: Archivo de cabecera para futex_sync.c: mutex, variable de
+ *            condición y barrera construidos directamente sobre futex de
+ *            Linux, sin pasar por pthreads.
+ *
+ *            fx_mutex_t    Mutex de tres estados (Drepper, "Futexes are
+ *                          tricky"): sin llamadas al sistema si no hay
+ *                          contención
+ *            fx_cond_t     Variable de condición con contador de secuencia.
+ *                          fx_cond_broadcast despierta a un thread y pasa
+ *                          a los demás a la cola del mutex (FUTEX_REQUEUE),
+ *                          así no se despiertan todos para pelear por él
+ *            fx_barrier_t  Barrera con una sola palabra de generación: el
+ *                          último en llegar la incrementa y hace un solo
+ *                          FUTEX_WAKE; nadie vuelve a tomar un mutex
+ *
+ * Nota:      Solo Linux. Todos los tipos se inicializan con su función
+ *            *_init y no necesitan destroy.
+ */
+#ifndef _FUTEX_SYNC_H_
+#define _FUTEX_SYNC_H_
+
+#define FX_CACHE_LINE 64
+
+typedef struct {
+   int state;     /* 0 libre, 1 tomado, 2 tomado y con threads esperando */
+} fx_mutex_t;
+
+typedef struct {
+   int seq;               /* Cambia en cada signal o broadcast */
+   fx_mutex_t* mutex;     /* Mutex de los que esperan, para el requeue */
+} fx_cond_t;
+
+typedef struct {
+   int count __attribute__((aligned(FX_CACHE_LINE)));
+   int generation __attribute__((aligned(FX_CACHE_LINE)));
+   int waiters;           /* Threads que van a dormir o duermen */
+   int thread_count;
+   int spin;
+} fx_barrier_t;
+
+void fx_mutex_init(fx_mutex_t* mutex_p);
+void fx_mutex_lock(fx_mutex_t* mutex_p);
+void fx_mutex_unlock(fx_mutex_t* mutex_p);
+
+void fx_cond_init(fx_cond_t* cond_p);
+void fx_cond_wait(fx_cond_t* cond_p, fx_mutex_t* mutex_p);
+void fx_cond_signal(fx_cond_t* cond_p);
+void fx_cond_broadcast(fx_cond_t* cond_p);
+
+void fx_barrier_init(fx_barrier_t* barrier_p, int thread_count, int spin);
+int  fx_barrier_wait(fx_barrier_t* barrier_p);
+
+#endif
@@ -0,0 +1,218 @@
+/* Archivo:   latency.c
+ *
+ * Propósito: Implementar los histogramas de latencia y la línea de tiempo
+ *            de throughput (ver latency.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_OneMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. lat_init calibra el contador de ciclos con hr_ns_per_tick
+ *       (../comun/hrtimer.h), así que los resultados se imprimen en ns.
+ *       Sin TSC invariante lat_now devuelve directamente nanosegundos.
+ *    2. El monitor solo lee los contadores ops_done; nunca escribe en la
+ *       memoria de los threads medidos.
+ *    3. Los histogramas se reservan con mmap, que entrega páginas en cero
+ *       sin tocarlas, y cada thread ocupa páginas enteras (LAT_PAGE): sus
+ *       páginas quedan en el nodo NUMA del thread que registra la primera
+ *       operación en ellas (first touch), no en el de main. Leerlas antes
+ *       (el monitor) no las ubica. La región se marca MADV_NOHUGEPAGE:
+ *       en una página de 2 MB caerían los histogramas de varios threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "latency.h"
+
+struct lat_thread_s* lat_threads = NULL;
+int lat_use_tsc = 0;
+
+static int lat_thread_count, lat_op_count;
+static size_t lat_bytes;
+static const char** lat_op_names;
+static double ns_per_tick = 1.0;
+
+/* Línea de tiempo */
+static pthread_t monitor;
+static int monitor_running = 0;
+static int monitor_stop;
+static int interval_ns;
+static long long timeline_start;
+static unsigned long* samples = NULL;   /* ops totales al final de cada intervalo */
+static double* sample_times = NULL;     /* segundos desde el inicio */
+static int sample_count, sample_capacity;
+
+/*-----------------------------------------------------------------*/
+/* Función:    lat_init
+ * Propósito:  Reservar los histogramas y calibrar el contador de ciclos
+ * En args:    op_names: nombre de cada uno de los op_count tipos
+ */
+void lat_init(int thread_count, int op_count, const char* op_names[]) {
+   lat_thread_count = thread_count;
+   lat_op_count = op_count < LAT_MAX_OPS ? op_count : LAT_MAX_OPS;
+   lat_op_names = op_names;
+   lat_bytes = thread_count*sizeof(struct lat_thread_s);
+   lat_threads = mmap(NULL, lat_bytes, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (lat_threads == MAP_FAILED) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   madvise(lat_threads, lat_bytes, MADV_NOHUGEPAGE);
+
+   /* hr_ns_per_tick devuelve 1 si no hay TSC invariante */
+   lat_use_tsc = hr_tsc_invariant();
+   ns_per_tick = hr_ns_per_tick();
+}  /* lat_init */
+
+/*-----------------------------------------------------------------*/
+static unsigned long Total_ops(void) {
+   unsigned long total = 0;
+   int r;
+
+   for (r = 0; r < lat_thread_count; r++)
+      total += __atomic_load_n(&lat_threads[r].ops_done, __ATOMIC_RELAXED);
+   return total;
+}  /* Total_ops */
+
+/*-----------------------------------------------------------------*/
+static void Add_sample(double when) {
+   if (sample_count == sample_capacity) {
+      sample_capacity = sample_capacity == 0 ? 64 : 2*sample_capacity;
+      samples = realloc(samples, sample_capacity*sizeof(unsigned long));
+      sample_times = realloc(sample_times, sample_capacity*sizeof(double));
+   }
+   samples[sample_count] = Total_ops();
+   sample_times[sample_count] = when;
+   sample_count++;
+}  /* Add_sample */
+
+/*-----------------------------------------------------------------*/
+static void* Monitor_work(void* arg) {
+   long long next;
+   struct timespec t;
+
+   /* clock_nanosleep no acepta CLOCK_MONOTONIC_RAW: las horas de
+    * despertar son de CLOCK_MONOTONIC y las muestras de hr_now_ns */
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   next = t.tv_sec*1000000000LL + t.tv_nsec;
+   for (;;) {
+      next += interval_ns;
+      t.tv_sec = next / 1000000000LL;
+      t.tv_nsec = next % 1000000000LL;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) != 0)
+         ;
+      if (__atomic_load_n(&monitor_stop, __ATOMIC_ACQUIRE)) break;
+      Add_sample((hr_now_ns() - timeline_start)/1.0e9);
+   }
+   return NULL;
+}  /* Monitor_work */
+
+/*-----------------------------------------------------------------*/
+/* Función:    lat_timeline_start
+ * Propósito:  Lanzar el thread monitor que toma una muestra cada
+ *             interval_ms milisegundos
+ */
+void lat_timeline_start(int interval_ms) {
+   interval_ns = interval_ms*1000000;
+   sample_count = 0;
+   monitor_stop = 0;
+   timeline_start = hr_now_ns();
+   if (pthread_create(&monitor, NULL, Monitor_work, NULL) == 0)
+      monitor_running = 1;
+}  /* lat_timeline_start */
+
+/*-----------------------------------------------------------------*/
+/* Función:    lat_timeline_stop
+ * Propósito:  Detener el monitor y agregar la muestra final, que cubre
+ *             el último intervalo incompleto
+ */
+void lat_timeline_stop(void) {
+   unsigned long last;
+
+   if (!monitor_running) return;
+   __atomic_store_n(&monitor_stop, 1, __ATOMIC_RELEASE);
+   pthread_join(monitor, NULL);
+   monitor_running = 0;
+   last = sample_count > 0 ? samples[sample_count-1] : 0;
+   if (Total_ops() != last)
+      Add_sample((hr_now_ns() - timeline_start)/1.0e9);
+}  /* lat_timeline_stop */
+
+/*-----------------------------------------------------------------*/
+/* Valor más alto equivalente del intervalo b, en ticks */
+static unsigned long long Bucket_top(int b) {
+   int e, m;
+
+   if (b < LAT_SUB) return b;
+   e = b/LAT_SUB + LAT_SUB_BITS - 1;
+   m = b % LAT_SUB;
+   return (((unsigned long long) (LAT_SUB + m + 1)) << (e - LAT_SUB_BITS)) - 1;
+}  /* Bucket_top */
+
+/*-----------------------------------------------------------------*/
+/* Función:    lat_report
+ * Propósito:  Combinar los histogramas de todos los threads e imprimir
+ *             percentiles por operación y el throughput por intervalo
+ */
+void lat_report(void) {
+   static const double quantiles[] = { 0.5, 0.99, 0.999 };
+   unsigned long long merged[LAT_BUCKETS], total, seen, max;
+   double value[3], prev_time;
+   int op, b, r, q;
+   unsigned long prev;
+
+   printf("Latencia por operación (ns):\n");
+   printf("   %-10s %10s %10s %10s %10s %10s\n", "operación", "cantidad",
+         "p50", "p99", "p99.9", "máx");
+   for (op = 0; op < lat_op_count; op++) {
+      total = max = 0;
+      for (b = 0; b < LAT_BUCKETS; b++) {
+         merged[b] = 0;
+         for (r = 0; r < lat_thread_count; r++)
+            merged[b] += lat_threads[r].counts[op][b];
+         total += merged[b];
+      }
+      for (r = 0; r < lat_thread_count; r++)
+         if (lat_threads[r].max[op] > max) max = lat_threads[r].max[op];
+      if (total == 0) {
+         printf("   %-10s %10d\n", lat_op_names[op], 0);
+         continue;
+      }
+      for (q = 0; q < 3; q++) {
+         seen = 0;
+         for (b = 0; b < LAT_BUCKETS; b++) {
+            seen += merged[b];
+            if (seen >= quantiles[q]*total) break;
+         }
+         value[q] = Bucket_top(b)*ns_per_tick;
+      }
+      printf("   %-10s %10llu %10.0f %10.0f %10.0f %10.0f\n", lat_op_names[op],
+            total, value[0], value[1], value[2], max*ns_per_tick);
+   }
+
+   if (sample_count == 0) return;
+   printf("Throughput por intervalo de %d ms:\n", interval_ns/1000000);
+   prev = 0;
+   prev_time = 0.0;
+   for (q = 0; q < sample_count; q++) {
+      printf("   t = %8.3f s  %12.4e ops/s\n", sample_times[q],
+            (samples[q] - prev) / (sample_times[q] - prev_time));
+      prev = samples[q];
+      prev_time = sample_times[q];
+   }
+}  /* lat_report */
+
+/*-----------------------------------------------------------------*/
+void lat_destroy(void) {
+   if (lat_threads != NULL) munmap(lat_threads, lat_bytes);
+   free(samples);
+   free(sample_times);
+   lat_threads = NULL;
+   samples = NULL;
+   sample_times = NULL;
+   sample_count = sample_capacity = 0;
+}  /* lat_destroy */
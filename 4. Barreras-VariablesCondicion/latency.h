@@ -0,0 +1,86 @@
+/* Archivo:   latency.h
+ * Propósito: Archivo de cabecera para latency.c, que mide la latencia de
+ *            cada operación con el contador de ciclos y el throughput por
+ *            intervalos, con un costo bajo para poder dejarlo siempre activo.
+ *
+ *            Cada thread registra en su propio histograma log-lineal (16
+ *            sub-intervalos por potencia de 2, ~6% de error relativo, como
+ *            HdrHistogram). Al final se combinan y se imprimen p50, p99,
+ *            p99.9 y máximo por tipo de operación. Un thread monitor toma una
+ *            muestra del total de operaciones cada interval_ms.
+ *
+ * Ejemplo:
+ *    lat_init(thread_count, 3, op_names);
+ *    lat_timeline_start(100);
+ *    . . .   en cada thread:
+ *       t0 = lat_now();
+ *       operación
+ *       lat_record(my_rank, op, t0);
+ *    . . .
+ *    lat_timeline_stop();
+ *    lat_report();
+ *    lat_destroy();
+ */
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include "../comun/hrtimer.h"
+
+#define LAT_MAX_OPS  4
+#define LAT_SUB_BITS 4
+#define LAT_SUB      (1 << LAT_SUB_BITS)
+#define LAT_BUCKETS  ((64 - LAT_SUB_BITS + 1) * LAT_SUB)
+#define LAT_CACHE_LINE 64
+#define LAT_PAGE     4096
+#define LAT_DEFAULT_INTERVAL_MS 100
+
+/* Histogramas de un thread. Cada uno empieza en una página y ocupa
+ * páginas enteras, así ninguna página tiene datos de dos threads */
+struct lat_thread_s {
+   unsigned long long counts[LAT_MAX_OPS][LAT_BUCKETS];
+   unsigned long long max[LAT_MAX_OPS];
+   /* Leído por el monitor: en su propia línea de cache */
+   unsigned long ops_done __attribute__((aligned(LAT_CACHE_LINE)));
+} __attribute__((aligned(LAT_PAGE)));
+
+extern struct lat_thread_s* lat_threads;
+extern int lat_use_tsc;
+
+/*-----------------------------------------------------------------*/
+/* Ciclos (o nanosegundos si no hay TSC invariante) desde algún momento
+ * fijo. Sin las barreras de hr_start: cada operación dura microsegundos */
+static inline unsigned long long lat_now(void) {
+#  if defined(__x86_64__) || defined(__i386__)
+   if (lat_use_tsc) return __rdtsc();
+#  endif
+   return hr_now_ns();
+}  /* lat_now */
+
+/*-----------------------------------------------------------------*/
+static inline int lat_bucket(unsigned long long v) {
+   int e;
+
+   if (v < LAT_SUB) return (int) v;
+   e = 63 - __builtin_clzll(v);
+   return (e - LAT_SUB_BITS + 1) * LAT_SUB
+         + (int) ((v >> (e - LAT_SUB_BITS)) & (LAT_SUB - 1));
+}  /* lat_bucket */
+
+/*-----------------------------------------------------------------*/
+/* Registrar una operación de tipo op que empezó en start */
+static inline void lat_record(long rank, int op, unsigned long long start) {
+   struct lat_thread_s* t = &lat_threads[rank];
+   unsigned long long elapsed = lat_now() - start;
+
+   t->counts[op][lat_bucket(elapsed)]++;
+   if (elapsed > t->max[op]) t->max[op] = elapsed;
+   __atomic_store_n(&t->ops_done, t->ops_done + 1, __ATOMIC_RELAXED);
+}  /* lat_record */
+
+void lat_init(int thread_count, int op_count, const char* op_names[]);
+void lat_timeline_start(int interval_ms);
+void lat_timeline_stop(void);
+void lat_report(void);
+void lat_destroy(void);
+
+#endif
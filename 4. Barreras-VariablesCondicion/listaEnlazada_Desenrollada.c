@@ -0,0 +1,579 @@
+/* Archivo:   listaEnlazada_Desenrollada.c
+ *
+ * Propósito: Implementar una lista enlazada ordenada "desenrollada" de múltiples
+ *            subprocesos con ops insertar, imprimir, miembro, eliminar, lista
+ *            libre. Cada nodo guarda un bloque ordenado de hasta BLOCK_KEYS
+ *            keys (dos líneas de cache) y tiene su propio mutex.
+ *
+ * Compilar:  gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_Desenrollada.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *            se necesita timer.h, my_rand.h, rng.h, workload.h, latency.h, pool.h,
+ *            batch.h, lock_prof.h y cacheline.h
+ *
+ * Ejecutar:  ./ejecutable <thread_count> [opciones de carga]
+ * Entrada:   Número total de keys insertadas por thread principal
+ *            Número total de operaciones realizadas por cada hilo
+ *            (todos los hilos llevan a cabo el mismo número de operaciones)
+ *            porcentaje de operaciones que son búsquedas e inserciones
+ *            (las operaciones restantes son eliminaciones).
+ * Salida:    Tiempo transcurrido para realizar las operaciones y
+ *            estadísticas de ocupación de los bloques
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
+ *
+ * Notas:
+ *    1. No se permiten valores repetidos en la lista.
+ *    2. Indicador de compilación DEBUG utilizado. Para obtener la salida de
+ *       depuración, compile con el indicador de línea de comando -DDEBUG.
+ *    3. Todas las keys de un bloque son menores que las del bloque siguiente.
+ *       Un bloque lleno se divide en dos al insertar; un bloque con menos
+ *       de BLOCK_KEYS/4 keys se fusiona con el siguiente al eliminar o, si
+ *       no caben juntos, le pide keys hasta quedar los dos con la mitad.
+ *       Solo el último bloque puede quedar vacío.
+ *    4. El primer bloque es permanente (puede quedar vacío), así que no se
+ *       necesita head_mutex: la cabeza se bloquea con el mutex del bloque.
+ *    5. La búsqueda dentro del bloque usa SSE2 cuando está disponible. Los
+ *       huecos del bloque se rellenan con INT_MAX para que la comparación
+ *       vectorial no necesite tratar el final del bloque por separado.
+ *    6. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que
+ *       los subprocesos hayan trabajado en ella.
+ *    7. Solo Insert, Member, Delete e Insert_many usan bloqueos: Print y
+ *       Free_List *no* se deben llamar cuando varios subprocesos están
+ *       accediendo a la lista. Insert_many mezcla un lote ordenado
+ *       (batch.c) en un solo recorrido mano sobre mano por los bloques y
+ *       divide los bloques llenos como Insert; como las keys llegan en
+ *       orden, los bloques que deja quedan a la mitad.
+ *    8. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
+ *    9. Con -DLOCK_PROF los mutex se miden por clase (bloque)
+ *       y al salir se imprime cuántas adquisiciones fueron contendidas
+ *       y los tiempos de espera y retención.
+ *
+ * IPP:   Sección 4.9.2 (pp. 186 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include "my_rand.h"
+#include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "batch.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Los ints aleatorias son inferiores a MAX_KEY */
+const int MAX_KEY = 100000000;
+
+/* 16 ints = una línea de cache de keys; el resto del bloque ocupa la segunda */
+#define BLOCK_KEYS 16
+/* Estructura para bloques de la lista */
+struct list_block_s {
+   int    keys[BLOCK_KEYS];   /* Ordenadas, huecos = INT_MAX */
+   int    count;
+   struct list_block_s* next;
+   prof_mutex_t mutex;
+} __attribute__((aligned(CACHE_LINE)));
+
+/* Variables compartidas */
+struct list_block_s* head = NULL;
+int         thread_count;
+wl_config_t workload;
+int         total_ops;
+double      insert_percent;
+double      search_percent;
+double      delete_percent;
+wl_counts_t* op_counts;
+int         member_total=0, insert_total=0, delete_total=0;
+
+/* Setup y cleanup */
+void        Usage(char* prog_name);
+void        Get_input(int* inserts_in_main_p);
+
+/* Función de Thread */
+void*       Thread_work(void* rank);
+
+/* Operaciones sobre bloques */
+struct list_block_s* New_block(void);
+int         Rank_in_block(struct list_block_s* block_p, int value);
+struct list_block_s* Find_block(int value);
+void        Split_block(struct list_block_s* block_p);
+void        Merge_next(struct list_block_s* block_p);
+
+/* Lista de operaciones */
+int         Insert(int value);
+void        Print(void);
+void        Print_stats(void);
+int         Member(int value);
+int         Delete(int value);
+int         Insert_many(int values[], int n);
+void        Free_list(void);
+int         Is_empty(void);
+
+/*-----------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long i;
+   pool_t pool;
+   af_placement_t placement;
+   int inserts_in_main;
+   bt_ops_t ops = { Insert_many, NULL, NULL };
+   double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
+
+   if (argc < 2) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, 2)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+
+   head = New_block();
+
+   pool_init(&pool, thread_count, &placement);
+
+   /* Intenta insertar keys inserts_in_main, pero abandona despues */
+   /* 2*inserts_in_main intentos.                                  */
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
+   printf("Keys %ld insertadas en la lista vacia\n", i);
+
+#  ifdef OUTPUT
+   printf("Antes de comenzar los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
+   GET_TIME(start);
+   pool_run(&pool, Thread_work);
+   GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_total += op_counts[i].member;
+      insert_total += op_counts[i].insert;
+      delete_total += op_counts[i].delete;
+   }
+   printf("Tiempo transcurrido = %e seconds\n", finish - start);
+   printf("Total de operaciones = %d\n", total_ops);
+   printf("Operaciones Miembro  = %d\n", member_total);
+   printf("Operaciones Insertar = %d\n", insert_total);
+   printf("Operaciones Eliminar = %d\n", delete_total);
+   lat_report();
+   Print_stats();
+
+#  ifdef OUTPUT
+   printf("Después de que terminan los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   Free_list();
+   lat_destroy();
+   free(op_counts);
+   pool_destroy(&pool);
+
+   return 0;
+}  /* main */
+
+
+/*-----------------------------------------------------------------*/
+void Usage(char* prog_name) {
+   fprintf(stderr, "Usar: %s <thread_count> [opciones]\n", prog_name);
+   wl_usage();
+   exit(0);
+}  /* Usar */
+
+/*-----------------------------------------------------------------*/
+void Get_input(int* inserts_in_main_p) {
+
+   printf("¿Cuántas keys se deben insertar en el thread principal?\n");
+   scanf("%d", inserts_in_main_p);
+   printf("¿Cuántas operaciones en total se deben ejecutar?\n");
+   scanf("%d", &total_ops);
+   printf("¿Porcentaje de operaciones que deberían ser búsquedas? (entre 0 y 1)\n");
+   scanf("%lf", &search_percent);
+   printf("¿Porcentaje de operaciones que deberían ser inserciones? (entre 0 y 1)\n");
+   scanf("%lf", &insert_percent);
+   delete_percent = 1.0 - (search_percent + insert_percent);
+}  /* Get_input */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  New_block
+ * Propósito:  Reservar un bloque vacío alineado a línea de cache
+ */
+struct list_block_s* New_block(void) {
+   struct list_block_s* block_p;
+   int i;
+
+   if (posix_memalign((void**) &block_p, CACHE_LINE,
+            sizeof(struct list_block_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   for (i = 0; i < BLOCK_KEYS; i++)
+      block_p->keys[i] = INT_MAX;
+   block_p->count = 0;
+   block_p->next = NULL;
+   prof_mutex_init(&(block_p->mutex), "bloque");
+   return block_p;
+}  /* New_block */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Rank_in_block
+ * Propósito:  Devolver cuántas keys del bloque son menores que value,
+ *             es decir, la posición donde value está o debería estar.
+ * Suposición: El thread de llamada mantiene el bloqueo del bloque
+ */
+int Rank_in_block(struct list_block_s* block_p, int value) {
+#  ifdef __SSE2__
+   __m128i val_v = _mm_set1_epi32(value);
+   int rank = 0, i, mask;
+
+   /* keys[i] < value  <=>  value > keys[i] */
+   for (i = 0; i < BLOCK_KEYS; i += 4) {
+      __m128i keys_v = _mm_load_si128((__m128i*) &(block_p->keys[i]));
+      mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(val_v, keys_v)));
+      rank += __builtin_popcount(mask);
+   }
+   return rank;
+#  else
+   int rank = 0;
+
+   while (rank < block_p->count && block_p->keys[rank] < value)
+      rank++;
+   return rank;
+#  endif
+}  /* Rank_in_block */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Find_block
+ * Propósito:  Recorrer la lista mano sobre mano hasta el bloque que
+ *             contiene, o debería contener, a value
+ * Val Retorno: El bloque, bloqueado por el thread de llamada
+ */
+struct list_block_s* Find_block(int value) {
+   struct list_block_s* curr = head;
+   struct list_block_s* next;
+
+   prof_mutex_lock(&(curr->mutex));
+   while (curr->next != NULL &&
+         (curr->count == 0 || curr->keys[curr->count-1] < value)) {
+      next = curr->next;
+      prof_mutex_lock(&(next->mutex));
+      prof_mutex_unlock(&(curr->mutex));
+      curr = next;
+   }
+   return curr;
+}  /* Find_block */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Split_block
+ * Propósito:  Mover la mitad superior de un bloque lleno a un bloque
+ *             nuevo enlazado a continuación
+ * Suposición: El thread de llamada mantiene el bloqueo de block_p. El
+ *             bloque nuevo no es visible hasta que se enlaza.
+ */
+void Split_block(struct list_block_s* block_p) {
+   struct list_block_s* new_p = New_block();
+   int half = BLOCK_KEYS/2, i;
+
+   for (i = half; i < BLOCK_KEYS; i++) {
+      new_p->keys[i-half] = block_p->keys[i];
+      block_p->keys[i] = INT_MAX;
+   }
+   new_p->count = BLOCK_KEYS - half;
+   block_p->count = half;
+   new_p->next = block_p->next;
+   block_p->next = new_p;
+}  /* Split_block */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Merge_next
+ * Propósito:  Fusionar el bloque siguiente en block_p si caben juntos
+ *             en 3/4 de un bloque, y liberar el siguiente. Si no caben,
+ *             pasar las keys menores del siguiente a block_p hasta que
+ *             los dos queden con la mitad, así block_p no se queda casi
+ *             vacío (o vacío) en el medio de la lista.
+ * Suposición: El thread de llamada mantiene el bloqueo de block_p.
+ *             Cualquier otro thread que quiera el siguiente bloque debe
+ *             pasar primero por block_p, así que nadie espera su mutex.
+ */
+void Merge_next(struct list_block_s* block_p) {
+   struct list_block_s* next = block_p->next;
+   int i, moved;
+
+   if (next == NULL) return;
+   prof_mutex_lock(&(next->mutex));
+   if (block_p->count + next->count <= 3*BLOCK_KEYS/4) {
+      for (i = 0; i < next->count; i++)
+         block_p->keys[block_p->count + i] = next->keys[i];
+      block_p->count += next->count;
+      block_p->next = next->next;
+      prof_mutex_unlock(&(next->mutex));
+      prof_mutex_destroy(&(next->mutex));
+      free(next);
+   } else {
+      /* Todas las keys de next son mayores que las de block_p */
+      moved = (next->count - block_p->count)/2;
+      for (i = 0; i < moved; i++)
+         block_p->keys[block_p->count + i] = next->keys[i];
+      block_p->count += moved;
+      for (i = 0; i < next->count - moved; i++)
+         next->keys[i] = next->keys[i + moved];
+      for (i = next->count - moved; i < next->count; i++)
+         next->keys[i] = INT_MAX;
+      next->count -= moved;
+      prof_mutex_unlock(&(next->mutex));
+   }
+}  /* Merge_next */
+
+/*-----------------------------------------------------------------*/
+/* Inserta el valor en la ubicación numérica correcta en la lista */
+/* Si el valor no está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Insert(int value) {
+   struct list_block_s* curr = Find_block(value);
+   int pos, i;
+
+   pos = Rank_in_block(curr, value);
+   if (pos < curr->count && curr->keys[pos] == value) {
+      prof_mutex_unlock(&(curr->mutex));
+      return 0;
+   }
+
+#  ifdef DEBUG
+   printf("Inserting %d\n", value);
+#  endif
+   if (curr->count == BLOCK_KEYS) {
+      Split_block(curr);
+      if (pos > BLOCK_KEYS/2) {
+         /* El valor va a la mitad nueva: pasar el bloqueo a ella */
+         struct list_block_s* next = curr->next;
+         prof_mutex_lock(&(next->mutex));
+         prof_mutex_unlock(&(curr->mutex));
+         curr = next;
+         pos -= BLOCK_KEYS/2;
+      }
+   }
+   for (i = curr->count; i > pos; i--)
+      curr->keys[i] = curr->keys[i-1];
+   curr->keys[pos] = value;
+   curr->count++;
+   prof_mutex_unlock(&(curr->mutex));
+
+   return 1;
+}  /* Insertar */
+
+/*-----------------------------------------------------------------*/
+/* No usa locks: no se puede ejecutar con los otros subprocesos */
+void Print(void) {
+   struct list_block_s* temp;
+   int i;
+
+   printf("list = ");
+
+   temp = head;
+   while (temp != (struct list_block_s*) NULL) {
+      for (i = 0; i < temp->count; i++)
+         printf("%d ", temp->keys[i]);
+      temp = temp->next;
+   }
+   printf("\n");
+}  /* Imprimir */
+
+/*-----------------------------------------------------------------*/
+/* No usa locks: no se puede ejecutar con los otros subprocesos */
+void Print_stats(void) {
+   struct list_block_s* temp;
+   long blocks = 0, keys = 0;
+
+   for (temp = head; temp != NULL; temp = temp->next) {
+      blocks++;
+      keys += temp->count;
+   }
+   printf("Bloques = %ld, keys = %ld, ocupación media = %.1f%%\n",
+         blocks, keys, 100.0*keys/(blocks*BLOCK_KEYS));
+}  /* Print_stats */
+
+/*-----------------------------------------------------------------*/
+int  Member(int value) {
+   struct list_block_s* curr = Find_block(value);
+   int pos = Rank_in_block(curr, value);
+   int rv = (pos < curr->count && curr->keys[pos] == value);
+
+   prof_mutex_unlock(&(curr->mutex));
+#  ifdef DEBUG
+   if (rv)
+      printf("%d esta en la lista\n", value);
+   else
+      printf("%d no esta en la lista\n", value);
+#  endif
+   return rv;
+}  /* Es miembro */
+
+/*-----------------------------------------------------------------*/
+/* Elimina valor de la lista */
+/* Si el valor está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Delete(int value) {
+   struct list_block_s* curr = Find_block(value);
+   int pos, i;
+
+   pos = Rank_in_block(curr, value);
+   if (pos >= curr->count || curr->keys[pos] != value) {
+      prof_mutex_unlock(&(curr->mutex));
+      return 0;
+   }
+
+#  ifdef DEBUG
+   printf("Liberando %d\n", value);
+#  endif
+   for (i = pos; i < curr->count - 1; i++)
+      curr->keys[i] = curr->keys[i+1];
+   curr->count--;
+   curr->keys[curr->count] = INT_MAX;
+   if (curr->count < BLOCK_KEYS/4)
+      Merge_next(curr);
+   prof_mutex_unlock(&(curr->mutex));
+
+   return 1;
+}  /* Eliminar */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores y mezclarlo con la lista en un
+ *             solo recorrido mano sobre mano: para cada valor se avanza
+ *             como en Find_block desde el bloque donde quedó el anterior
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   struct list_block_s* curr = head;
+   struct list_block_s* next;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, j, pos, inserted = 0;
+
+   prof_mutex_lock(&(curr->mutex));
+   for (j = 0; j < n; j++) {
+      if (j > 0 && sorted[j] == sorted[j-1]) continue;
+      while (curr->next != NULL &&
+            (curr->count == 0 || curr->keys[curr->count-1] < sorted[j])) {
+         next = curr->next;
+         prof_mutex_lock(&(next->mutex));
+         prof_mutex_unlock(&(curr->mutex));
+         curr = next;
+      }
+      pos = Rank_in_block(curr, sorted[j]);
+      if (pos < curr->count && curr->keys[pos] == sorted[j]) continue;
+
+      if (curr->count == BLOCK_KEYS) {
+         Split_block(curr);
+         if (pos > BLOCK_KEYS/2) {
+            next = curr->next;
+            prof_mutex_lock(&(next->mutex));
+            prof_mutex_unlock(&(curr->mutex));
+            curr = next;
+            pos -= BLOCK_KEYS/2;
+         }
+      }
+      for (i = curr->count; i > pos; i--)
+         curr->keys[i] = curr->keys[i-1];
+      curr->keys[pos] = sorted[j];
+      curr->count++;
+      inserted++;
+   }
+   prof_mutex_unlock(&(curr->mutex));
+
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+/* No usa locks. Solo se puede ejecutar cuando ningún otro thread
+ * está accediendo a la lista.
+ */
+void Free_list(void) {
+   struct list_block_s* current = head;
+   struct list_block_s* following;
+
+   while (current != NULL) {
+      following = current->next;
+      prof_mutex_destroy(&(current->mutex));
+      free(current);
+      current = following;
+   }
+   head = NULL;
+}  /* Free_list */
+
+/*-----------------------------------------------------------------*/
+int  Is_empty(void) {
+   if (head->count == 0 && head->next == NULL)
+      return 1;
+   else
+      return 0;
+}  /* Es vacio */
+
+/*-----------------------------------------------------------------*/
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   int i, val;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
+   int my_member=0, my_insert=0, my_delete=0;
+   int ops_per_thread = total_ops/thread_count;
+
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
+   for (i = 0; i < ops_per_thread; i++) {
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
+#        ifdef DEBUG
+         printf("Thread %ld > Buscando %d\n", my_rank, val);
+#        endif
+         Member(val);
+         my_member++;
+      } else if (op == WL_INSERT) {
+#        ifdef DEBUG
+         printf("Thread %ld > Intentando insertar %d\n", my_rank, val);
+#        endif
+         Insert(val);
+         my_insert++;
+      } else { /* Eliminar */
+#        ifdef DEBUG
+         printf("Thread %ld > Intentando eliminar %d\n", my_rank, val);
+#        endif
+         Delete(val);
+         my_delete++;
+      }
+      lat_record(my_rank, op, t0);
+   }  /* for */
+
+   op_counts[my_rank].member = my_member;
+   op_counts[my_rank].insert = my_insert;
+   op_counts[my_rank].delete = my_delete;
+
+   return NULL;
+}  /* Thread_work */
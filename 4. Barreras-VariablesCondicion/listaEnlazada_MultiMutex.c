@@ -4,16 +4,20 @@
  *            entradas con ops insertar, imprimir, miembro, eliminar, lista libre. 
  *            Esta versión usa un mutex por nodo de lista
  * 
- * Compilar:  gcc -g -Wall -I. -o ejecutable listaEnlazada_MultiMutex.c my_rand.c -lpthread
- *            se necesita timer.h y my_rand.h
+ * Compilar:  gcc -g -Wall -I. -o ejecutable listaEnlazada_MultiMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *            (-DLOCK_ORDER_CHECK: prueba de estrés, -DTRAVERSAL_STATS)
+ *            se necesita timer.h, my_rand.h, rng.h, workload.h, latency.h, pool.h,
+ *            batch.h, lock_prof.h y cacheline.h
  *
- * Ejecutar:  ./ejecutable <thread_count>
+ * Ejecutar:  ./ejecutable <thread_count> [opciones de carga]
  * Entrada:   Número total de keys insertadas por thread principal
  *            Número total de operaciones realizadas por cada hilo 
  *            (todos los hilos llevan a cabo el mismo número de operaciones)
  *            porcentaje de operaciones que son búsquedas e inserciones 
  *            (las operaciones restantes son eliminaciones).
  * Salida:    Tiempo transcurrido para realizar las operaciones
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
  *
  * Notas:
  *    1. No se permiten valores repetidos en la lista.
@@ -24,19 +28,49 @@
  *       este programa usa un generador congruencial lineal simple.
  *    5. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que 
  *       los subprocesos hayan trabajado en ella.
- *    6. Solo Insert, Member y Delete usan bloqueos: Print y Free_List *no* 
+ *    6. Solo Insert, Member, Delete y sus versiones por lotes (Insert_many,
+ *       Member_many, Delete_many: un lote ordenado con batch.c en un solo
+ *       recorrido) usan bloqueos: Print y Free_List *no* 
  *       se deben llamar cuando varios subprocesos están accediendo a la lista.
  *    7. Steffen Christgau y Bettina Schnor señalaron algunos errores en las 
  *       implementaciones de los recorridos de la lista. Estos se corrigieron 
  *       el 22 de febrero de 2017.
+ *    8. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
+ *    9. Con -DLOCK_PROF los mutex se miden por clase (head_mutex, nodo)
+ *       y al salir se imprime cuántas adquisiciones fueron contendidas
+ *       y los tiempos de espera y retención.
+ *   10. head_mutex protege solo el puntero head: Init_ptrs y Member lo
+ *       liberan en cuanto tienen el lock del primer nodo, salvo que la
+ *       operación tenga que modificar head. El thread tiene head_mutex
+ *       si y solo si pred == NULL.
+ *   11. Con -DLOCK_ORDER_CHECK cada lock se valida contra el protocolo
+ *       mano sobre mano (orden creciente, nodos adyacentes, ningún lock
+ *       al terminar una operación) y al final se verifica la lista; ante
+ *       un error el programa aborta. Con -DTRAVERSAL_STATS se imprime
+ *       cuántos recorridos pasan de la cabeza al mismo tiempo (ver
+ *       barrido_recorridos.sh).
+ *   12. head_mutex ocupa su propia línea de cache (cacheline.h).
  *
  * IPP:   Sección 4.9.2 (pp. 186 and ff.)
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <pthread.h>
 #include "my_rand.h"
 #include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "batch.h"
 
 /* Los ints aleatorias son inferiores a MAX_KEY */
 const int MAX_KEY = 100000000;
@@ -49,21 +83,49 @@ const int END_OF_LIST = 0;
 /* Estructura para nodos de la lista */
 struct list_node_s {
    int    data;
-   pthread_mutex_t mutex;
+   prof_mutex_t mutex;
    struct list_node_s* next;
 };
 
 /* Variables compartidas */
 struct list_node_s* head = NULL;  
-pthread_mutex_t head_mutex;
+struct padded_mutex_s head_mutex;
 int         thread_count;
+wl_config_t workload;
 int         total_ops;
 double      insert_percent;
 double      search_percent;
 double      delete_percent;
-pthread_mutex_t count_mutex;
+wl_counts_t* op_counts;
 int         member_total=0, insert_total=0, delete_total=0;
 
+#ifdef LOCK_ORDER_CHECK
+/* Locks que tiene cada thread, en orden de rango */
+#define MAX_HELD 3
+struct held_lock_s {
+   void* lock;
+   long long rank;
+   struct list_node_s* node;   /* NULL para head_mutex */
+};
+__thread struct held_lock_s held[MAX_HELD];
+__thread int held_count = 0;
+#endif
+
+#ifdef TRAVERSAL_STATS
+/* Threads que recorren la lista más allá de la cabeza */
+long        active_traversals = 0;
+__thread int  my_traversing = 0;
+__thread long my_entered = 0, my_concurrency = 0, my_max_concurrency = 0;
+long        traversal_entered = 0, traversal_concurrency = 0;
+long        traversal_max = 0;
+
+/* Recorridos de un thread; main los suma al final */
+struct traversal_count_s {
+   long entered, concurrency, max_concurrency;
+};
+struct traversal_count_s* traversal_counts;
+#endif
+
 /* Setup y cleanup */
 void        Usage(char* prog_name);
 void        Get_input(int* inserts_in_main_p);
@@ -71,42 +133,70 @@ void        Get_input(int* inserts_in_main_p);
 /* Función de Thread */
 void*       Thread_work(void* rank);
 
+/* Locks de la lista */
+void        Lock_head(void);
+void        Unlock_head(void);
+void        Lock_node(struct list_node_s* node);
+void        Lock_new_node(struct list_node_s* node);
+void        Unlock_node(struct list_node_s* node);
+void        Traversal_begin(void);
+void        Traversal_end(void);
+#ifdef LOCK_ORDER_CHECK
+void        Order_acquire(void* lock, long long rank, struct list_node_s* node,
+      int check);
+void        Order_release(void* lock);
+void        Order_violation(const char* msg, long long rank);
+void        Order_check_none(void);
+void        Check_list(void);
+#endif
+
 /* Lista de operaciones */
 void        Init_ptrs(struct list_node_s** curr_pp, 
-      struct list_node_s** pred_pp);
+      struct list_node_s** pred_pp, int value);
 int         Advance_ptrs(struct list_node_s** curr_pp, 
       struct list_node_s** pred_pp);
 int         Insert(int value);
 void        Print(void);
 int         Member(int value);
 int         Delete(int value);
+int         Insert_many(int values[], int n);
+int         Member_many(int values[], int n, unsigned char bitmap[]);
+int         Delete_many(int values[], int n);
 void        Free_list(void);
 int         Is_empty(void);
 
 /*-----------------------------------------------------------------*/
 int main(int argc, char* argv[]) {
    long i; 
-   int key, success, attempts;
-   pthread_t* thread_handles;
+   pool_t pool;
+   af_placement_t placement;
    int inserts_in_main;
-   unsigned seed = 1;
+   bt_ops_t ops = { Insert_many, Member_many, Delete_many };
    double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
 
-   if (argc != 2) Usage(argv[0]);
+   if (argc < 2) Usage(argv[0]);
    thread_count = strtol(argv[1], NULL, 10);
 
-   Get_input(&inserts_in_main);
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, 2)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+
+   prof_mutex_init(&head_mutex.mutex, "head_mutex");
+
+   pool_init(&pool, thread_count, &placement);
 
    /* Intenta insertar keys inserts_in_main, pero abandona despues */
    /* 2*inserts_in_main intentos.                                  */
-   i = attempts = 0;
-   pthread_mutex_init(&head_mutex, NULL);
-   while ( i < inserts_in_main && attempts < 2*inserts_in_main ) {
-      key = my_rand(&seed) % MAX_KEY;
-      success = Insert(key);
-      attempts++;
-      if (success) i++;
-   }
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
    printf("Keys %ld insertadas en la lista vacia\n", i);
 
 #  ifdef OUTPUT
@@ -115,21 +205,55 @@ int main(int argc, char* argv[]) {
    printf("\n");
 #  endif
 
-   thread_handles = malloc(thread_count*sizeof(pthread_t));
-   pthread_mutex_init(&count_mutex, NULL);
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+#  ifdef TRAVERSAL_STATS
+   traversal_counts = malloc(thread_count*sizeof(struct traversal_count_s));
+   if (traversal_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+#  endif
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
 
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
    GET_TIME(start);
-   for (i = 0; i < thread_count; i++)
-      pthread_create(&thread_handles[i], NULL, Thread_work, (void*) i);
-
-   for (i = 0; i < thread_count; i++)
-      pthread_join(thread_handles[i], NULL);
+   pool_run(&pool, Thread_work);
    GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_total += op_counts[i].member;
+      insert_total += op_counts[i].insert;
+      delete_total += op_counts[i].delete;
+#     ifdef TRAVERSAL_STATS
+      traversal_entered += traversal_counts[i].entered;
+      traversal_concurrency += traversal_counts[i].concurrency;
+      if (traversal_counts[i].max_concurrency > traversal_max)
+         traversal_max = traversal_counts[i].max_concurrency;
+#     endif
+   }
    printf("Tiempo transcurrido = %e seconds\n", finish - start);
    printf("Total de operaciones = %d\n", total_ops);
    printf("Operaciones Miembro  = %d\n", member_total);
    printf("Operaciones Insertar = %d\n", insert_total);
    printf("Operaciones Eliminar = %d\n", delete_total);
+   lat_report();
+#  ifdef TRAVERSAL_STATS
+   printf("Recorridos más allá de la cabeza = %ld de %d operaciones\n",
+         traversal_entered, total_ops);
+   printf("Recorridos simultáneos: promedio %.2f, máximo %ld\n",
+         traversal_entered ? (double) traversal_concurrency/traversal_entered
+                           : 0.0, traversal_max);
+   printf("RECORRIDOS %d %.3f %ld %e\n", thread_count,
+         traversal_entered ? (double) traversal_concurrency/traversal_entered
+                           : 0.0, traversal_max, total_ops/(finish - start));
+#  endif
+#  ifdef LOCK_ORDER_CHECK
+   Check_list();
+#  endif
 
 #  ifdef OUTPUT
    printf("Después de que terminan los threads, lista = \n");
@@ -138,9 +262,13 @@ int main(int argc, char* argv[]) {
 #  endif
 
    Free_list();
-   pthread_mutex_destroy(&head_mutex);
-   pthread_mutex_destroy(&count_mutex);
-   free(thread_handles);
+   lat_destroy();
+   prof_mutex_destroy(&head_mutex.mutex);
+   free(op_counts);
+#  ifdef TRAVERSAL_STATS
+   free(traversal_counts);
+#  endif
+   pool_destroy(&pool);
 
    return 0;
 }  /* main */
@@ -148,7 +276,8 @@ int main(int argc, char* argv[]) {
 
 /*-----------------------------------------------------------------*/
 void Usage(char* prog_name) {
-   fprintf(stderr, "Usar: %s <thread_count>\n", prog_name);
+   fprintf(stderr, "Usar: %s <thread_count> [opciones]\n", prog_name);
+   wl_usage();
    exit(0);
 }  /* Usar */
 
@@ -166,19 +295,202 @@ void Get_input(int* inserts_in_main_p) {
    delete_percent = 1.0 - (search_percent + insert_percent);
 }  /* Get_input */
 
+/*-----------------------------------------------------------------*/
+/* Función  :  Lock_head, Unlock_head, Lock_node, Lock_new_node,
+ *             Unlock_node
+ * Propósito:  Tomar y liberar los locks de la lista. El orden es
+ *             head_mutex y después los nodos en orden creciente de key,
+ *             siempre de a pares adyacentes (mano sobre mano).
+ *             Lock_new_node bloquea un nodo que todavía no está enlazado,
+ *             así que nadie más puede esperar por él.
+ * Nota:       Con -DLOCK_ORDER_CHECK cada adquisición se valida antes de
+ *             bloquear (ver Order_acquire).
+ */
+void Lock_head(void) {
+#  ifdef LOCK_ORDER_CHECK
+   Order_acquire(&head_mutex.mutex, LLONG_MIN, NULL, 1);
+#  endif
+   prof_mutex_lock(&head_mutex.mutex);
+}  /* Lock_head */
+
+void Unlock_head(void) {
+#  ifdef LOCK_ORDER_CHECK
+   Order_release(&head_mutex.mutex);
+#  endif
+   prof_mutex_unlock(&head_mutex.mutex);
+}  /* Unlock_head */
+
+void Lock_node(struct list_node_s* node) {
+#  ifdef LOCK_ORDER_CHECK
+   Order_acquire(&node->mutex, node->data, node, 1);
+#  endif
+   prof_mutex_lock(&node->mutex);
+}  /* Lock_node */
+
+void Lock_new_node(struct list_node_s* node) {
+#  ifdef LOCK_ORDER_CHECK
+   Order_acquire(&node->mutex, node->data, node, 0);
+#  endif
+   prof_mutex_lock(&node->mutex);
+}  /* Lock_new_node */
+
+void Unlock_node(struct list_node_s* node) {
+#  ifdef LOCK_ORDER_CHECK
+   Order_release(&node->mutex);
+#  endif
+   prof_mutex_unlock(&node->mutex);
+}  /* Unlock_node */
+
+#ifdef LOCK_ORDER_CHECK
+/*-----------------------------------------------------------------*/
+void Order_violation(const char* msg, long long rank) {
+   int i;
+
+   fprintf(stderr, "Error de protocolo de locks: %s (rango %lld)\n", msg, rank);
+   fprintf(stderr, "   locks tomados:");
+   for (i = 0; i < held_count; i++)
+      fprintf(stderr, " %lld", held[i].rank);
+   fprintf(stderr, "\n");
+   abort();
+}  /* Order_violation */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Order_acquire
+ * Propósito:  Verificar, antes de bloquear, que el thread respeta el
+ *             protocolo: a lo sumo MAX_HELD locks, cada uno con rango
+ *             (key, o LLONG_MIN para head_mutex) mayor que todos los que
+ *             ya tiene, y el nodo nuevo es el sucesor del último que
+ *             bloqueó. Si no, imprime el error y aborta.
+ * En args:    check: 0 para un nodo todavía no enlazado
+ */
+void Order_acquire(void* lock, long long rank, struct list_node_s* node,
+      int check) {
+   struct held_lock_s* last;
+
+   if (held_count == MAX_HELD) Order_violation("demasiados locks", rank);
+   if (check && held_count > 0) {
+      last = &held[held_count-1];
+      if (rank <= last->rank)
+         Order_violation("lock fuera de orden", rank);
+      if (last->node == NULL && head != node)
+         Order_violation("el nodo no es el primero de la lista", rank);
+      if (last->node != NULL && last->node->next != node)
+         Order_violation("el nodo no sigue al último bloqueado", rank);
+   }
+   held[held_count].lock = lock;
+   held[held_count].rank = rank;
+   held[held_count].node = node;
+   held_count++;
+   /* El nodo nuevo se enlaza delante del de mayor rango */
+   if (!check && held_count > 1 && held[held_count-2].rank > rank) {
+      held[held_count-1] = held[held_count-2];
+      held[held_count-2].lock = lock;
+      held[held_count-2].rank = rank;
+      held[held_count-2].node = node;
+   }
+}  /* Order_acquire */
+
+/*-----------------------------------------------------------------*/
+void Order_release(void* lock) {
+   int i;
+
+   for (i = 0; i < held_count; i++)
+      if (held[i].lock == lock) break;
+   if (i == held_count) Order_violation("se libera un lock que no se tiene", 0);
+   for (; i < held_count-1; i++)
+      held[i] = held[i+1];
+   held_count--;
+}  /* Order_release */
+
+/*-----------------------------------------------------------------*/
+/* Al terminar cada operación el thread no debe tener ningún lock */
+void Order_check_none(void) {
+   if (held_count != 0)
+      Order_violation("la operación terminó con locks tomados",
+            held[0].rank);
+}  /* Order_check_none */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Check_list
+ * Propósito:  Después de la prueba: la lista debe estar ordenada sin
+ *             repetidos y todos los mutex deben estar libres
+ */
+void Check_list(void) {
+   struct list_node_s* temp;
+   long count = 0;
+
+   /* Con -DLOCK_PROF el pthread_mutex_t es el primer campo */
+   if (pthread_mutex_trylock((pthread_mutex_t*) &head_mutex.mutex) != 0)
+      Order_violation("head_mutex quedó bloqueado", LLONG_MIN);
+   pthread_mutex_unlock((pthread_mutex_t*) &head_mutex.mutex);
+   for (temp = head; temp != NULL; temp = temp->next, count++) {
+      if (temp->next != NULL && temp->next->data <= temp->data)
+         Order_violation("la lista no está ordenada", temp->data);
+      if (pthread_mutex_trylock((pthread_mutex_t*) &temp->mutex) != 0)
+         Order_violation("un nodo quedó bloqueado", temp->data);
+      pthread_mutex_unlock((pthread_mutex_t*) &temp->mutex);
+   }
+   printf("Verificación de locks correcta: %ld nodos\n", count);
+}  /* Check_list */
+#endif
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Traversal_begin, Traversal_end
+ * Propósito:  Con -DTRAVERSAL_STATS, contar cuántos threads recorren la
+ *             lista más allá de la cabeza al mismo tiempo. Traversal_begin
+ *             se llama cuando el thread libera head_mutex y sigue con un
+ *             nodo bloqueado; Traversal_end al terminar la operación.
+ */
+void Traversal_begin(void) {
+#  ifdef TRAVERSAL_STATS
+   long now;
+
+   if (my_traversing) return;
+   my_traversing = 1;
+   now = __atomic_add_fetch(&active_traversals, 1, __ATOMIC_RELAXED);
+   my_entered++;
+   my_concurrency += now;
+   if (now > my_max_concurrency) my_max_concurrency = now;
+#  endif
+}  /* Traversal_begin */
+
+void Traversal_end(void) {
+#  ifdef TRAVERSAL_STATS
+   if (!my_traversing) return;
+   my_traversing = 0;
+   __atomic_sub_fetch(&active_traversals, 1, __ATOMIC_RELAXED);
+#  endif
+}  /* Traversal_end */
+
 /*-----------------------------------------------------------------*/
 /* Función  :  Init_ptrs
  * Propósito:  Inicialice los punteros pred y curr antes de iniciar 
  *             la búsqueda realizada por Insertar o Eliminar
+ * En arg:     value: la primera key que se busca. Si es mayor que la
+ *             del primer nodo, la operación no va a modificar head y
+ *             head_mutex se libera en cuanto se bloquea el primer nodo.
+ * Invariante: Al volver, el thread mantiene head_mutex si y solo si
+ *             *pred_pp == NULL, y mantiene el lock de *curr_pp si no
+ *             es NULL.
  */
-void Init_ptrs(struct list_node_s** curr_pp, struct list_node_s** pred_pp) {
+void Init_ptrs(struct list_node_s** curr_pp, struct list_node_s** pred_pp,
+      int value) {
+   struct list_node_s* first;
+
    *pred_pp = NULL;
-   pthread_mutex_lock(&head_mutex);
-   *curr_pp = head;
-   if (*curr_pp != NULL)
-      pthread_mutex_lock(&((*curr_pp)->mutex));
-// pthread_mutex_unlock(&head_mutex);
-      
+   Lock_head();
+   *curr_pp = first = head;
+   if (first == NULL) return;
+   Lock_node(first);
+   if (first->data < value) {
+      /* Nadie puede eliminar first sin su lock: head ya no hace falta */
+      Unlock_head();
+      Traversal_begin();
+      *pred_pp = first;
+      *curr_pp = first->next;
+      if (*curr_pp != NULL)
+         Lock_node(*curr_pp);
+   }
 }  /* Init_ptrs */
 
 /*-----------------------------------------------------------------*/
@@ -196,20 +508,22 @@ int Advance_ptrs(struct list_node_s** curr_pp, struct list_node_s** pred_pp) {
    if (curr_p == NULL) {
       if (pred_p == NULL) {
          /* A la cabeza de la lista */
-         pthread_mutex_unlock(&head_mutex);
+         Unlock_head();
          return EMPTY_LIST;
        } else {  /* No encabeza la lista */
          return END_OF_LIST;
        }
    } else { // *curr_pp != NULL
       if (curr_p->next != NULL)
-         pthread_mutex_lock(&(curr_p->next->mutex));
+         Lock_node(curr_p->next);
       else
          rv = END_OF_LIST;
-      if (pred_p != NULL)
-         pthread_mutex_unlock(&(pred_p->mutex));
-      else
-         pthread_mutex_unlock(&head_mutex);
+      if (pred_p != NULL) {
+         Unlock_node(pred_p);
+      } else {
+         Unlock_head();
+         Traversal_begin();
+      }
       *pred_pp = curr_p;
       *curr_pp = curr_p->next;
       return rv;
@@ -226,7 +540,7 @@ int Insert(int value) {
    struct list_node_s* temp;
    int rv = 1;
 
-   Init_ptrs(&curr, &pred);
+   Init_ptrs(&curr, &pred, value);
    
    while (curr != NULL && curr->data < value) {
       Advance_ptrs(&curr, &pred);
@@ -237,26 +551,26 @@ int Insert(int value) {
       printf("Inserting %d\n", value);
 #     endif
       temp = malloc(sizeof(struct list_node_s));
-      pthread_mutex_init(&(temp->mutex), NULL);
+      prof_mutex_init(&(temp->mutex), "nodo");
       temp->data = value;
       temp->next = curr;
       if (curr != NULL) 
-         pthread_mutex_unlock(&(curr->mutex));
+         Unlock_node(curr);
       if (pred == NULL) {
          // Insertar en el head de la lista
          head = temp;
-         pthread_mutex_unlock(&head_mutex);
+         Unlock_head();
       } else {
          pred->next = temp;
-         pthread_mutex_unlock(&(pred->mutex));
+         Unlock_node(pred);
       }
    } else { /* valor en la lista  */
       if (curr != NULL) 
-         pthread_mutex_unlock(&(curr->mutex));
+         Unlock_node(curr);
       if (pred != NULL)
-         pthread_mutex_unlock(&(pred->mutex));
+         Unlock_node(pred);
       else
-         pthread_mutex_unlock(&head_mutex);
+         Unlock_head();
       rv = 0;
    }
 
@@ -283,16 +597,17 @@ void Print(void) {
 int  Member(int value) {
    struct list_node_s *temp, *old_temp;
 
-   pthread_mutex_lock(&head_mutex);
+   Lock_head();
    temp = head;
-   if (temp != NULL) pthread_mutex_lock(&(temp->mutex));
-   pthread_mutex_unlock(&head_mutex);
+   if (temp != NULL) Lock_node(temp);
+   Unlock_head();
+   if (temp != NULL) Traversal_begin();
    while (temp != NULL && temp->data < value) {
       if (temp->next != NULL) 
-         pthread_mutex_lock(&(temp->next->mutex));
+         Lock_node(temp->next);
       old_temp = temp;
       temp = temp->next;
-      pthread_mutex_unlock(&(old_temp->mutex));
+      Unlock_node(old_temp);
    }
 
    if (temp == NULL || temp->data > value) {
@@ -300,13 +615,13 @@ int  Member(int value) {
       printf("%d no esta en la lista\n", value);
 #     endif
       if (temp != NULL) 
-         pthread_mutex_unlock(&(temp->mutex));
+         Unlock_node(temp);
       return 0;
    } else { /* temp != NULL && temp->data <= value */
 #     ifdef DEBUG
       printf("%d esta en la lista\n", value);
 #     endif
-      pthread_mutex_unlock(&(temp->mutex));
+      Unlock_node(temp);
       return 1;
    }
 }  /* Es miembro */
@@ -319,7 +634,7 @@ int Delete(int value) {
    struct list_node_s* pred;
    int rv = 1;
 
-   Init_ptrs(&curr, &pred);
+   Init_ptrs(&curr, &pred, value);
 
    /* Encuentra valor */
    while (curr != NULL && curr->data < value) {
@@ -332,33 +647,169 @@ int Delete(int value) {
 #        ifdef DEBUG
          printf("Liberando %d\n", value);
 #        endif
-         pthread_mutex_unlock(&head_mutex);
-         pthread_mutex_unlock(&(curr->mutex));
-         pthread_mutex_destroy(&(curr->mutex));
+         Unlock_head();
+         Unlock_node(curr);
+         prof_mutex_destroy(&(curr->mutex));
          free(curr);
       } else { /* pred != NULL */
          pred->next = curr->next;
-         pthread_mutex_unlock(&(pred->mutex));
+         Unlock_node(pred);
 #        ifdef DEBUG
          printf("Liberando %d\n", value);
 #        endif
-         pthread_mutex_unlock(&(curr->mutex));
-         pthread_mutex_destroy(&(curr->mutex));
+         Unlock_node(curr);
+         prof_mutex_destroy(&(curr->mutex));
          free(curr);
       }
    } else { /* No en lista */
       if (pred != NULL)
-         pthread_mutex_unlock(&(pred->mutex));
+         Unlock_node(pred);
+      else
+         Unlock_head();
       if (curr != NULL)
-         pthread_mutex_unlock(&(curr->mutex));
-      if (curr == head)
-         pthread_mutex_unlock(&head_mutex);
+         Unlock_node(curr);
       rv = 0;
    }
 
    return rv;
 }  /* Eliminar */
 
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores y mezclarlo con la lista en un
+ *             solo recorrido mano sobre mano
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred;
+   struct list_node_s* temp;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, inserted = 0;
+
+   Init_ptrs(&curr, &pred, n > 0 ? sorted[0] : 0);
+   for (i = 0; i < n; i++) {
+      if (i > 0 && sorted[i] == sorted[i-1]) continue;
+      while (curr != NULL && curr->data < sorted[i])
+         Advance_ptrs(&curr, &pred);
+      if (curr == NULL || curr->data > sorted[i]) {
+         /* El nodo nuevo pasa a ser pred: se bloquea antes de enlazarlo */
+         temp = malloc(sizeof(struct list_node_s));
+         prof_mutex_init(&(temp->mutex), "nodo");
+         temp->data = sorted[i];
+         Lock_new_node(temp);
+         temp->next = curr;
+         if (pred == NULL) {
+            head = temp;
+            Unlock_head();
+         } else {
+            pred->next = temp;
+            Unlock_node(pred);
+         }
+         pred = temp;
+         inserted++;
+      }
+   }
+   if (curr != NULL)
+      Unlock_node(curr);
+   if (pred != NULL)
+      Unlock_node(pred);
+   else
+      Unlock_head();
+   Traversal_end();
+
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Member_many
+ * Propósito:  Buscar un lote de valores en un solo recorrido mano sobre
+ *             mano
+ * Sal arg:    bitmap: BT_BIT(bitmap, i) vale 1 si values[i] está en la
+ *             lista. Debe tener BT_BITMAP_BYTES(n) bytes.
+ * Val Retorno: Número de valores encontrados
+ */
+int Member_many(int values[], int n, unsigned char bitmap[]) {
+   struct list_node_s *temp, *old_temp;
+   bt_pair_t* pairs = bt_sorted_pairs(values, n, bitmap);
+   int i, found = 0;
+
+   Lock_head();
+   temp = head;
+   if (temp != NULL) Lock_node(temp);
+   Unlock_head();
+   if (temp != NULL) Traversal_begin();
+   for (i = 0; i < n; i++) {
+      while (temp != NULL && temp->data < pairs[i].key) {
+         if (temp->next != NULL)
+            Lock_node(temp->next);
+         old_temp = temp;
+         temp = temp->next;
+         Unlock_node(old_temp);
+      }
+      if (temp != NULL && temp->data == pairs[i].key) {
+         bt_set(bitmap, pairs[i].idx);
+         found++;
+      }
+   }
+   if (temp != NULL)
+      Unlock_node(temp);
+   Traversal_end();
+
+   free(pairs);
+   return found;
+}  /* Member_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Delete_many
+ * Propósito:  Ordenar un lote de valores y eliminarlos de la lista en
+ *             un solo recorrido mano sobre mano
+ * Val Retorno: Número de valores eliminados
+ */
+int Delete_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred;
+   struct list_node_s* following;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, deleted = 0;
+
+   Init_ptrs(&curr, &pred, n > 0 ? sorted[0] : 0);
+   for (i = 0; i < n; i++) {
+      while (curr != NULL && curr->data < sorted[i])
+         Advance_ptrs(&curr, &pred);
+      if (curr != NULL && curr->data == sorted[i]) {
+         /* Bloquear el siguiente antes de desenlazar curr */
+         following = curr->next;
+         if (following != NULL)
+            Lock_node(following);
+         if (pred == NULL)
+            head = following;
+         else
+            pred->next = following;
+#        ifdef DEBUG
+         printf("Liberando %d\n", sorted[i]);
+#        endif
+         Unlock_node(curr);
+         prof_mutex_destroy(&(curr->mutex));
+         free(curr);
+         curr = following;
+         deleted++;
+      }
+   }
+   if (curr != NULL)
+      Unlock_node(curr);
+   if (pred != NULL)
+      Unlock_node(pred);
+   else
+      Unlock_head();
+   Traversal_end();
+
+   free(sorted);
+   return deleted;
+}  /* Delete_many */
+
 /*-----------------------------------------------------------------*/
 /* No usa locks. Solo se puede ejecutar cuando ningún otro thread 
  * está accediendo a la lista.
@@ -396,21 +847,27 @@ int  Is_empty(void) {
 void* Thread_work(void* rank) {
    long my_rank = (long) rank;
    int i, val;
-   double which_op;
-   unsigned seed = my_rank + 1;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
    int my_member=0, my_insert=0, my_delete=0;
    int ops_per_thread = total_ops/thread_count;
 
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
+#  ifdef TRAVERSAL_STATS
+   /* No contar los recorridos de la carga inicial (batch.c) */
+   my_entered = my_concurrency = my_max_concurrency = 0;
+#  endif
    for (i = 0; i < ops_per_thread; i++) {
-      which_op = my_drand(&seed);
-      val = my_rand(&seed) % MAX_KEY;
-      if (which_op < search_percent) {
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
 #        ifdef DEBUG
          printf("Thread %ld > Buscando %d\n", my_rank, val);
 #        endif
          Member(val);
          my_member++;
-      } else if (which_op < search_percent + insert_percent) {
+      } else if (op == WL_INSERT) {
 #        ifdef DEBUG
          printf("Thread %ld > Intentando insertar %d\n", my_rank, val);
 #        endif
@@ -423,13 +880,21 @@ void* Thread_work(void* rank) {
          Delete(val);
          my_delete++;
       }
+      lat_record(my_rank, op, t0);
+      Traversal_end();
+#     ifdef LOCK_ORDER_CHECK
+      Order_check_none();
+#     endif
    }  /* for */
 
-   pthread_mutex_lock(&count_mutex);
-   member_total += my_member;
-   insert_total += my_insert;
-   delete_total += my_delete;
-   pthread_mutex_unlock(&count_mutex);
+   op_counts[my_rank].member = my_member;
+   op_counts[my_rank].insert = my_insert;
+   op_counts[my_rank].delete = my_delete;
+#  ifdef TRAVERSAL_STATS
+   traversal_counts[my_rank].entered = my_entered;
+   traversal_counts[my_rank].concurrency = my_concurrency;
+   traversal_counts[my_rank].max_concurrency = my_max_concurrency;
+#  endif
 
    return NULL;
 }  /* Thread_work */
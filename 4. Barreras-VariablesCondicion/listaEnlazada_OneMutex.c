@@ -4,16 +4,19 @@
  *            con ops insertar, imprimir, miembro, eliminar, lista libre. 
  *            Esta versión usa un solo mutex
  * 
- * Compilar:  gcc -g -Wall -o ejecutable listaEnlazada_OneMutex.c my_rand.c -lpthread
- *            se necesita timer.h y my_rand.h
+ * Compilar:  gcc -g -Wall -o ejecutable listaEnlazada_OneMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *            se necesita timer.h, my_rand.h, rng.h, workload.h, latency.h, pool.h,
+ *            batch.h, lock_prof.h y cacheline.h
  *
- * Ejecutar:  ./ejecutable <thread_count>
+ * Ejecutar:  ./ejecutable <thread_count> [opciones de carga]
  * Entrada:   Número total de keys insertadas por thread principal
  *            número total de operaciones realizadas por cada hilo 
  *            (todos los hilos llevan a cabo el mismo número de operaciones)
  *            porcentaje de operaciones que son búsquedas e inserciones 
  *            (las operaciones restantes son eliminaciones).
  * Salida:    Tiempo transcurrido para realizar las operaciones
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
  *
  * Notas:
  *    1. No se permiten valores repetidos en la lista.
@@ -24,6 +27,21 @@
  *       este programa usa un generador congruencial lineal simple.
  *    5. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que 
  *       los subprocesos hayan trabajado en ella.
+ *    6. Insert_many, Member_many y Delete_many procesan un lote ordenado
+ *       (batch.c) en un solo recorrido y toman el mutex ellos mismos. main
+ *       carga la lista con Insert_many y, al terminar, bt_load comprueba
+ *       Member_many y Delete_many con el último lote.
+ *    7. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
+ *    8. Con -DLOCK_PROF los mutex se miden por clase (lista)
+ *       y al salir se imprime cuántas adquisiciones fueron contendidas
+ *       y los tiempos de espera y retención.
+ *    9. list_mutex ocupa su propia línea de cache (cacheline.h).
  *
  * IPP:   Sección 4.9.2 (pp. 185 and ff.)
  */
@@ -32,6 +50,12 @@
 #include <pthread.h>
 #include "my_rand.h"
 #include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "batch.h"
 
 /* Los ints aleatorias son inferiores a MAX_KEY */
 const int MAX_KEY = 100000000;
@@ -45,12 +69,13 @@ struct list_node_s {
 /* Variables compartidas */
 struct      list_node_s* head = NULL;  
 int         thread_count;
+wl_config_t workload;
 int         total_ops;
 double      insert_percent;
 double      search_percent;
 double      delete_percent;
-pthread_mutex_t mutex;
-pthread_mutex_t count_mutex;
+struct padded_mutex_s list_mutex;
+wl_counts_t* op_counts;
 int         member_total=0, insert_total=0, delete_total=0;
 
 /* Setup y cleanup */
@@ -65,32 +90,44 @@ int         Insert(int value);
 void        Print(void);
 int         Member(int value);
 int         Delete(int value);
+int         Insert_many(int values[], int n);
+int         Member_many(int values[], int n, unsigned char bitmap[]);
+int         Delete_many(int values[], int n);
 void        Free_list(void);
 int         Is_empty(void);
 
 /*-----------------------------------------------------------------*/
 int main(int argc, char* argv[]) {
    long i; 
-   int key, success, attempts;
-   pthread_t* thread_handles;
+   pool_t pool;
+   af_placement_t placement;
    int inserts_in_main;
-   unsigned seed = 1;
+   bt_ops_t ops = { Insert_many, Member_many, Delete_many };
    double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
 
-   if (argc != 2) Usage(argv[0]);
+   if (argc < 2) Usage(argv[0]);
    thread_count = strtol(argv[1],NULL,10);
 
-   Get_input(&inserts_in_main);
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, 2)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+
+   prof_mutex_init(&list_mutex.mutex, "lista");
+
+   pool_init(&pool, thread_count, &placement);
 
    /* Intenta insertar keys inserts_in_main, pero abandona despues */
    /* 2*inserts_in_main intentos.                                  */
-   i = attempts = 0;
-   while ( i < inserts_in_main && attempts < 2*inserts_in_main ) {
-      key = my_rand(&seed) % MAX_KEY;
-      success = Insert(key);
-      attempts++;
-      if (success) i++;
-   }
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
    printf("Keys %ld insertadas en la lista vacia\n", i);
 
 #  ifdef OUTPUT
@@ -99,22 +136,29 @@ int main(int argc, char* argv[]) {
    printf("\n");
 #  endif
 
-   thread_handles = malloc(thread_count*sizeof(pthread_t));
-   pthread_mutex_init(&mutex, NULL);
-   pthread_mutex_init(&count_mutex, NULL);
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
 
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
    GET_TIME(start);
-   for (i = 0; i < thread_count; i++)
-      pthread_create(&thread_handles[i], NULL, Thread_work, (void*) i);
-
-   for (i = 0; i < thread_count; i++)
-      pthread_join(thread_handles[i], NULL);
+   pool_run(&pool, Thread_work);
    GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_total += op_counts[i].member;
+      insert_total += op_counts[i].insert;
+      delete_total += op_counts[i].delete;
+   }
    printf("Tiempo transcurrido = %e seconds\n", finish - start);
    printf("Total de operaciones = %d\n", total_ops);
    printf("Operaciones Miembro  = %d\n", member_total);
    printf("Operaciones Insertar = %d\n", insert_total);
    printf("Operaciones Eliminar = %d\n", delete_total);
+   lat_report();
 
 #  ifdef OUTPUT
    printf("Después de que terminan los threads, lista = \n");
@@ -123,9 +167,10 @@ int main(int argc, char* argv[]) {
 #  endif
 
    Free_list();
-   pthread_mutex_destroy(&mutex);
-   pthread_mutex_destroy(&count_mutex);
-   free(thread_handles);
+   lat_destroy();
+   prof_mutex_destroy(&list_mutex.mutex);
+   free(op_counts);
+   pool_destroy(&pool);
 
    return 0;
 }  /* main */
@@ -133,7 +178,8 @@ int main(int argc, char* argv[]) {
 
 /*-----------------------------------------------------------------*/
 void Usage(char* prog_name) {
-   fprintf(stderr, "Usar: %s <thread_count>\n", prog_name);
+   fprintf(stderr, "Usar: %s <thread_count> [opciones]\n", prog_name);
+   wl_usage();
    exit(0);
 }  /* Usar */
 
@@ -251,6 +297,114 @@ int Delete(int value) {
    return rv;
 }  /* Eliminar */
 
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores y mezclarlo con la lista en un
+ *             solo recorrido
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, inserted = 0;
+
+   prof_mutex_lock(&list_mutex.mutex);
+   curr = head;
+   for (i = 0; i < n; i++) {
+      if (i > 0 && sorted[i] == sorted[i-1]) continue;
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr == NULL || curr->data > sorted[i]) {
+         temp = malloc(sizeof(struct list_node_s));
+         temp->data = sorted[i];
+         temp->next = curr;
+         if (pred == NULL)
+            head = temp;
+         else
+            pred->next = temp;
+         pred = temp;
+         inserted++;
+      }
+   }
+   prof_mutex_unlock(&list_mutex.mutex);
+
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Member_many
+ * Propósito:  Buscar un lote de valores en un solo recorrido
+ * Sal arg:    bitmap: BT_BIT(bitmap, i) vale 1 si values[i] está en la
+ *             lista. Debe tener BT_BITMAP_BYTES(n) bytes.
+ * Val Retorno: Número de valores encontrados
+ */
+int Member_many(int values[], int n, unsigned char bitmap[]) {
+   struct list_node_s* temp;
+   bt_pair_t* pairs = bt_sorted_pairs(values, n, bitmap);
+   int i, found = 0;
+
+   prof_mutex_lock(&list_mutex.mutex);
+   temp = head;
+   for (i = 0; i < n; i++) {
+      while (temp != NULL && temp->data < pairs[i].key)
+         temp = temp->next;
+      if (temp != NULL && temp->data == pairs[i].key) {
+         bt_set(bitmap, pairs[i].idx);
+         found++;
+      }
+   }
+   prof_mutex_unlock(&list_mutex.mutex);
+
+   free(pairs);
+   return found;
+}  /* Member_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Delete_many
+ * Propósito:  Ordenar un lote de valores y eliminarlos de la lista en
+ *             un solo recorrido
+ * Val Retorno: Número de valores eliminados
+ */
+int Delete_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* following;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, deleted = 0;
+
+   prof_mutex_lock(&list_mutex.mutex);
+   curr = head;
+   for (i = 0; i < n; i++) {
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr != NULL && curr->data == sorted[i]) {
+         following = curr->next;
+         if (pred == NULL)
+            head = following;
+         else
+            pred->next = following;
+#        ifdef DEBUG
+         printf("Liberando %d\n", sorted[i]);
+#        endif
+         free(curr);
+         curr = following;
+         deleted++;
+      }
+   }
+   prof_mutex_unlock(&list_mutex.mutex);
+
+   free(sorted);
+   return deleted;
+}  /* Delete_many */
+
 /*-----------------------------------------------------------------*/
 void Free_list(void) {
    struct list_node_s* current;
@@ -285,37 +439,38 @@ int  Is_empty(void) {
 void* Thread_work(void* rank) {
    long my_rank = (long) rank;
    int i, val;
-   double which_op;
-   unsigned seed = my_rank + 1;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
    int my_member=0, my_insert=0, my_delete=0;
    int ops_per_thread = total_ops/thread_count;
 
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
    for (i = 0; i < ops_per_thread; i++) {
-      which_op = my_drand(&seed);
-      val = my_rand(&seed) % MAX_KEY;
-      if (which_op < search_percent) {
-         pthread_mutex_lock(&mutex);
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
+         prof_mutex_lock(&list_mutex.mutex);
          Member(val);
-         pthread_mutex_unlock(&mutex);
+         prof_mutex_unlock(&list_mutex.mutex);
          my_member++;
-      } else if (which_op < search_percent + insert_percent) {
-         pthread_mutex_lock(&mutex);
+      } else if (op == WL_INSERT) {
+         prof_mutex_lock(&list_mutex.mutex);
          Insert(val);
-         pthread_mutex_unlock(&mutex);
+         prof_mutex_unlock(&list_mutex.mutex);
          my_insert++;
       } else { /* delete */
-         pthread_mutex_lock(&mutex);
+         prof_mutex_lock(&list_mutex.mutex);
          Delete(val);
-         pthread_mutex_unlock(&mutex);
+         prof_mutex_unlock(&list_mutex.mutex);
          my_delete++;
       }
+      lat_record(my_rank, op, t0);
    }  /* for */
 
-   pthread_mutex_lock(&count_mutex);
-   member_total += my_member;
-   insert_total += my_insert;
-   delete_total += my_delete;
-   pthread_mutex_unlock(&count_mutex);
+   op_counts[my_rank].member = my_member;
+   op_counts[my_rank].insert = my_insert;
+   op_counts[my_rank].delete = my_delete;
 
    return NULL;
 }  /* Thread_work */
@@ -0,0 +1,501 @@
+/* Archivo:   listaEnlazada_Particionada.c
+ *
+ * Propósito: Implementar un conjunto de múltiples subprocesos con ops insertar,
+ *            imprimir, miembro, eliminar, lista libre, particionado en
+ *            shard_count sublistas enlazadas ordenadas e independientes.
+ *            Cada sublista tiene su propio mutex.
+ *
+ * Compilar:  gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_Particionada.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *            se necesita timer.h, my_rand.h, rng.h, workload.h, latency.h, pool.h,
+ *            batch.h, lock_prof.h y cacheline.h
+ *
+ * Ejecutar:  ./ejecutable <thread_count> <shard_count> [opciones de carga]
+ * Entrada:   Número total de keys insertadas por thread principal
+ *            Número total de operaciones realizadas por cada hilo
+ *            (todos los hilos llevan a cabo el mismo número de operaciones)
+ *            porcentaje de operaciones que son búsquedas e inserciones
+ *            (las operaciones restantes son eliminaciones).
+ * Salida:    Tiempo transcurrido para realizar las operaciones, throughput
+ *            y una línea "RESUMEN <shards> <threads> <ops/s>" para barridos
+ *            (ver barrido_particiones.sh)
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
+ *
+ * Notas:
+ *    1. No se permiten valores repetidos en la lista.
+ *    2. Indicador de compilación DEBUG utilizado. Para obtener la salida de
+ *       depuración, compile con el indicador de línea de comando -DDEBUG.
+ *    3. Por defecto se particiona el rango [0, MAX_KEY) en shard_count
+ *       intervalos contiguos, así Print recorre las sublistas en orden.
+ *       Con -DHASH_SHARDS se usa un hash multiplicativo de la key, que
+ *       reparte mejor claves no uniformes pero Print ya no sale ordenado.
+ *    4. Cada sublista ocupa su propia línea de cache (cacheline.h) para que
+ *       los mutex de sublistas vecinas no compartan línea.
+ *    5. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que
+ *       los subprocesos hayan trabajado en ella.
+ *    6. Solo Insert, Member, Delete e Insert_many usan bloqueos: Print y
+ *       Free_List *no* se deben llamar cuando varios subprocesos están
+ *       accediendo a la lista. Insert_many ordena el lote (batch.c), lo
+ *       agrupa por sublista y mezcla cada grupo en un solo recorrido con
+ *       el mutex de su sublista.
+ *    7. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
+ *    8. Con -DLOCK_PROF los mutex se miden por clase (sublista)
+ *       y al salir se imprime cuántas adquisiciones fueron contendidas
+ *       y los tiempos de espera y retención.
+ *
+ * IPP:   Sección 4.9.2 (pp. 185 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "my_rand.h"
+#include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "batch.h"
+
+/* Los ints aleatorias son inferiores a MAX_KEY */
+const int MAX_KEY = 100000000;
+
+/* Estructura para nodos de la lista */
+struct list_node_s {
+   int    data;
+   struct list_node_s* next;
+};
+
+/* Estructura para cada sublista */
+struct shard_s {
+   struct list_node_s* head;
+   prof_mutex_t mutex;
+} __attribute__((aligned(SHARED_ALIGN)));
+
+/* Variables compartidas */
+struct shard_s* shards;
+int         shard_count;
+int         thread_count;
+wl_config_t workload;
+int         total_ops;
+double      insert_percent;
+double      search_percent;
+double      delete_percent;
+wl_counts_t* op_counts;
+int         member_total=0, insert_total=0, delete_total=0;
+
+/* Setup y cleanup */
+void        Usage(char* prog_name);
+void        Get_input(int* inserts_in_main_p);
+
+/* Función de Thread */
+void*       Thread_work(void* rank);
+
+/* Lista de operaciones */
+struct shard_s* Shard_of(int value);
+int         Insert(int value);
+void        Print(void);
+int         Member(int value);
+int         Delete(int value);
+int         Insert_many(int values[], int n);
+int         Merge_shard(struct shard_s* shard_p, int sorted[], int n);
+void        Free_list(void);
+int         Is_empty(void);
+
+/*-----------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long i;
+   pool_t pool;
+   af_placement_t placement;
+   int inserts_in_main;
+   bt_ops_t ops = { Insert_many, NULL, NULL };
+   double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
+
+   if (argc < 3) Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   shard_count = strtol(argv[2], NULL, 10);
+   if (thread_count <= 0 || shard_count <= 0) Usage(argv[0]);
+
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, 3)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+
+   if (posix_memalign((void**) &shards, CACHE_LINE,
+            shard_count*sizeof(struct shard_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   for (i = 0; i < shard_count; i++) {
+      shards[i].head = NULL;
+      prof_mutex_init(&shards[i].mutex, "sublista");
+   }
+
+   pool_init(&pool, thread_count, &placement);
+
+   /* Intenta insertar keys inserts_in_main, pero abandona despues */
+   /* 2*inserts_in_main intentos.                                  */
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
+   printf("Keys %ld insertadas en la lista vacia\n", i);
+
+#  ifdef OUTPUT
+   printf("Antes de comenzar los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
+   GET_TIME(start);
+   pool_run(&pool, Thread_work);
+   GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_total += op_counts[i].member;
+      insert_total += op_counts[i].insert;
+      delete_total += op_counts[i].delete;
+   }
+   printf("Tiempo transcurrido = %e seconds\n", finish - start);
+   printf("Total de operaciones = %d\n", total_ops);
+   printf("Operaciones Miembro  = %d\n", member_total);
+   printf("Operaciones Insertar = %d\n", insert_total);
+   printf("Operaciones Eliminar = %d\n", delete_total);
+   lat_report();
+   printf("Throughput = %e ops/s con %d sublistas\n",
+         (member_total + insert_total + delete_total)/(finish - start),
+         shard_count);
+   printf("RESUMEN %d %d %e\n", shard_count, thread_count,
+         (member_total + insert_total + delete_total)/(finish - start));
+
+#  ifdef OUTPUT
+   printf("Después de que terminan los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   Free_list();
+   lat_destroy();
+   for (i = 0; i < shard_count; i++)
+      prof_mutex_destroy(&shards[i].mutex);
+   free(op_counts);
+   free(shards);
+   pool_destroy(&pool);
+
+   return 0;
+}  /* main */
+
+
+/*-----------------------------------------------------------------*/
+void Usage(char* prog_name) {
+   fprintf(stderr, "Usar: %s <thread_count> <shard_count> [opciones]\n",
+         prog_name);
+   wl_usage();
+   exit(0);
+}  /* Usar */
+
+/*-----------------------------------------------------------------*/
+void Get_input(int* inserts_in_main_p) {
+
+   printf("¿Cuántas keys se deben insertar en el thread principal?\n");
+   scanf("%d", inserts_in_main_p);
+   printf("¿Cuántas operaciones en total se deben ejecutar?\n");
+   scanf("%d", &total_ops);
+   printf("¿Porcentaje de operaciones que deberían ser búsquedas? (entre 0 y 1)\n");
+   scanf("%lf", &search_percent);
+   printf("¿Porcentaje de operaciones que deberían ser inserciones? (entre 0 y 1)\n");
+   scanf("%lf", &insert_percent);
+   delete_percent = 1.0 - (search_percent + insert_percent);
+}  /* Get_input */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Shard_of
+ * Propósito:  Devolver la sublista responsable de value
+ */
+struct shard_s* Shard_of(int value) {
+#  ifdef HASH_SHARDS
+   unsigned h = (unsigned) value * 2654435761U;
+   return &shards[((unsigned long long) h * shard_count) >> 32];
+#  else
+   return &shards[(long long) value * shard_count / MAX_KEY];
+#  endif
+}  /* Shard_of */
+
+/*-----------------------------------------------------------------*/
+/* Inserta el valor en la ubicación numérica correcta en la lista */
+/* Si el valor no está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Insert(int value) {
+   struct shard_s* shard_p = Shard_of(value);
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int rv = 1;
+
+   prof_mutex_lock(&shard_p->mutex);
+   curr = shard_p->head;
+   while (curr != NULL && curr->data < value) {
+      pred = curr;
+      curr = curr->next;
+   }
+
+   if (curr == NULL || curr->data > value) {
+#     ifdef DEBUG
+      printf("Inserting %d\n", value);
+#     endif
+      temp = malloc(sizeof(struct list_node_s));
+      temp->data = value;
+      temp->next = curr;
+      if (pred == NULL)
+         shard_p->head = temp;
+      else
+         pred->next = temp;
+   } else { /* valor en la lista */
+      rv = 0;
+   }
+   prof_mutex_unlock(&shard_p->mutex);
+
+   return rv;
+}  /* Insertar */
+
+/*-----------------------------------------------------------------*/
+/* No usa locks: no se puede ejecutar con los otros subprocesos */
+void Print(void) {
+   struct list_node_s* temp;
+   int s;
+
+   printf("list = ");
+
+   for (s = 0; s < shard_count; s++) {
+      temp = shards[s].head;
+      while (temp != (struct list_node_s*) NULL) {
+         printf("%d ", temp->data);
+         temp = temp->next;
+      }
+   }
+   printf("\n");
+}  /* Imprimir */
+
+
+/*-----------------------------------------------------------------*/
+int  Member(int value) {
+   struct shard_s* shard_p = Shard_of(value);
+   struct list_node_s* temp;
+   int rv;
+
+   prof_mutex_lock(&shard_p->mutex);
+   temp = shard_p->head;
+   while (temp != NULL && temp->data < value)
+      temp = temp->next;
+   rv = (temp != NULL && temp->data == value);
+   prof_mutex_unlock(&shard_p->mutex);
+
+#  ifdef DEBUG
+   if (rv)
+      printf("%d esta en la lista\n", value);
+   else
+      printf("%d no esta en la lista\n", value);
+#  endif
+   return rv;
+}  /* Es miembro */
+
+/*-----------------------------------------------------------------*/
+/* Elimina valor de la lista */
+/* Si el valor está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Delete(int value) {
+   struct shard_s* shard_p = Shard_of(value);
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   int rv = 1;
+
+   prof_mutex_lock(&shard_p->mutex);
+   curr = shard_p->head;
+   /* Encuentra valor */
+   while (curr != NULL && curr->data < value) {
+      pred = curr;
+      curr = curr->next;
+   }
+
+   if (curr != NULL && curr->data == value) {
+      if (pred == NULL) /* primer elemento de la sublista */
+         shard_p->head = curr->next;
+      else
+         pred->next = curr->next;
+#     ifdef DEBUG
+      printf("Liberando %d\n", value);
+#     endif
+      free(curr);
+   } else { /* No en lista */
+      rv = 0;
+   }
+   prof_mutex_unlock(&shard_p->mutex);
+
+   return rv;
+}  /* Eliminar */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores, agruparlo por sublista sin
+ *             perder el orden (counting sort estable) y mezclar cada
+ *             grupo con su sublista en un solo recorrido
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   int* sorted = bt_sorted_copy(values, n);
+   int* grouped = malloc((n > 0 ? n : 1)*sizeof(int));
+   int* start = calloc(shard_count + 1, sizeof(int));
+   int i, s, inserted = 0;
+
+   if (grouped == NULL || start == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   for (i = 0; i < n; i++)
+      start[Shard_of(sorted[i]) - shards + 1]++;
+   for (s = 0; s < shard_count; s++)
+      start[s+1] += start[s];
+   for (i = 0; i < n; i++)
+      grouped[start[Shard_of(sorted[i]) - shards]++] = sorted[i];
+
+   /* Ahora start[s] es el final del grupo s */
+   for (s = 0, i = 0; s < shard_count; i = start[s], s++)
+      if (start[s] > i)
+         inserted += Merge_shard(&shards[s], grouped + i, start[s] - i);
+
+   free(start);
+   free(grouped);
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Merge_shard
+ * Propósito:  Mezclar n valores ordenados, todos de la misma sublista,
+ *             con esa sublista en un solo recorrido
+ * Val Retorno: Número de valores insertados
+ */
+int Merge_shard(struct shard_s* shard_p, int sorted[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int i, inserted = 0;
+
+   prof_mutex_lock(&shard_p->mutex);
+   curr = shard_p->head;
+   for (i = 0; i < n; i++) {
+      if (i > 0 && sorted[i] == sorted[i-1]) continue;
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr == NULL || curr->data > sorted[i]) {
+         temp = malloc(sizeof(struct list_node_s));
+         temp->data = sorted[i];
+         temp->next = curr;
+         if (pred == NULL)
+            shard_p->head = temp;
+         else
+            pred->next = temp;
+         pred = temp;
+         inserted++;
+      }
+   }
+   prof_mutex_unlock(&shard_p->mutex);
+
+   return inserted;
+}  /* Merge_shard */
+
+/*-----------------------------------------------------------------*/
+/* No usa locks. Solo se puede ejecutar cuando ningún otro thread
+ * está accediendo a la lista.
+ */
+void Free_list(void) {
+   struct list_node_s* current;
+   struct list_node_s* following;
+   int s;
+
+   for (s = 0; s < shard_count; s++) {
+      current = shards[s].head;
+      while (current != NULL) {
+         following = current->next;
+#        ifdef DEBUG
+         printf("Liberando %d\n", current->data);
+#        endif
+         free(current);
+         current = following;
+      }
+      shards[s].head = NULL;
+   }
+}  /* Free_list */
+
+/*-----------------------------------------------------------------*/
+int  Is_empty(void) {
+   int s;
+
+   for (s = 0; s < shard_count; s++)
+      if (shards[s].head != NULL)
+         return 0;
+   return 1;
+}  /* Es vacio */
+
+/*-----------------------------------------------------------------*/
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   int i, val;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
+   int my_member=0, my_insert=0, my_delete=0;
+   int ops_per_thread = total_ops/thread_count;
+
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
+   for (i = 0; i < ops_per_thread; i++) {
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
+#        ifdef DEBUG
+         printf("Thread %ld > Buscando %d\n", my_rank, val);
+#        endif
+         Member(val);
+         my_member++;
+      } else if (op == WL_INSERT) {
+#        ifdef DEBUG
+         printf("Thread %ld > Intentando insertar %d\n", my_rank, val);
+#        endif
+         Insert(val);
+         my_insert++;
+      } else { /* Eliminar */
+#        ifdef DEBUG
+         printf("Thread %ld > Intentando eliminar %d\n", my_rank, val);
+#        endif
+         Delete(val);
+         my_delete++;
+      }
+      lat_record(my_rank, op, t0);
+   }  /* for */
+
+   op_counts[my_rank].member = my_member;
+   op_counts[my_rank].insert = my_insert;
+   op_counts[my_rank].delete = my_delete;
+
+   return NULL;
+}  /* Thread_work */
@@ -0,0 +1,422 @@
+/* Archivo:   listaEnlazada_RCU.c
+ *
+ * Propósito: Implementar una lista enlazada ordenada de múltiples subprocesos de
+ *            entradas con ops insertar, imprimir, miembro, eliminar, lista libre.
+ *            Esta versión usa RCU basado en estados quiescentes: Member no
+ *            toma locks ni escribe en memoria compartida; Insert y Delete se
+ *            serializan con un mutex de escritores.
+ *
+ * Compilar:  gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_RCU.c batch.c pool.c rcu_qsbr.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *            se necesita timer.h, my_rand.h, rng.h, rcu_qsbr.h, workload.h, latency.h, pool.h,
+ *            batch.h, lock_prof.h y cacheline.h
+ *
+ * Ejecutar:  ./ejecutable <thread_count> [opciones de carga]
+ * Entrada:   Número total de keys insertadas por thread principal
+ *            Número total de operaciones realizadas por cada hilo
+ *            (todos los hilos llevan a cabo el mismo número de operaciones)
+ *            porcentaje de operaciones que son búsquedas e inserciones
+ *            (las operaciones restantes son eliminaciones).
+ * Salida:    Tiempo transcurrido para realizar las operaciones
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
+ *
+ * Notas:
+ *    1. No se permiten valores repetidos en la lista.
+ *    2. Indicador de compilación DEBUG utilizado. Para obtener la salida de
+ *       depuración, compile con el indicador de línea de comando -DDEBUG.
+ *    3. Los escritores publican nodos nuevos y desenlazan nodos con stores
+ *       release; los lectores recorren con loads acquire. Un nodo desenlazado
+ *       se sigue pudiendo recorrer, porque su next no cambia, y se libera
+ *       con rcu_defer_free después de un periodo de gracia.
+ *    4. Cada thread anuncia un estado quiescente cada QS_INTERVAL
+ *       operaciones, en su propia línea de cache. Esa es la única escritura
+ *       del camino de lectura y no se hace en cada búsqueda.
+ *    5. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que
+ *       los subprocesos hayan trabajado en ella.
+ *    6. Print y Free_List *no* se deben llamar cuando varios subprocesos
+ *       están accediendo a la lista. Insert_many mezcla un lote ordenado
+ *       (batch.c) en un solo recorrido con write_mutex tomado, y publica
+ *       cada nodo como Insert.
+ *    7. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
+ *    8. write_mutex ocupa su propia línea de cache (cacheline.h).
+ *
+ * IPP:   Sección 4.9.3 (pp. 187 and ff.)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "my_rand.h"
+#include "timer.h"
+#include "lock_prof.h"
+#include "cacheline.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "rcu_qsbr.h"
+#include "batch.h"
+
+/* Los ints aleatorias son inferiores a MAX_KEY */
+const int MAX_KEY = 100000000;
+
+/* Operaciones entre estados quiescentes */
+#define QS_INTERVAL 64
+
+/* Estructura para nodos de la lista */
+struct list_node_s {
+   int    data;
+   struct list_node_s* next;
+};
+
+/* Variables compartidas */
+struct      list_node_s* head = NULL;
+int         thread_count;
+wl_config_t workload;
+int         total_ops;
+double      insert_percent;
+double      search_percent;
+double      delete_percent;
+struct padded_mutex_s write_mutex;
+wl_counts_t* op_counts;
+int         member_count = 0, insert_count = 0, delete_count = 0;
+
+/* Setup y cleanup */
+void        Usage(char* prog_name);
+void        Get_input(int* inserts_in_main_p);
+
+/* Función de Thread */
+void*       Thread_work(void* rank);
+
+/* Lista de operaciones */
+int         Insert(int value);
+void        Print(void);
+int         Member(int value);
+int         Delete(int value, long my_rank);
+int         Insert_many(int values[], int n);
+void        Free_list(void);
+int         Is_empty(void);
+
+/*-----------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long i;
+   pool_t pool;
+   af_placement_t placement;
+   int inserts_in_main;
+   bt_ops_t ops = { Insert_many, NULL, NULL };
+   double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
+
+   if (argc < 2) Usage(argv[0]);
+   thread_count = strtol(argv[1],NULL,10);
+
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, 2)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+   prof_mutex_init(&write_mutex.mutex, "escritores");
+
+   pool_init(&pool, thread_count, &placement);
+
+   /* Intenta insertar keys inserts_in_main, pero abandona despues */
+   /* 2*inserts_in_main intentos.                                  */
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
+   printf("Keys %ld insertadas en la lista vacia\n", i);
+
+#  ifdef OUTPUT
+   printf("Antes de comenzar los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   rcu_init(thread_count);
+
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
+   GET_TIME(start);
+   pool_run(&pool, Thread_work);
+   GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_count += op_counts[i].member;
+      insert_count += op_counts[i].insert;
+      delete_count += op_counts[i].delete;
+   }
+   printf("Tiempo transcurrido = %e seconds\n", finish - start);
+   printf("Total de operaciones = %d\n", total_ops);
+   printf("Operaciones Miembro  = %d\n", member_count);
+   printf("Operaciones Insertar = %d\n", insert_count);
+   printf("Operaciones Eliminar = %d\n", delete_count);
+   lat_report();
+   printf("Periodos de gracia   = %lu\n", rcu_grace_periods());
+
+#  ifdef OUTPUT
+   printf("Después de que terminan los threads, lista = \n");
+   Print();
+   printf("\n");
+#  endif
+
+   Free_list();
+   lat_destroy();
+   rcu_destroy();
+   prof_mutex_destroy(&write_mutex.mutex);
+   free(op_counts);
+   pool_destroy(&pool);
+
+   return 0;
+}  /* main */
+
+
+/*-----------------------------------------------------------------*/
+void Usage(char* prog_name) {
+   fprintf(stderr, "Usar: %s <thread_count> [opciones]\n", prog_name);
+   wl_usage();
+   exit(0);
+}  /* Usar */
+
+/*-----------------------------------------------------------------*/
+void Get_input(int* inserts_in_main_p) {
+
+   printf("¿Cuántas keys se deben insertar en el thread principal?\n");
+   scanf("%d", inserts_in_main_p);
+   printf("¿Cuántas operaciones en total se deben ejecutar?\n");
+   scanf("%d", &total_ops);
+   printf("¿Porcentaje de operaciones que deberían ser búsquedas? (entre 0 y 1)\n");
+   scanf("%lf", &search_percent);
+   printf("¿Porcentaje de operaciones que deberían ser inserciones? (entre 0 y 1)\n");
+   scanf("%lf", &insert_percent);
+   delete_percent = 1.0 - (search_percent + insert_percent);
+}  /* Get_input */
+
+/*-----------------------------------------------------------------*/
+/* Inserta el valor en la ubicación numérica correcta en la lista */
+/* Si el valor no está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Insert(int value) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int rv = 1;
+
+   prof_mutex_lock(&write_mutex.mutex);
+   curr = head;
+   while (curr != NULL && curr->data < value) {
+      pred = curr;
+      curr = curr->next;
+   }
+
+   if (curr == NULL || curr->data > value) {
+      temp = malloc(sizeof(struct list_node_s));
+      temp->data = value;
+      temp->next = curr;
+      /* Publicar: el nodo queda inicializado antes de ser visible */
+      if (pred == NULL)
+         __atomic_store_n(&head, temp, __ATOMIC_RELEASE);
+      else
+         __atomic_store_n(&pred->next, temp, __ATOMIC_RELEASE);
+   } else { /* valor en la lista */
+      rv = 0;
+   }
+   prof_mutex_unlock(&write_mutex.mutex);
+
+   return rv;
+}  /* Insertar */
+
+/*-----------------------------------------------------------------*/
+void Print(void) {
+   struct list_node_s* temp;
+
+   printf("list = ");
+
+   temp = head;
+   while (temp != (struct list_node_s*) NULL) {
+      printf("%d ", temp->data);
+      temp = temp->next;
+   }
+   printf("\n");
+}  /* Imprimir */
+
+
+/*-----------------------------------------------------------------*/
+/* No toma locks: los nodos que ve siguen siendo válidos hasta el */
+/* siguiente estado quiescente del thread.                        */
+int  Member(int value) {
+   struct list_node_s* temp;
+
+   temp = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+   while (temp != NULL && temp->data < value)
+      temp = __atomic_load_n(&temp->next, __ATOMIC_ACQUIRE);
+
+   if (temp == NULL || temp->data > value) {
+#     ifdef DEBUG
+      printf("%d no esta en la lista\n", value);
+#     endif
+      return 0;
+   } else {
+#     ifdef DEBUG
+      printf("%d esta en la lista\n", value);
+#     endif
+      return 1;
+   }
+}  /* Es miembro */
+
+/*-----------------------------------------------------------------*/
+/* Elimina valor de la lista */
+/* Si el valor está en la lista, devuelve 1, de lo contrario, devuelve 0 */
+int Delete(int value, long my_rank) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   int rv = 1;
+
+   prof_mutex_lock(&write_mutex.mutex);
+   curr = head;
+   /* Encuentra valor */
+   while (curr != NULL && curr->data < value) {
+      pred = curr;
+      curr = curr->next;
+   }
+
+   if (curr != NULL && curr->data == value) {
+      /* Desenlazar: los lectores que estén en curr siguen por curr->next */
+      if (pred == NULL) /* primer elemento de la lista */
+         __atomic_store_n(&head, curr->next, __ATOMIC_RELEASE);
+      else
+         __atomic_store_n(&pred->next, curr->next, __ATOMIC_RELEASE);
+   } else { /* No en lista */
+      rv = 0;
+   }
+   prof_mutex_unlock(&write_mutex.mutex);
+
+   if (rv) {
+#     ifdef DEBUG
+      printf("Liberando %d\n", value);
+#     endif
+      rcu_defer_free(my_rank, curr);
+   }
+
+   return rv;
+}  /* Eliminar */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores y mezclarlo con la lista en un
+ *             solo recorrido. Los lectores pueden estar recorriendo: cada
+ *             nodo se publica con un store release, como en Insert.
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, inserted = 0;
+
+   prof_mutex_lock(&write_mutex.mutex);
+   curr = head;
+   for (i = 0; i < n; i++) {
+      if (i > 0 && sorted[i] == sorted[i-1]) continue;
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr == NULL || curr->data > sorted[i]) {
+         temp = malloc(sizeof(struct list_node_s));
+         temp->data = sorted[i];
+         temp->next = curr;
+         if (pred == NULL)
+            __atomic_store_n(&head, temp, __ATOMIC_RELEASE);
+         else
+            __atomic_store_n(&pred->next, temp, __ATOMIC_RELEASE);
+         pred = temp;
+         inserted++;
+      }
+   }
+   prof_mutex_unlock(&write_mutex.mutex);
+
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+void Free_list(void) {
+   struct list_node_s* current;
+   struct list_node_s* following;
+
+   if (Is_empty()) return;
+   current = head;
+   following = current->next;
+   while (following != NULL) {
+#     ifdef DEBUG
+      printf("Liberando %d\n", current->data);
+#     endif
+      free(current);
+      current = following;
+      following = current->next;
+   }
+#  ifdef DEBUG
+   printf("Liberando %d\n", current->data);
+#  endif
+   free(current);
+}  /* Free_list */
+
+/*-----------------------------------------------------------------*/
+int  Is_empty(void) {
+   if (head == NULL)
+      return 1;
+   else
+      return 0;
+}  /* Es vacio */
+
+/*-----------------------------------------------------------------*/
+void* Thread_work(void* rank) {
+   long my_rank = (long) rank;
+   int i, val;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
+   int my_member_count = 0, my_insert_count=0, my_delete_count=0;
+   int ops_per_thread = total_ops/thread_count;
+
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
+   rcu_online(my_rank);
+   for (i = 0; i < ops_per_thread; i++) {
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
+         Member(val);
+         my_member_count++;
+      } else if (op == WL_INSERT) {
+         Insert(val);
+         my_insert_count++;
+      } else { /* Eliminar */
+         Delete(val, my_rank);
+         my_delete_count++;
+      }
+      lat_record(my_rank, op, t0);
+      if (i % QS_INTERVAL == QS_INTERVAL - 1)
+         rcu_quiescent(my_rank);
+   }  /* for */
+   rcu_offline(my_rank);
+
+   op_counts[my_rank].member = my_member_count;
+   op_counts[my_rank].insert = my_insert_count;
+   op_counts[my_rank].delete = my_delete_count;
+
+   return NULL;
+}  /* Thread_work */
@@ -4,23 +4,42 @@
  *            entradas con ops insertar, imprimir, miembro, eliminar, lista libre. 
  *            Esta versión utiliza locks de read y write.
  * 
- * Compilar:  gcc -g -Wall -o ejecutable listaEnlazada_ReadWriteLocks.c my_rand.c -lpthread
- *            se necesita timer.h y my_rand.h
+ * Compilar:  gcc -g -Wall -o ejecutable listaEnlazada_ReadWriteLocks.c batch.c pool.c rwlocks.c latency.c workload.c rng.c my_rand.c -lpthread -lm
+ *            se necesita timer.h, my_rand.h, rng.h, rwlocks.h, workload.h, latency.h,
+ *            pool.h y batch.h
  *
- * Ejecutar:  ./ejecutable <thread_count>
+ * Ejecutar:  ./ejecutable <thread_count> [pthread|wpref|pft|brlock] [opciones de carga]
  * Entrada:   Número total de llaves insertadas por hilo principal
  *            Número total de operaciones de cada tipo realizadas por cada thread.
- * Salida:    Tiempo transcurrido para realizar las operaciones
+ * Salida:    Tiempo transcurrido para realizar las operaciones e
+ *            histogramas de latencia de adquisición del lock
+ *            Latencias p50/p99/p99.9 por tipo de operación y throughput
+ *            por intervalos (latency.c)
  *
  * Notas:
  *    1. No se permiten valores repetidos en la lista.
  *    2. Indicador de compilación DEBUG utilizado. Para obtener la salida de 
  *       depuración, compile con el indicador de línea de comando -DDEBUG.
- *    3. Utiliza la implementación estándar de Unix 98 de bloqueos de read y write.
+ *    3. Por defecto utiliza la implementación estándar de Unix 98 de bloqueos
+ *       de read y write. El segundo argumento elige otra implementación de
+ *       rwlocks.c: preferencia de escritores (wpref), phase-fair ticket (pft)
+ *       o big-reader (brlock).
  *    4. La función aleatoria no es segura para subprocesos. Entonces, 
  *       este programa usa un generador congruencial lineal simple.
  *    5. La bandera -DOUTPUT  a gcc mostrará la lista antes y después de que 
  *       los subprocesos hayan trabajado en ella.
+ *    6. Insert_many, Member_many y Delete_many procesan un lote ordenado
+ *       (batch.c) en un solo recorrido y toman el lock ellos mismos con el
+ *       rank 0. Solo los llama main, antes de pool_run: la carga inicial
+ *       usa un lock sin histogramas y bt_load comprueba Member_many y
+ *       Delete_many con el último lote.
+ *    7. Sin opciones de carga los datos se piden de forma interactiva. Las
+ *       opciones de workload.c (-k, -o, -s, -i, -d, -p, -f, ...) permiten
+ *       ejecutar sin entrada y elegir la distribución de keys y las fases;
+ *       -a compact|scatter|node fija los threads (comun/affinity.h). La
+ *       lista inicial la cargan los threads del pool, ya fijados (batch.c),
+ *       así que sus nodos, los que se insertan después y los histogramas de
+ *       latencia quedan en el nodo NUMA del thread que los creó.
  *
  * IPP:   Sección 4.9.3 (pp. 187 and ff.)
  */
@@ -29,6 +48,11 @@
 #include <pthread.h>
 #include "my_rand.h"
 #include "timer.h"
+#include "workload.h"
+#include "latency.h"
+#include "pool.h"
+#include "rwlocks.h"
+#include "batch.h"
 
 /* Los ints aleatorias son inferiores a MAX_KEY */
 const int MAX_KEY = 100000000;
@@ -43,12 +67,13 @@ struct list_node_s {
 /* Variables compartidas */
 struct      list_node_s* head = NULL;  
 int         thread_count;
+wl_config_t workload;
 int         total_ops;
 double      insert_percent;
 double      search_percent;
 double      delete_percent;
-pthread_rwlock_t    rwlock;
-pthread_mutex_t     count_mutex;
+rwl_t               rwlock;
+wl_counts_t* op_counts;
 int         member_count = 0, insert_count = 0, delete_count = 0;
 
 /* Setup y cleanup */
@@ -63,32 +88,52 @@ int         Insert(int value);
 void        Print(void);
 int         Member(int value);
 int         Delete(int value);
+int         Insert_many(int values[], int n);
+int         Member_many(int values[], int n, unsigned char bitmap[]);
+int         Delete_many(int values[], int n);
 void        Free_list(void);
 int         Is_empty(void);
 
 /*-----------------------------------------------------------------*/
 int main(int argc, char* argv[]) {
    long i; 
-   int key, success, attempts;
-   pthread_t* thread_handles;
+   pool_t pool;
+   af_placement_t placement;
    int inserts_in_main;
-   unsigned seed = 1;
+   bt_ops_t ops = { Insert_many, Member_many, Delete_many };
    double start, finish;
+   static const char* op_names[] = { "Miembro", "Insertar", "Eliminar" };
+   rwl_kind_t lock_kind = RWL_PTHREAD;
+   int first_option;
 
-   if (argc != 2) Usage(argv[0]);
+   if (argc < 2) Usage(argv[0]);
    thread_count = strtol(argv[1],NULL,10);
+   first_option = 2;
+   if (argc > 2 && argv[2][0] != '-') {
+      if (!rwl_parse_kind(argv[2], &lock_kind)) Usage(argv[0]);
+      first_option = 3;
+   }
 
-   Get_input(&inserts_in_main);
+   wl_init(&workload, MAX_KEY);
+   if (!wl_parse_args(&workload, argc, argv, first_option)) {
+      Get_input(&inserts_in_main);
+      wl_set_mix(&workload, search_percent, insert_percent);
+   } else {
+      inserts_in_main = workload.inserts_in_main;
+      total_ops = workload.total_ops;
+   }
+   wl_print(&workload);
+   af_init(&placement, workload.affinity, thread_count);
+   af_report(&placement, stdout);
+
+   pool_init(&pool, thread_count, &placement);
 
    /* Intenta insertar keys inserts_in_main, pero abandona despues */
-   /* 2*inserts_in_main intentos.                                  */
-   i = attempts = 0;
-   while ( i < inserts_in_main && attempts < 2*inserts_in_main ) {
-      key = my_rand(&seed) % MAX_KEY;
-      success = Insert(key);
-      attempts++;
-      if (success) i++;
-   }
+   /* 2*inserts_in_main intentos. La carga no se mide: el lock se   */
+   /* vuelve a crear con histogramas antes de lanzar los threads.   */
+   rwl_init(&rwlock, lock_kind, thread_count, 0);
+   i = bt_load(&ops, &pool, inserts_in_main, MAX_KEY);
+   rwl_destroy(&rwlock);
    printf("Keys %ld insertadas en la lista vacia\n", i);
 
 #  ifdef OUTPUT
@@ -97,22 +142,31 @@ int main(int argc, char* argv[]) {
    printf("\n");
 #  endif
 
-   thread_handles = malloc(thread_count*sizeof(pthread_t));
-   pthread_mutex_init(&count_mutex, NULL);
-   pthread_rwlock_init(&rwlock, NULL);
+   op_counts = malloc(thread_count*sizeof(wl_counts_t));
+   if (op_counts == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   rwl_init(&rwlock, lock_kind, thread_count, 1);
 
+   lat_init(thread_count, 3, op_names);
+   lat_timeline_start(LAT_DEFAULT_INTERVAL_MS);
    GET_TIME(start);
-   for (i = 0; i < thread_count; i++)
-      pthread_create(&thread_handles[i], NULL, Thread_work, (void*) i);
-
-   for (i = 0; i < thread_count; i++)
-      pthread_join(thread_handles[i], NULL);
+   pool_run(&pool, Thread_work);
    GET_TIME(finish);
+   lat_timeline_stop();
+   for (i = 0; i < thread_count; i++) {
+      member_count += op_counts[i].member;
+      insert_count += op_counts[i].insert;
+      delete_count += op_counts[i].delete;
+   }
    printf("Tiempo transcurrido = %e seconds\n", finish - start);
    printf("Total de operaciones = %d\n", total_ops);
    printf("Operaciones Miembro  = %d\n", member_count);
    printf("Operaciones Insertar = %d\n", insert_count);
    printf("Operaciones Eliminar = %d\n", delete_count);
+   lat_report();
+   rwl_print_hist(&rwlock);
 
 #  ifdef OUTPUT
    printf("Después de que terminan los threads, lista = \n");
@@ -121,9 +175,10 @@ int main(int argc, char* argv[]) {
 #  endif
 
    Free_list();
-   pthread_rwlock_destroy(&rwlock);
-   pthread_mutex_destroy(&count_mutex);
-   free(thread_handles);
+   lat_destroy();
+   rwl_destroy(&rwlock);
+   free(op_counts);
+   pool_destroy(&pool);
 
    return 0;
 }  /* main */
@@ -131,7 +186,9 @@ int main(int argc, char* argv[]) {
 
 /*-----------------------------------------------------------------*/
 void Usage(char* prog_name) {
-   fprintf(stderr, "Usar: %s <thread_count>\n", prog_name);
+   fprintf(stderr, "Usar: %s <thread_count> [pthread|wpref|pft|brlock] [opciones]\n",
+         prog_name);
+   wl_usage();
    exit(0);
 }  /* Usar */
 
@@ -249,6 +306,114 @@ int Delete(int value) {
    return rv;
 }  /* Eliminar */
 
+/*-----------------------------------------------------------------*/
+/* Función  :  Insert_many
+ * Propósito:  Ordenar un lote de valores y mezclarlo con la lista en un
+ *             solo recorrido
+ * Val Retorno: Número de valores insertados (los que ya estaban en la
+ *             lista o repetidos en el lote no cuentan)
+ */
+int Insert_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* temp;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, inserted = 0;
+
+   rwl_wrlock(&rwlock, 0);
+   curr = head;
+   for (i = 0; i < n; i++) {
+      if (i > 0 && sorted[i] == sorted[i-1]) continue;
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr == NULL || curr->data > sorted[i]) {
+         temp = malloc(sizeof(struct list_node_s));
+         temp->data = sorted[i];
+         temp->next = curr;
+         if (pred == NULL)
+            head = temp;
+         else
+            pred->next = temp;
+         pred = temp;
+         inserted++;
+      }
+   }
+   rwl_wrunlock(&rwlock, 0);
+
+   free(sorted);
+   return inserted;
+}  /* Insert_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Member_many
+ * Propósito:  Buscar un lote de valores en un solo recorrido
+ * Sal arg:    bitmap: BT_BIT(bitmap, i) vale 1 si values[i] está en la
+ *             lista. Debe tener BT_BITMAP_BYTES(n) bytes.
+ * Val Retorno: Número de valores encontrados
+ */
+int Member_many(int values[], int n, unsigned char bitmap[]) {
+   struct list_node_s* temp;
+   bt_pair_t* pairs = bt_sorted_pairs(values, n, bitmap);
+   int i, found = 0;
+
+   rwl_rdlock(&rwlock, 0);
+   temp = head;
+   for (i = 0; i < n; i++) {
+      while (temp != NULL && temp->data < pairs[i].key)
+         temp = temp->next;
+      if (temp != NULL && temp->data == pairs[i].key) {
+         bt_set(bitmap, pairs[i].idx);
+         found++;
+      }
+   }
+   rwl_rdunlock(&rwlock, 0);
+
+   free(pairs);
+   return found;
+}  /* Member_many */
+
+/*-----------------------------------------------------------------*/
+/* Función  :  Delete_many
+ * Propósito:  Ordenar un lote de valores y eliminarlos de la lista en
+ *             un solo recorrido
+ * Val Retorno: Número de valores eliminados
+ */
+int Delete_many(int values[], int n) {
+   struct list_node_s* curr;
+   struct list_node_s* pred = NULL;
+   struct list_node_s* following;
+   int* sorted = bt_sorted_copy(values, n);
+   int i, deleted = 0;
+
+   rwl_wrlock(&rwlock, 0);
+   curr = head;
+   for (i = 0; i < n; i++) {
+      while (curr != NULL && curr->data < sorted[i]) {
+         pred = curr;
+         curr = curr->next;
+      }
+      if (curr != NULL && curr->data == sorted[i]) {
+         following = curr->next;
+         if (pred == NULL)
+            head = following;
+         else
+            pred->next = following;
+#        ifdef DEBUG
+         printf("Liberando %d\n", sorted[i]);
+#        endif
+         free(curr);
+         curr = following;
+         deleted++;
+      }
+   }
+   rwl_wrunlock(&rwlock, 0);
+
+   free(sorted);
+   return deleted;
+}  /* Delete_many */
+
 /*-----------------------------------------------------------------*/
 void Free_list(void) {
    struct list_node_s* current;
@@ -283,37 +448,38 @@ int  Is_empty(void) {
 void* Thread_work(void* rank) {
    long my_rank = (long) rank;
    int i, val;
-   double which_op;
-   unsigned seed = my_rank + 1;
+   wl_op_t op;
+   wl_thread_t gen;
+   unsigned long long t0;
    int my_member_count = 0, my_insert_count=0, my_delete_count=0;
    int ops_per_thread = total_ops/thread_count;
 
+   wl_thread_init(&gen, &workload, my_rank, thread_count, ops_per_thread);
    for (i = 0; i < ops_per_thread; i++) {
-      which_op = my_drand(&seed);
-      val = my_rand(&seed) % MAX_KEY;
-      if (which_op < search_percent) {
-         pthread_rwlock_rdlock(&rwlock);
+      op = wl_next(&gen, &val);
+      t0 = lat_now();
+      if (op == WL_MEMBER) {
+         rwl_rdlock(&rwlock, my_rank);
          Member(val);
-         pthread_rwlock_unlock(&rwlock);
+         rwl_rdunlock(&rwlock, my_rank);
          my_member_count++;
-      } else if (which_op < search_percent + insert_percent) {
-         pthread_rwlock_wrlock(&rwlock);
+      } else if (op == WL_INSERT) {
+         rwl_wrlock(&rwlock, my_rank);
          Insert(val);
-         pthread_rwlock_unlock(&rwlock);
+         rwl_wrunlock(&rwlock, my_rank);
          my_insert_count++;
       } else { /* Eliminar */
-         pthread_rwlock_wrlock(&rwlock);
+         rwl_wrlock(&rwlock, my_rank);
          Delete(val);
-         pthread_rwlock_unlock(&rwlock);
+         rwl_wrunlock(&rwlock, my_rank);
          my_delete_count++;
       }
+      lat_record(my_rank, op, t0);
    }  /* for */
 
-   pthread_mutex_lock(&count_mutex);
-   member_count += my_member_count;
-   insert_count += my_insert_count;
-   delete_count += my_delete_count;
-   pthread_mutex_unlock(&count_mutex);
+   op_counts[my_rank].member = my_member_count;
+   op_counts[my_rank].insert = my_insert_count;
+   op_counts[my_rank].delete = my_delete_count;
 
    return NULL;
 }  /* Thread_work */
\ No newline at end of file
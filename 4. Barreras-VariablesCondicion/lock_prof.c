@@ -0,0 +1,224 @@
+/* Archivo:   lock_prof.c
+ *
+ * Propósito: Implementar el perfilador de contención de locks (ver
+ *            lock_prof.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -DLOCK_PROF -o ejecutable listaEnlazada_MultiMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. Cada thread acumula sus estadísticas en una tabla propia (una
+ *       entrada por clase), así que medir no agrega tráfico de coherencia
+ *       entre threads. Las tablas se combinan solo en prof_report.
+ *    2. Una adquisición es contendida si pthread_mutex_trylock falla; solo
+ *       en ese caso se mide la espera.
+ *    3. La retención se cuenta desde que el lock se adquiere hasta que se
+ *       libera, y se carga al thread que lo libera. En prof_cond_wait el
+ *       tiempo dormido en la variable de condición no cuenta como espera
+ *       ni como retención.
+ *    4. El tiempo se toma con el contador de ciclos si es invariante
+ *       (hr_tsc_invariant), calibrado con hr_ns_per_tick de hrtimer.h. Si
+ *       no, como lat_now, se usan directamente los nanosegundos de
+ *       hr_now_ns.
+ */
+#ifdef LOCK_PROF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lock_prof.h"
+#include "../comun/hrtimer.h"
+
+struct prof_stats_s {
+   unsigned long long acquisitions;
+   unsigned long long contended;
+   unsigned long long wait;       /* en ticks */
+   unsigned long long max_wait;
+   unsigned long long hold;
+};
+
+/* Tabla de un thread; las tablas quedan enlazadas hasta el reporte */
+struct prof_thread_s {
+   struct prof_stats_s stats[PROF_MAX_CLASSES];
+   struct prof_thread_s* next;
+};
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const char* class_names[PROF_MAX_CLASSES];
+static int class_count = 0;
+static struct prof_thread_s* all_threads = NULL;
+static __thread struct prof_thread_s* my_stats = NULL;
+static int use_tsc = 0;
+static double ns_per_tick = 1.0;
+
+/*-----------------------------------------------------------------*/
+/* Ciclos, o nanosegundos si no hay TSC invariante (ver nota 4) */
+static inline unsigned long long Ticks(void) {
+#  if defined(__x86_64__) || defined(__i386__)
+   if (use_tsc) return __rdtsc();
+#  endif
+   return hr_now_ns();
+}  /* Ticks */
+
+/*-----------------------------------------------------------------*/
+/* Elegir y calibrar el reloj y registrar el reporte; se ejecuta una vez */
+static void Setup(void) {
+   use_tsc = hr_tsc_invariant();
+   ns_per_tick = use_tsc ? hr_ns_per_tick() : 1.0;
+   atexit(prof_report);
+}  /* Setup */
+
+/*-----------------------------------------------------------------*/
+static struct prof_thread_s* Thread_stats(void) {
+   struct prof_thread_s* t = my_stats;
+
+   if (t != NULL) return t;
+   t = calloc(1, sizeof(struct prof_thread_s));
+   if (t == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   pthread_mutex_lock(&registry_mutex);
+   t->next = all_threads;
+   all_threads = t;
+   pthread_mutex_unlock(&registry_mutex);
+   my_stats = t;
+   return t;
+}  /* Thread_stats */
+
+/*-----------------------------------------------------------------*/
+/* Función:    prof_mutex_init
+ * Propósito:  Inicializar el mutex y asociarlo a la clase cls_name,
+ *             que se crea si no existe
+ */
+int prof_mutex_init(prof_mutex_t* m, const char* cls_name) {
+   int c;
+
+   pthread_once(&once, Setup);
+   pthread_mutex_lock(&registry_mutex);
+   for (c = 0; c < class_count; c++)
+      if (class_names[c] == cls_name || strcmp(class_names[c], cls_name) == 0)
+         break;
+   if (c == class_count) {
+      if (class_count == PROF_MAX_CLASSES) {
+         fprintf(stderr, "Demasiadas clases de locks (máx %d)\n",
+               PROF_MAX_CLASSES);
+         exit(1);
+      }
+      class_names[class_count++] = cls_name;
+   }
+   pthread_mutex_unlock(&registry_mutex);
+
+   m->cls = c;
+   m->acquired_at = 0;
+   return pthread_mutex_init(&m->mutex, NULL);
+}  /* prof_mutex_init */
+
+/*-----------------------------------------------------------------*/
+int prof_mutex_lock(prof_mutex_t* m) {
+   struct prof_stats_s* s = &Thread_stats()->stats[m->cls];
+   unsigned long long t0, waited;
+   int ret;
+
+   if (pthread_mutex_trylock(&m->mutex) == 0) {
+      s->acquisitions++;
+      m->acquired_at = Ticks();
+      return 0;
+   }
+   t0 = Ticks();
+   ret = pthread_mutex_lock(&m->mutex);
+   m->acquired_at = Ticks();
+   waited = m->acquired_at - t0;
+   s->acquisitions++;
+   s->contended++;
+   s->wait += waited;
+   if (waited > s->max_wait) s->max_wait = waited;
+   return ret;
+}  /* prof_mutex_lock */
+
+/*-----------------------------------------------------------------*/
+int prof_mutex_unlock(prof_mutex_t* m) {
+   Thread_stats()->stats[m->cls].hold += Ticks() - m->acquired_at;
+   return pthread_mutex_unlock(&m->mutex);
+}  /* prof_mutex_unlock */
+
+/*-----------------------------------------------------------------*/
+int prof_mutex_destroy(prof_mutex_t* m) {
+   return pthread_mutex_destroy(&m->mutex);
+}  /* prof_mutex_destroy */
+
+/*-----------------------------------------------------------------*/
+/* Función:    prof_cond_wait
+ * Propósito:  pthread_cond_wait sobre un prof_mutex_t: la retención se
+ *             corta antes de dormir y vuelve a empezar al despertar
+ */
+int prof_cond_wait(pthread_cond_t* cond, prof_mutex_t* m) {
+   int ret;
+
+   Thread_stats()->stats[m->cls].hold += Ticks() - m->acquired_at;
+   ret = pthread_cond_wait(cond, &m->mutex);
+   m->acquired_at = Ticks();
+   return ret;
+}  /* prof_cond_wait */
+
+/*-----------------------------------------------------------------*/
+/* Función:    prof_report
+ * Propósito:  Combinar las tablas de todos los threads e imprimir una
+ *             línea por clase, de mayor a menor tiempo total de espera
+ * Nota:       Se registra con atexit; se puede llamar antes a mano
+ */
+void prof_report(void) {
+   struct prof_stats_s total[PROF_MAX_CLASSES], tmp;
+   const char* names[PROF_MAX_CLASSES];
+   const char* tmp_name;
+   struct prof_thread_s* t;
+   int c, d, count;
+   static int reported = 0;
+
+   pthread_mutex_lock(&registry_mutex);
+   if (reported || class_count == 0) {
+      pthread_mutex_unlock(&registry_mutex);
+      return;
+   }
+   reported = 1;
+   count = class_count;
+   memset(total, 0, sizeof(total));
+   for (c = 0; c < count; c++) names[c] = class_names[c];
+   for (t = all_threads; t != NULL; t = t->next)
+      for (c = 0; c < count; c++) {
+         total[c].acquisitions += t->stats[c].acquisitions;
+         total[c].contended += t->stats[c].contended;
+         total[c].wait += t->stats[c].wait;
+         total[c].hold += t->stats[c].hold;
+         if (t->stats[c].max_wait > total[c].max_wait)
+            total[c].max_wait = t->stats[c].max_wait;
+      }
+   pthread_mutex_unlock(&registry_mutex);
+
+   /* Pocas clases: basta con inserción */
+   for (c = 1; c < count; c++)
+      for (d = c; d > 0 && total[d].wait > total[d-1].wait; d--) {
+         tmp = total[d];  total[d] = total[d-1];  total[d-1] = tmp;
+         tmp_name = names[d];  names[d] = names[d-1];  names[d-1] = tmp_name;
+      }
+
+   printf("Contención de locks (tiempos en ns):\n");
+   printf("   %-14s %12s %12s %7s %14s %10s %12s %10s\n", "clase",
+         "adquisic.", "contendidas", "%cont", "espera total", "espera med",
+         "espera máx", "retención");
+   for (c = 0; c < count; c++) {
+      if (total[c].acquisitions == 0) continue;
+      printf("   %-14s %12llu %12llu %6.2f%% %14.0f %10.0f %12.0f %10.0f\n",
+            names[c], total[c].acquisitions, total[c].contended,
+            100.0*total[c].contended/total[c].acquisitions,
+            total[c].wait*ns_per_tick,
+            total[c].contended ? total[c].wait*ns_per_tick/total[c].contended
+                               : 0.0,
+            total[c].max_wait*ns_per_tick,
+            total[c].hold*ns_per_tick/total[c].acquisitions);
+   }
+   fflush(stdout);
+}  /* prof_report */
+
+#endif
@@ -0,0 +1,57 @@
+/* Archivo:   lock_prof.h
+ * Propósito: Envoltorio de pthread_mutex_t que mide, por clase de lock,
+ *            el número de adquisiciones, cuántas fueron contendidas, el
+ *            tiempo de espera y el tiempo de retención.
+ *
+ *            Una clase es el nombre que se pasa a prof_mutex_init: todos
+ *            los mutex de los nodos de una lista pueden compartir la clase
+ *            "nodo", y head_mutex tener la suya. Al terminar el programa
+ *            (atexit) se imprime un reporte ordenado por tiempo de espera.
+ *
+ *            Sin -DLOCK_PROF las funciones son exactamente las de pthreads
+ *            y no hay ningún costo adicional.
+ *
+ * Ejemplo:
+ *    prof_mutex_t m;
+ *    prof_mutex_init(&m, "lista");
+ *    prof_mutex_lock(&m);
+ *    . . .
+ *    prof_mutex_unlock(&m);
+ *    prof_mutex_destroy(&m);
+ */
+#ifndef _LOCK_PROF_H_
+#define _LOCK_PROF_H_
+
+#include <pthread.h>
+
+#ifdef LOCK_PROF
+
+#define PROF_MAX_CLASSES 32
+
+typedef struct {
+   pthread_mutex_t mutex;
+   int cls;
+   unsigned long long acquired_at;  /* Solo lo escribe el dueño */
+} prof_mutex_t;
+
+int  prof_mutex_init(prof_mutex_t* m, const char* cls_name);
+int  prof_mutex_lock(prof_mutex_t* m);
+int  prof_mutex_unlock(prof_mutex_t* m);
+int  prof_mutex_destroy(prof_mutex_t* m);
+int  prof_cond_wait(pthread_cond_t* cond, prof_mutex_t* m);
+void prof_report(void);
+
+#else
+
+typedef pthread_mutex_t prof_mutex_t;
+
+#define prof_mutex_init(m, cls_name) pthread_mutex_init(m, NULL)
+#define prof_mutex_lock(m)           pthread_mutex_lock(m)
+#define prof_mutex_unlock(m)         pthread_mutex_unlock(m)
+#define prof_mutex_destroy(m)        pthread_mutex_destroy(m)
+#define prof_cond_wait(cond, m)      pthread_cond_wait(cond, m)
+#define prof_report()
+
+#endif
+
+#endif
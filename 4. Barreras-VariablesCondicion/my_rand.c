@@ -1,17 +1,25 @@
 /* File:     my_rand.c
  *
- * Purpose:  implement a linear congruential random number generator
+ * Purpose:  implement a small, threadsafe random number generator
  *
- * my_rand:  generates a random unsigned int in the range 0 - MR_MODULUS
+ * my_rand:  generates a random unsigned int in the range 0 - 2^32 - 1
  * my_drand: generates a random double in the range 0 - 1
  *
  * Notes:
- * 1.  The generator is taken from the Wikipedia article "Linear congruential
- *     generator"
- * 2.  This is *not* a very good random number generator.  However, unlike
- *     the C library function random(), it *is* threadsafe:  the "state" of
- *     the generator is returned in the seed_p argument to each function.
- * 3.  The main function is just a simple driver.
+ * 1.  By default this is a compatibility shim for the code that still
+ *     keeps its state in an unsigned:  the state is a Weyl sequence
+ *     (add MR_WEYL) and the result is the state run through the
+ *     "lowbias32" integer hash.  There is no 64-bit multiply and no %,
+ *     and consecutive values are not correlated.  Hot loops should use
+ *     rng.h instead.
+ * 2.  Compiling with -DMY_RAND_LCG restores the original linear
+ *     congruential generator from the Wikipedia article "Linear
+ *     congruential generator" (range 0 - MR_MODULUS), e.g., to reproduce
+ *     older results.  It is *not* a very good random number generator.
+ * 3.  Unlike the C library function random(), both versions are
+ *     threadsafe:  the "state" of the generator is returned in the seed_p
+ *     argument to each function.
+ * 4.  The main function is just a simple driver.
  *
  * IPP:  Not discussed, but needed by the multithreaded linked list programs
  *       discussed in Section 4.9.2-4.9.4 (pp. 183-190).
@@ -20,10 +28,15 @@
 #include <stdlib.h>
 #include "my_rand.h"
 
+#ifdef MY_RAND_LCG
 #define MR_MULTIPLIER 279470273 
 #define MR_INCREMENT 0
 #define MR_MODULUS 4294967291U
 #define MR_DIVISOR ((double) 4294967291U)
+#else
+#define MR_WEYL 0x9e3779b9U
+#define MR_DIVISOR 4294967296.0
+#endif
 
 
 #ifdef _MAIN_
@@ -48,6 +61,7 @@ int main(void) {
 }
 #endif
 
+#ifdef MY_RAND_LCG
 /* Function:      my_rand
  * In/out arg:    seed_p
  * Return value:  A new pseudo-random unsigned int in the range
@@ -67,6 +81,26 @@ unsigned my_rand(unsigned* seed_p) {
    *seed_p = z;
    return *seed_p;
 }
+#else
+/* Function:      my_rand
+ * In/out arg:    seed_p
+ * Return value:  A new pseudo-random unsigned int in the range
+ *                0 - 2^32 - 1
+ *
+ * Note:  The seed_p argument stores the "state" for the next call to
+ *        the function.  Any value, including 0, is a valid seed.
+ */
+unsigned my_rand(unsigned* seed_p) {
+   unsigned x = *seed_p += MR_WEYL;
+
+   x ^= x >> 16;
+   x *= 0x7feb352dU;
+   x ^= x >> 15;
+   x *= 0x846ca68bU;
+   x ^= x >> 16;
+   return x;
+}
+#endif
 
 /* Function:      my_drand
  * In/out arg:    seed_p
@@ -1,6 +1,7 @@
 /* File:     my_rand.h
  * Purpose:  Header file for my_rand.c, which implements a simple
- *           pseudo-random number generator.
+ *           pseudo-random number generator.  New code should use
+ *           rng.h, which is faster and can fill whole arrays.
  *
  * IPP:  Not discussed, but needed by the multithreaded linked list programs
  *       discussed in Section 4.9.2-4.9.4 (pp. 183-190).
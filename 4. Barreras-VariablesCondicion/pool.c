@@ -0,0 +1,249 @@
+/* Archivo:   pool.c
+ *
+ * Propósito: Implementar el pool de threads persistentes (ver pool.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -o ejecutable listaEnlazada_OneMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. Cada fase incrementa generation. Un thread estacionado primero
+ *       espera activamente POOL_SPIN iteraciones a que cambie (o a que
+ *       haya una tarea) y después duerme en work_cond, así dos fases
+ *       seguidas no pagan un despertar del kernel. Si hay tantos threads
+ *       (contando a main) como CPUs o más, no se espera activamente: el
+ *       que gira le quita la CPU al que tiene que terminar la fase.
+ *    2. pending cuenta los threads que todavía no terminaron la fase; el
+ *       último despierta a quien espera en done_cond. El final de
+ *       pool_run es una barrera: lo que escribieron los threads en la
+ *       fase es visible para el que llamó.
+ *    3. Las tareas de pool_submit van a una cola FIFO protegida por
+ *       mutex; outstanding cuenta las encoladas o en ejecución.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/*-----------------------------------------------------------------*/
+static void Run_job(pool_t* pool, long rank) {
+   pool->fn((void*) rank);
+}  /* Run_job */
+
+/*-----------------------------------------------------------------*/
+/* Tomar trozos de chunk iteraciones hasta que no quede ninguno */
+static void For_job(pool_t* pool, long rank) {
+   long first, last;
+
+   while ((first = __atomic_fetch_add(&pool->next, pool->chunk,
+               __ATOMIC_RELAXED)) < pool->last) {
+      last = first + pool->chunk < pool->last ? first + pool->chunk
+                                              : pool->last;
+      pool->body(first, last, pool->body_arg);
+   }
+}  /* For_job */
+
+/*-----------------------------------------------------------------*/
+/* Función:    Worker
+ * Propósito:  Esperar fases y tareas hasta que la fase sea NULL
+ * En arg:     w: el pool y el rank de este thread
+ */
+static void* Worker(void* arg) {
+   struct pool_worker_s* w = (struct pool_worker_s*) arg;
+   pool_t* pool = w->pool;
+   void (*job)(pool_t*, long);
+   struct pool_task_s* task;
+   int my_generation = 0, i;
+
+   af_bind(pool->placement, w->rank);
+   for (;;) {
+      for (i = 0; i < pool->spin; i++) {
+         if (__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE)
+                  != my_generation ||
+               __atomic_load_n(&pool->head, __ATOMIC_RELAXED) != NULL)
+            break;
+         CPU_RELAX();
+      }
+
+      pthread_mutex_lock(&pool->mutex);
+      while (pool->generation == my_generation && pool->head == NULL)
+         pthread_cond_wait(&pool->work_cond, &pool->mutex);
+
+      if (pool->generation != my_generation) {
+         my_generation = pool->generation;
+         job = pool->job;
+         pthread_mutex_unlock(&pool->mutex);
+         if (job == NULL) return NULL;
+         job(pool, w->rank);
+         if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+            pthread_mutex_lock(&pool->mutex);
+            pthread_cond_broadcast(&pool->done_cond);
+            pthread_mutex_unlock(&pool->mutex);
+         }
+      } else {
+         task = pool->head;
+         __atomic_store_n(&pool->head, task->next, __ATOMIC_RELAXED);
+         if (pool->head == NULL) pool->tail = NULL;
+         pthread_mutex_unlock(&pool->mutex);
+
+         task->fn(task->arg);
+         free(task);
+
+         pthread_mutex_lock(&pool->mutex);
+         if (--pool->outstanding == 0)
+            pthread_cond_broadcast(&pool->done_cond);
+         pthread_mutex_unlock(&pool->mutex);
+      }
+   }
+}  /* Worker */
+
+/*-----------------------------------------------------------------*/
+/* Publicar la fase job y despertar a los threads */
+static void Start_phase(pool_t* pool, void (*job)(pool_t*, long)) {
+   pool->job = job;
+   __atomic_store_n(&pool->pending, pool->thread_count, __ATOMIC_RELAXED);
+   pthread_mutex_lock(&pool->mutex);
+   __atomic_store_n(&pool->generation, pool->generation + 1,
+         __ATOMIC_RELEASE);
+   pthread_cond_broadcast(&pool->work_cond);
+   pthread_mutex_unlock(&pool->mutex);
+}  /* Start_phase */
+
+/*-----------------------------------------------------------------*/
+/* Esperar a que todos los threads terminen la fase */
+static void Wait_phase(pool_t* pool) {
+   int i;
+
+   for (i = 0; i < pool->spin; i++) {
+      if (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0) return;
+      CPU_RELAX();
+   }
+   pthread_mutex_lock(&pool->mutex);
+   while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) != 0)
+      pthread_cond_wait(&pool->done_cond, &pool->mutex);
+   pthread_mutex_unlock(&pool->mutex);
+}  /* Wait_phase */
+
+/*-----------------------------------------------------------------*/
+/* Función:    pool_init
+ * Propósito:  Crear thread_count threads estacionados
+ * En arg:     placement: dónde fijar cada thread, o NULL para no fijarlos
+ */
+void pool_init(pool_t* pool, int thread_count,
+      const af_placement_t* placement) {
+   long rank;
+
+   pool->thread_count = thread_count;
+   pool->placement = placement;
+   pool->spin = thread_count < sysconf(_SC_NPROCESSORS_ONLN) ? POOL_SPIN : 0;
+   pool->threads = malloc(thread_count*sizeof(pthread_t));
+   pool->workers = malloc(thread_count*sizeof(struct pool_worker_s));
+   if (pool->threads == NULL || pool->workers == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   pthread_mutex_init(&pool->mutex, NULL);
+   pthread_cond_init(&pool->work_cond, NULL);
+   pthread_cond_init(&pool->done_cond, NULL);
+   pool->job = NULL;
+   pool->fn = NULL;
+   pool->generation = 0;
+   pool->pending = 0;
+   pool->head = pool->tail = NULL;
+   pool->outstanding = 0;
+
+   for (rank = 0; rank < thread_count; rank++) {
+      pool->workers[rank].pool = pool;
+      pool->workers[rank].rank = rank;
+      pthread_create(&pool->threads[rank], NULL, Worker,
+            &pool->workers[rank]);
+   }
+}  /* pool_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:    pool_run
+ * Propósito:  Ejecutar fn((void*) rank) en cada thread del pool y
+ *             esperar a que terminen todos
+ */
+void pool_run(pool_t* pool, pool_fn_t fn) {
+   pool->fn = fn;
+   Start_phase(pool, Run_job);
+   Wait_phase(pool);
+}  /* pool_run */
+
+/*-----------------------------------------------------------------*/
+/* Función:    pool_parallel_for
+ * Propósito:  Ejecutar body(a, b, arg) sobre trozos [a, b) que cubren
+ *             [first, last)
+ * En args:    chunk: iteraciones por trozo; si es <= 0, se usan unos 8
+ *             trozos por thread
+ */
+void pool_parallel_for(pool_t* pool, long first, long last, long chunk,
+      pool_range_fn_t body, void* arg) {
+   if (first >= last) return;
+   if (chunk <= 0) {
+      chunk = (last - first + 8*pool->thread_count - 1)
+            / (8*pool->thread_count);
+      if (chunk < 1) chunk = 1;
+   }
+   pool->next = first;
+   pool->last = last;
+   pool->chunk = chunk;
+   pool->body = body;
+   pool->body_arg = arg;
+   Start_phase(pool, For_job);
+   Wait_phase(pool);
+}  /* pool_parallel_for */
+
+/*-----------------------------------------------------------------*/
+void pool_submit(pool_t* pool, pool_task_fn_t fn, void* arg) {
+   struct pool_task_s* task = malloc(sizeof(struct pool_task_s));
+
+   if (task == NULL) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   task->fn = fn;
+   task->arg = arg;
+   task->next = NULL;
+   pthread_mutex_lock(&pool->mutex);
+   if (pool->tail == NULL)
+      __atomic_store_n(&pool->head, task, __ATOMIC_RELAXED);
+   else
+      pool->tail->next = task;
+   pool->tail = task;
+   pool->outstanding++;
+   pthread_cond_signal(&pool->work_cond);
+   pthread_mutex_unlock(&pool->mutex);
+}  /* pool_submit */
+
+/*-----------------------------------------------------------------*/
+/* Esperar a que terminen todas las tareas encoladas */
+void pool_wait(pool_t* pool) {
+   pthread_mutex_lock(&pool->mutex);
+   while (pool->outstanding != 0)
+      pthread_cond_wait(&pool->done_cond, &pool->mutex);
+   pthread_mutex_unlock(&pool->mutex);
+}  /* pool_wait */
+
+/*-----------------------------------------------------------------*/
+/* Terminar las tareas pendientes y los threads */
+void pool_destroy(pool_t* pool) {
+   long rank;
+
+   pool_wait(pool);
+   Start_phase(pool, NULL);
+   for (rank = 0; rank < pool->thread_count; rank++)
+      pthread_join(pool->threads[rank], NULL);
+   pthread_mutex_destroy(&pool->mutex);
+   pthread_cond_destroy(&pool->work_cond);
+   pthread_cond_destroy(&pool->done_cond);
+   free(pool->threads);
+   free(pool->workers);
+}  /* pool_destroy */
@@ -0,0 +1,100 @@
+/* Archivo:   pool.h
+ * Propósito: Archivo de cabecera para pool.c, un conjunto de threads que
+ *            se crean una sola vez y quedan estacionados entre trabajos,
+ *            para que la región medida no incluya pthread_create ni
+ *            pthread_join.
+ *
+ *            pool_run           Fase: cada thread del pool ejecuta
+ *                               fn((void*) rank), como si fuera el
+ *                               Thread_work de pthread_create, y
+ *                               pool_run vuelve cuando terminaron todos
+ *            pool_parallel_for  Reparte [first, last) en trozos de chunk
+ *                               iteraciones que los threads toman a
+ *                               medida que terminan los anteriores
+ *            pool_submit        Encolar una tarea; la ejecuta el primer
+ *                               thread libre. pool_wait espera a que
+ *                               terminen todas, incluidas las que
+ *                               encolaron otras tareas.
+ *
+ * Ejemplo:
+ *    pool_t pool;
+ *    pool_init(&pool, thread_count, NULL);
+ *    GET_TIME(start);
+ *    pool_run(&pool, Thread_work);
+ *    GET_TIME(finish);
+ *    pool_destroy(&pool);
+ *
+ * Nota:      Un solo thread (normalmente main) debe llamar a pool_run,
+ *            pool_parallel_for y pool_destroy; pool_submit se puede llamar
+ *            desde cualquiera, incluso desde una tarea.
+ *            Con placement distinto de NULL, cada thread se fija con
+ *            af_bind(placement, rank) al empezar (ver comun/affinity.h).
+ */
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <pthread.h>
+#include "../comun/affinity.h"
+
+#define POOL_CACHE_LINE 64
+#define POOL_SPIN       2000
+
+typedef void* (*pool_fn_t)(void* rank);
+typedef void  (*pool_range_fn_t)(long first, long last, void* arg);
+typedef void  (*pool_task_fn_t)(void* arg);
+
+struct pool_task_s {
+   pool_task_fn_t fn;
+   void* arg;
+   struct pool_task_s* next;
+};
+
+struct pool_s;
+
+/* Argumento de cada thread del pool */
+struct pool_worker_s {
+   struct pool_s* pool;
+   long rank;
+};
+
+typedef struct pool_s {
+   int thread_count;
+   int spin;                       /* 0 si hay más threads que CPUs */
+   pthread_t* threads;
+   struct pool_worker_s* workers;
+   const af_placement_t* placement;
+
+   /* mutex protege la cola de tareas y las esperas */
+   pthread_mutex_t mutex;
+   pthread_cond_t  work_cond;      /* Hay una fase nueva o una tarea */
+   pthread_cond_t  done_cond;      /* Terminó una fase o todas las tareas */
+
+   /* Fase actual: job(pool, rank); NULL para terminar */
+   void (*job)(struct pool_s* pool, long rank);
+   pool_fn_t fn;
+   int generation __attribute__((aligned(POOL_CACHE_LINE)));
+   int pending __attribute__((aligned(POOL_CACHE_LINE)));
+
+   /* pool_parallel_for */
+   long next __attribute__((aligned(POOL_CACHE_LINE)));
+   long last;
+   long chunk;
+   pool_range_fn_t body;
+   void* body_arg;
+
+   /* pool_submit */
+   struct pool_task_s* head;
+   struct pool_task_s* tail;
+   int outstanding;
+} pool_t;
+
+void pool_init(pool_t* pool, int thread_count,
+      const af_placement_t* placement);
+void pool_run(pool_t* pool, pool_fn_t fn);
+void pool_parallel_for(pool_t* pool, long first, long last, long chunk,
+      pool_range_fn_t body, void* arg);
+void pool_submit(pool_t* pool, pool_task_fn_t fn, void* arg);
+void pool_wait(pool_t* pool);
+void pool_destroy(pool_t* pool);
+
+#endif
@@ -0,0 +1,159 @@
+/* Archivo:   rcu_qsbr.c
+ *
+ * Propósito: Implementar RCU basado en estados quiescentes (ver rcu_qsbr.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_RCU.c batch.c pool.c rcu_qsbr.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. gp_ctr es el contador global de periodos de gracia. Cada thread
+ *       copia su valor en su ranura al pasar por un estado quiescente;
+ *       0 significa fuera de línea.
+ *    2. rcu_synchronize incrementa gp_ctr y espera a que cada ranura en
+ *       línea alcance el valor nuevo. El thread que llama se marca fuera de
+ *       línea mientras espera para no esperarse a sí mismo.
+ *    3. Cada thread acumula hasta DEFER_BATCH punteros antes de esperar un
+ *       periodo de gracia, así el costo se reparte entre muchas eliminaciones.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "rcu_qsbr.h"
+
+#define CACHE_LINE  64
+#define DEFER_BATCH 256
+#define SPIN_LIMIT  64
+
+/* Leída por los escritores, escrita solo por su thread */
+struct rcu_slot_s {
+   unsigned long ctr;
+} __attribute__((aligned(CACHE_LINE)));
+
+/* Privada de cada thread */
+struct rcu_defer_s {
+   void* ptrs[DEFER_BATCH];
+   int   count;
+} __attribute__((aligned(CACHE_LINE)));
+
+static unsigned long gp_ctr __attribute__((aligned(CACHE_LINE))) = 1;
+static unsigned long grace_periods = 0;
+static int rcu_thread_count;
+static struct rcu_slot_s*  slots;
+static struct rcu_defer_s* defers;
+
+/*-----------------------------------------------------------------*/
+/* Función:     rcu_init
+ * Propósito:   Reservar las ranuras de thread_count threads, todos fuera
+ *              de línea
+ */
+void rcu_init(int thread_count) {
+   rcu_thread_count = thread_count;
+   if (posix_memalign((void**) &slots, CACHE_LINE,
+            thread_count*sizeof(struct rcu_slot_s)) != 0 ||
+         posix_memalign((void**) &defers, CACHE_LINE,
+            thread_count*sizeof(struct rcu_defer_s)) != 0) {
+      fprintf(stderr, "La memoria falló.\n");
+      exit(1);
+   }
+   memset(slots, 0, thread_count*sizeof(struct rcu_slot_s));
+   memset(defers, 0, thread_count*sizeof(struct rcu_defer_s));
+}  /* rcu_init */
+
+/*-----------------------------------------------------------------*/
+void rcu_online(int rank) {
+   __atomic_store_n(&slots[rank].ctr,
+         __atomic_load_n(&gp_ctr, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+}  /* rcu_online */
+
+/*-----------------------------------------------------------------*/
+void rcu_offline(int rank) {
+   __atomic_store_n(&slots[rank].ctr, 0, __ATOMIC_RELEASE);
+}  /* rcu_offline */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rcu_quiescent
+ * Propósito:   Anunciar que el thread no tiene referencias a nodos de
+ *              lecturas anteriores. Solo escribe en la ranura propia.
+ */
+void rcu_quiescent(int rank) {
+   unsigned long gp = __atomic_load_n(&gp_ctr, __ATOMIC_ACQUIRE);
+
+   if (slots[rank].ctr != gp)
+      __atomic_store_n(&slots[rank].ctr, gp, __ATOMIC_RELEASE);
+}  /* rcu_quiescent */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rcu_synchronize
+ * Propósito:   Esperar a que todos los threads en línea pasen por un
+ *              estado quiescente
+ */
+void rcu_synchronize(int rank) {
+   unsigned long target, v;
+   int r, iter;
+
+   rcu_offline(rank);
+   target = __atomic_add_fetch(&gp_ctr, 1, __ATOMIC_SEQ_CST);
+   __atomic_fetch_add(&grace_periods, 1, __ATOMIC_RELAXED);
+   for (r = 0; r < rcu_thread_count; r++) {
+      iter = 0;
+      for (;;) {
+         v = __atomic_load_n(&slots[r].ctr, __ATOMIC_ACQUIRE);
+         if (v == 0 || v >= target) break;
+         if (++iter < SPIN_LIMIT) {
+#           if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#           endif
+         } else {
+            iter = 0;
+            sched_yield();
+         }
+      }
+   }
+   rcu_online(rank);
+}  /* rcu_synchronize */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rcu_defer_free
+ * Propósito:   Liberar ptr cuando ningún lector pueda tener una referencia.
+ *              El thread no debe tener referencias a nodos al llamarla.
+ */
+void rcu_defer_free(int rank, void* ptr) {
+   struct rcu_defer_s* d = &defers[rank];
+   int i;
+
+   d->ptrs[d->count++] = ptr;
+   if (d->count == DEFER_BATCH) {
+      rcu_synchronize(rank);
+      for (i = 0; i < d->count; i++)
+         free(d->ptrs[i]);
+      d->count = 0;
+   }
+}  /* rcu_defer_free */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rcu_free_pending
+ * Propósito:   Liberar todo lo pendiente. Solo se puede llamar cuando
+ *              ningún thread está leyendo.
+ */
+void rcu_free_pending(void) {
+   int r, i;
+
+   for (r = 0; r < rcu_thread_count; r++) {
+      for (i = 0; i < defers[r].count; i++)
+         free(defers[r].ptrs[i]);
+      defers[r].count = 0;
+   }
+}  /* rcu_free_pending */
+
+/*-----------------------------------------------------------------*/
+unsigned long rcu_grace_periods(void) {
+   return __atomic_load_n(&grace_periods, __ATOMIC_RELAXED);
+}  /* rcu_grace_periods */
+
+/*-----------------------------------------------------------------*/
+void rcu_destroy(void) {
+   rcu_free_pending();
+   free(slots);
+   free(defers);
+}  /* rcu_destroy */
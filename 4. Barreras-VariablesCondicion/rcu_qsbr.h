@@ -0,0 +1,30 @@
+/* Archivo:   rcu_qsbr.h
+ * Propósito: Archivo de cabecera para rcu_qsbr.c, que implementa una
+ *            versión mínima de RCU en espacio de usuario basada en estados
+ *            quiescentes (QSBR).
+ *
+ *            Los lectores no escriben en memoria compartida durante una
+ *            búsqueda: solo cada tanto anuncian, en su propia línea de cache,
+ *            que no tienen referencias a nodos (rcu_quiescent). Los escritores
+ *            desenlazan nodos y los liberan con rcu_defer_free, que espera un
+ *            periodo de gracia (todos los threads en línea pasaron por un
+ *            estado quiescente) antes de llamar a free.
+ *
+ * Nota:      rank debe estar en [0, thread_count). Un thread fuera de línea
+ *            (rcu_offline) no retrasa los periodos de gracia, así que debe
+ *            marcarse así antes de bloquearse por mucho tiempo o terminar.
+ */
+#ifndef _RCU_QSBR_H_
+#define _RCU_QSBR_H_
+
+void rcu_init(int thread_count);
+void rcu_online(int rank);
+void rcu_offline(int rank);
+void rcu_quiescent(int rank);
+void rcu_synchronize(int rank);
+void rcu_defer_free(int rank, void* ptr);
+void rcu_free_pending(void);
+unsigned long rcu_grace_periods(void);
+void rcu_destroy(void);
+
+#endif
@@ -0,0 +1,252 @@
+/* Archivo:   rng.c
+ *
+ * Propósito: Implementar la siembra, los saltos y el llenado vectorial de
+ *            xoshiro256++ (ver rng.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -o ejecutable listaEnlazada_OneMutex.c workload.c rng.c my_rand.c ... -lpthread -lm
+ *            Con -march=native los carriles usan AVX2 o AVX-512 si los hay.
+ *            Con -D_RNG_MAIN_ (y my_rand.c) se compila una pequeña medición de
+ *            velocidad:
+ *            gcc -O2 -march=native -D_RNG_MAIN_ -o rng rng.c my_rand.c
+ *
+ * Notas:
+ *    1. La semilla de 64 bits se expande a los 256 bits de estado con
+ *       splitmix64, como recomiendan los autores; el estado nunca queda en
+ *       cero.
+ *    2. rng_fill_* copian el estado a variables locales y lo guardan al
+ *       final, así que el lazo trabaja solo con registros. Si n no es
+ *       múltiplo de los valores que da un paso, se descartan los que
+ *       sobran del último.
+ *    3. xoshiro256++ no tiene los bits bajos débiles de xoshiro256+ ni
+ *       la correlación entre valores consecutivos del LCG de my_rand, así
+ *       que dos valores seguidos se pueden usar para decidir la operación
+ *       y la key.
+ *
+ * Referencia: D. Blackman y S. Vigna, "Scrambled Linear Pseudorandom
+ *             Number Generators", ACM TOMS 47(4), 2021.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rng.h"
+
+static const uint64_t jump_poly[4] = { 0x180ec6d33cfd0abaULL,
+   0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+static const uint64_t long_jump_poly[4] = { 0x76e15d3efefdcbbfULL,
+   0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL };
+
+#ifdef _RNG_MAIN_
+#include "timer.h"
+#include "my_rand.h"
+
+#define VALUES (1L << 26)
+#define BATCH  4096
+
+int main(void) {
+   rng_t r;
+   rng_bulk_t b;
+   unsigned seed = 1, sum = 0, buf[BATCH];
+   uint64_t sum64 = 0;
+   double start, finish;
+   long i, j;
+
+   GET_TIME(start);
+   for (i = 0; i < VALUES; i++)
+      sum += my_rand(&seed);
+   GET_TIME(finish);
+   printf("my_rand          %6.2f ns/valor\n", 1.0e9*(finish - start)/VALUES);
+
+   rng_seed(&r, 1);
+   GET_TIME(start);
+   for (i = 0; i < VALUES; i++)
+      sum64 += rng_next(&r);
+   GET_TIME(finish);
+   printf("rng_next         %6.2f ns/valor (64 bits)\n",
+         1.0e9*(finish - start)/VALUES);
+
+   rng_bulk_init(&b, &r);
+   GET_TIME(start);
+   for (i = 0; i < VALUES; i += BATCH) {
+      rng_fill_u32(&b, buf, BATCH);
+      for (j = 0; j < BATCH; j++) sum += buf[j];
+   }
+   GET_TIME(finish);
+   printf("rng_fill_u32     %6.2f ns/valor\n", 1.0e9*(finish - start)/VALUES);
+
+   GET_TIME(start);
+   for (i = 0; i < VALUES; i += BATCH) {
+      rng_fill_below(&b, buf, BATCH, 1000);
+      for (j = 0; j < BATCH; j++) sum += buf[j];
+   }
+   GET_TIME(finish);
+   printf("rng_fill_below   %6.2f ns/valor\n", 1.0e9*(finish - start)/VALUES);
+
+   printf("(%u %llu)\n", sum, (unsigned long long) sum64);
+   return 0;
+}
+#endif
+
+/*-----------------------------------------------------------------*/
+static uint64_t Splitmix64(uint64_t* x_p) {
+   uint64_t z = (*x_p += 0x9e3779b97f4a7c15ULL);
+
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}  /* Splitmix64 */
+
+/*-----------------------------------------------------------------*/
+void rng_seed(rng_t* r, uint64_t seed) {
+   int i;
+
+   for (i = 0; i < 4; i++)
+      r->s[i] = Splitmix64(&seed);
+}  /* rng_seed */
+
+/*-----------------------------------------------------------------*/
+/* Función:    Jump
+ * Propósito:  Avanzar r tantos valores como indica el polinomio poly:
+ *             2^128 con jump_poly, 2^192 con long_jump_poly
+ */
+static void Jump(rng_t* r, const uint64_t poly[4]) {
+   uint64_t s[4] = { 0, 0, 0, 0 };
+   int i, b, k;
+
+   for (i = 0; i < 4; i++)
+      for (b = 0; b < 64; b++) {
+         if (poly[i] & (1ULL << b))
+            for (k = 0; k < 4; k++)
+               s[k] ^= r->s[k];
+         rng_next(r);
+      }
+   memcpy(r->s, s, sizeof(s));
+}  /* Jump */
+
+/*-----------------------------------------------------------------*/
+void rng_jump(rng_t* r) {
+   Jump(r, jump_poly);
+}  /* rng_jump */
+
+/*-----------------------------------------------------------------*/
+void rng_long_jump(rng_t* r) {
+   Jump(r, long_jump_poly);
+}  /* rng_long_jump */
+
+/*-----------------------------------------------------------------*/
+/* Función:    rng_thread_init
+ * Propósito:  Dar al thread rank su propio flujo: el de seed avanzado
+ *             rank*2^192 valores. Todos los threads usan la misma seed.
+ */
+void rng_thread_init(rng_t* r, uint64_t seed, long rank) {
+   long k;
+
+   rng_seed(r, seed);
+   for (k = 0; k < rank; k++)
+      rng_long_jump(r);
+}  /* rng_thread_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:    rng_bulk_init
+ * Propósito:  El carril j arranca en r avanzado (j + 1)*2^128 valores,
+ *             así r se puede seguir usando por separado
+ */
+void rng_bulk_init(rng_bulk_t* b, const rng_t* r) {
+   rng_t lane = *r;
+   int i, j;
+
+   for (j = 0; j < RNG_LANES; j++) {
+      rng_jump(&lane);
+      for (i = 0; i < 4; i++)
+         b->s[i][j] = lane.s[i];
+   }
+}  /* rng_bulk_init */
+
+/*-----------------------------------------------------------------*/
+/* Un paso de xoshiro256++ en todos los carriles. El resultado sale por
+ * puntero: devolver un vector por valor depende del ABI de cada -march. */
+static inline void Bulk_next(rng_vec_t s[4], rng_vec_t* result_p) {
+   rng_vec_t sum = s[0] + s[3];
+   rng_vec_t t = s[1] << 17;
+
+   *result_p = ((sum << 23) | (sum >> 41)) + s[0];
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = (s[3] << 45) | (s[3] >> 19);
+}  /* Bulk_next */
+
+/*-----------------------------------------------------------------*/
+void rng_fill_u64(rng_bulk_t* b, uint64_t* out, long n) {
+   rng_vec_t s[4] = { b->s[0], b->s[1], b->s[2], b->s[3] };
+   rng_vec_t v;
+   long i;
+
+   for (i = 0; i + RNG_LANES <= n; i += RNG_LANES) {
+      Bulk_next(s, &v);
+      memcpy(&out[i], &v, sizeof(v));
+   }
+   if (i < n) {
+      Bulk_next(s, &v);
+      memcpy(&out[i], &v, (n - i)*sizeof(uint64_t));
+   }
+   memcpy(b->s, s, sizeof(s));
+}  /* rng_fill_u64 */
+
+/*-----------------------------------------------------------------*/
+/* Cada valor de 64 bits da dos de 32 */
+void rng_fill_u32(rng_bulk_t* b, unsigned* out, long n) {
+   rng_vec_t s[4] = { b->s[0], b->s[1], b->s[2], b->s[3] };
+   rng_vec_t v;
+   long i;
+
+   for (i = 0; i + 2*RNG_LANES <= n; i += 2*RNG_LANES) {
+      Bulk_next(s, &v);
+      memcpy(&out[i], &v, sizeof(v));
+   }
+   if (i < n) {
+      Bulk_next(s, &v);
+      memcpy(&out[i], &v, (n - i)*sizeof(unsigned));
+   }
+   memcpy(b->s, s, sizeof(s));
+}  /* rng_fill_u32 */
+
+/*-----------------------------------------------------------------*/
+/* Función:    rng_fill_below
+ * Propósito:  Llenar out con enteros en [0, bound), multiplicando cada
+ *             mitad de 32 bits por bound y quedándose con la parte alta
+ */
+void rng_fill_below(rng_bulk_t* b, unsigned* out, long n, unsigned bound) {
+   rng_vec_t s[4] = { b->s[0], b->s[1], b->s[2], b->s[3] };
+   rng_vec_t v, hi, lo;
+   long i;
+
+   for (i = 0; i < n; i += 2*RNG_LANES) {
+      Bulk_next(s, &v);
+      hi = ((v >> 32)*bound) >> 32;
+      lo = ((v & 0xffffffffULL)*bound) >> 32;
+      v = (hi << 32) | lo;
+      memcpy(&out[i], &v, i + 2*RNG_LANES <= n ? sizeof(v)
+            : (n - i)*sizeof(unsigned));
+   }
+   memcpy(b->s, s, sizeof(s));
+}  /* rng_fill_below */
+
+/*-----------------------------------------------------------------*/
+void rng_fill_double(rng_bulk_t* b, double* out, long n) {
+   typedef double dvec_t __attribute__((vector_size(8*RNG_LANES)));
+   rng_vec_t s[4] = { b->s[0], b->s[1], b->s[2], b->s[3] };
+   rng_vec_t v;
+   dvec_t d;
+   long i;
+
+   for (i = 0; i < n; i += RNG_LANES) {
+      Bulk_next(s, &v);
+      d = __builtin_convertvector(v >> 11, dvec_t) * 0x1.0p-53;
+      memcpy(&out[i], &d, i + RNG_LANES <= n ? sizeof(d)
+            : (n - i)*sizeof(double));
+   }
+   memcpy(b->s, s, sizeof(s));
+}  /* rng_fill_double */
@@ -0,0 +1,89 @@
+/* Archivo:   rng.h
+ * Propósito: Archivo de cabecera para rng.c, un generador xoshiro256++
+ *            (Blackman y Vigna) para reemplazar a my_rand en los lazos
+ *            calientes.
+ *
+ *            rng_t       Un flujo de 64 bits. rng_next, rng_double y
+ *                        rng_below son inline y no dividen.
+ *            rng_bulk_t  RNG_LANES flujos intercalados que avanzan a la vez
+ *                        con los tipos vectoriales de gcc (SSE2, AVX2 o
+ *                        AVX-512 según -march). rng_fill_* llenan un
+ *                        arreglo con miles de valores por llamada.
+ *
+ *            Para flujos independientes por thread, rng_thread_init avanza
+ *            la semilla rank veces 2^192 valores (rng_long_jump). Los
+ *            carriles de un rng_bulk_t se separan 2^128 valores
+ *            (rng_jump), así que no se pisan con los de otro thread.
+ *
+ * Ejemplo:
+ *    rng_t r;
+ *    rng_bulk_t b;
+ *    unsigned keys[1024];
+ *    . . .   en cada thread:
+ *       rng_thread_init(&r, 1, my_rank);
+ *       rng_bulk_init(&b, &r);
+ *       rng_fill_below(&b, keys, 1024, MAX_KEY);
+ */
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include <stdint.h>
+
+#define RNG_LANES 8
+
+typedef struct {
+   uint64_t s[4];
+} rng_t;
+
+typedef uint64_t rng_vec_t __attribute__((vector_size(8*RNG_LANES)));
+
+typedef struct {
+   rng_vec_t s[4];        /* s[i] tiene la palabra i de cada carril */
+} rng_bulk_t;
+
+/*-----------------------------------------------------------------*/
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+   return (x << k) | (x >> (64 - k));
+}  /* rng_rotl */
+
+/*-----------------------------------------------------------------*/
+/* Siguiente valor de 64 bits del flujo r */
+static inline uint64_t rng_next(rng_t* r) {
+   uint64_t* s = r->s;
+   uint64_t result = rng_rotl(s[0] + s[3], 23) + s[0];
+   uint64_t t = s[1] << 17;
+
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = rng_rotl(s[3], 45);
+   return result;
+}  /* rng_next */
+
+/*-----------------------------------------------------------------*/
+/* Double en [0, 1) con los 53 bits altos */
+static inline double rng_double(rng_t* r) {
+   return (rng_next(r) >> 11) * 0x1.0p-53;
+}  /* rng_double */
+
+/*-----------------------------------------------------------------*/
+/* Entero en [0, bound) sin %: los 32 bits altos por bound (Lemire).
+ * El sesgo es de a lo sumo bound/2^32. */
+static inline unsigned rng_below(rng_t* r, unsigned bound) {
+   return (unsigned) (((rng_next(r) >> 32) * bound) >> 32);
+}  /* rng_below */
+
+void rng_seed(rng_t* r, uint64_t seed);
+void rng_jump(rng_t* r);
+void rng_long_jump(rng_t* r);
+void rng_thread_init(rng_t* r, uint64_t seed, long rank);
+
+void rng_bulk_init(rng_bulk_t* b, const rng_t* r);
+void rng_fill_u64(rng_bulk_t* b, uint64_t* out, long n);
+void rng_fill_u32(rng_bulk_t* b, unsigned* out, long n);
+void rng_fill_below(rng_bulk_t* b, unsigned* out, long n, unsigned bound);
+void rng_fill_double(rng_bulk_t* b, double* out, long n);
+
+#endif
@@ -0,0 +1,307 @@
+/* Archivo:   rwlocks.c
+ *
+ * Propósito: Implementar locks de read y write intercambiables (ver rwlocks.h)
+ *            con histogramas opcionales de latencia de adquisición.
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_ReadWriteLocks.c batch.c pool.c rwlocks.c latency.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Notas:
+ *    1. pft y brlock esperan activamente. Tras SPIN_LIMIT iteraciones ceden
+ *       la CPU con sched_yield para no bloquearse cuando hay más threads
+ *       que núcleos.
+ *    2. Los histogramas son por thread y en líneas de cache separadas, así
+ *       que medir no agrega escrituras compartidas. Se combinan al imprimir.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "rwlocks.h"
+#include "../comun/hrtimer.h"
+
+#define SPIN_LIMIT 64
+
+/* Constantes del phase-fair ticket lock */
+#define PFT_RINC  0x100u   /* Incremento de lectores */
+#define PFT_WBITS 0x3u     /* Bits de escritor en rin */
+#define PFT_PRES  0x2u     /* Escritor presente */
+#define PFT_PHID  0x1u     /* Identificador de fase */
+
+static const char* kind_names[] = { "pthread", "wpref", "pft", "brlock" };
+
+/*-----------------------------------------------------------------*/
+static inline void Spin_pause(int* iter_p) {
+   if (++(*iter_p) < SPIN_LIMIT) {
+#     if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#     endif
+   } else {
+      *iter_p = 0;
+      sched_yield();
+   }
+}  /* Spin_pause */
+
+/*-----------------------------------------------------------------*/
+static inline void Record(rwl_t* lock_p, int rank, int is_write,
+      long long elapsed) {
+   int b = 0;
+
+   while (elapsed > 1 && b < RWL_HIST_BUCKETS - 1) {
+      elapsed >>= 1;
+      b++;
+   }
+   lock_p->hist[rank].buckets[is_write][b]++;
+}  /* Record */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rwl_parse_kind
+ * Propósito:   Convertir el nombre de un lock en su tipo
+ * Val Retorno: 1 si el nombre es válido, 0 si no
+ */
+int rwl_parse_kind(const char* name, rwl_kind_t* kind_p) {
+   int k;
+
+   for (k = RWL_PTHREAD; k <= RWL_BRLOCK; k++)
+      if (strcmp(name, kind_names[k]) == 0) {
+         *kind_p = (rwl_kind_t) k;
+         return 1;
+      }
+   return 0;
+}  /* rwl_parse_kind */
+
+/*-----------------------------------------------------------------*/
+const char* rwl_kind_name(rwl_kind_t kind) {
+   return kind_names[kind];
+}  /* rwl_kind_name */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rwl_init
+ * Propósito:   Inicializar un lock del tipo kind para thread_count threads
+ * En arg:      measure: si no es cero se registran latencias de adquisición
+ */
+void rwl_init(rwl_t* lock_p, rwl_kind_t kind, int thread_count, int measure) {
+   memset(lock_p, 0, sizeof(rwl_t));
+   lock_p->kind = kind;
+   lock_p->thread_count = thread_count;
+   lock_p->hist = NULL;
+   if (measure &&
+         posix_memalign((void**) &lock_p->hist, RWL_CACHE_LINE,
+            thread_count*sizeof(struct rwl_hist_s)) == 0)
+      memset(lock_p->hist, 0, thread_count*sizeof(struct rwl_hist_s));
+
+   switch (kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_init(&lock_p->rwlock, NULL);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_init(&lock_p->mutex, NULL);
+         pthread_cond_init(&lock_p->readers_ok, NULL);
+         pthread_cond_init(&lock_p->writer_ok, NULL);
+         break;
+      case RWL_PFT:
+         break;
+      case RWL_BRLOCK:
+         if (posix_memalign((void**) &lock_p->slots, RWL_CACHE_LINE,
+                  thread_count*sizeof(struct rwl_slot_s)) != 0) {
+            fprintf(stderr, "La memoria falló.\n");
+            exit(1);
+         }
+         memset(lock_p->slots, 0, thread_count*sizeof(struct rwl_slot_s));
+         break;
+   }
+}  /* rwl_init */
+
+/*-----------------------------------------------------------------*/
+void rwl_rdlock(rwl_t* lock_p, int rank) {
+   long long start = 0;
+   unsigned w;
+   int iter = 0;
+
+   if (lock_p->hist != NULL) start = hr_now_ns();
+   switch (lock_p->kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_rdlock(&lock_p->rwlock);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_lock(&lock_p->mutex);
+         while (lock_p->active_writer || lock_p->waiting_writers > 0)
+            pthread_cond_wait(&lock_p->readers_ok, &lock_p->mutex);
+         lock_p->active_readers++;
+         pthread_mutex_unlock(&lock_p->mutex);
+         break;
+      case RWL_PFT:
+         /* Si hay escritor, esperar a que termine su fase */
+         w = __atomic_fetch_add(&lock_p->rin, PFT_RINC, __ATOMIC_ACQUIRE)
+               & PFT_WBITS;
+         if (w != 0)
+            while ((__atomic_load_n(&lock_p->rin, __ATOMIC_ACQUIRE)
+                     & PFT_WBITS) == w)
+               Spin_pause(&iter);
+         break;
+      case RWL_BRLOCK:
+         /* Dekker: anunciar lectura y luego comprobar el escritor */
+         for (;;) {
+            __atomic_store_n(&lock_p->slots[rank].reading, 1, __ATOMIC_SEQ_CST);
+            if (!__atomic_load_n(&lock_p->writer, __ATOMIC_SEQ_CST))
+               break;
+            __atomic_store_n(&lock_p->slots[rank].reading, 0, __ATOMIC_RELEASE);
+            while (__atomic_load_n(&lock_p->writer, __ATOMIC_ACQUIRE))
+               Spin_pause(&iter);
+         }
+         break;
+   }
+   if (lock_p->hist != NULL) Record(lock_p, rank, 0, hr_now_ns() - start);
+}  /* rwl_rdlock */
+
+/*-----------------------------------------------------------------*/
+void rwl_rdunlock(rwl_t* lock_p, int rank) {
+   switch (lock_p->kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_unlock(&lock_p->rwlock);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_lock(&lock_p->mutex);
+         lock_p->active_readers--;
+         if (lock_p->active_readers == 0 && lock_p->waiting_writers > 0)
+            pthread_cond_signal(&lock_p->writer_ok);
+         pthread_mutex_unlock(&lock_p->mutex);
+         break;
+      case RWL_PFT:
+         __atomic_fetch_add(&lock_p->rout, PFT_RINC, __ATOMIC_RELEASE);
+         break;
+      case RWL_BRLOCK:
+         __atomic_store_n(&lock_p->slots[rank].reading, 0, __ATOMIC_RELEASE);
+         break;
+   }
+}  /* rwl_rdunlock */
+
+/*-----------------------------------------------------------------*/
+void rwl_wrlock(rwl_t* lock_p, int rank) {
+   long long start = 0;
+   unsigned ticket, w, rticket;
+   int iter = 0, r;
+
+   if (lock_p->hist != NULL) start = hr_now_ns();
+   switch (lock_p->kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_wrlock(&lock_p->rwlock);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_lock(&lock_p->mutex);
+         lock_p->waiting_writers++;
+         while (lock_p->active_writer || lock_p->active_readers > 0)
+            pthread_cond_wait(&lock_p->writer_ok, &lock_p->mutex);
+         lock_p->waiting_writers--;
+         lock_p->active_writer = 1;
+         pthread_mutex_unlock(&lock_p->mutex);
+         break;
+      case RWL_PFT:
+         /* Turno entre escritores */
+         ticket = __atomic_fetch_add(&lock_p->win, 1, __ATOMIC_RELAXED);
+         while (__atomic_load_n(&lock_p->wout, __ATOMIC_ACQUIRE) != ticket)
+            Spin_pause(&iter);
+         /* Bloquear lectores nuevos y esperar a los que ya entraron */
+         w = PFT_PRES | (ticket & PFT_PHID);
+         rticket = __atomic_fetch_add(&lock_p->rin, w, __ATOMIC_ACQUIRE);
+         while (__atomic_load_n(&lock_p->rout, __ATOMIC_ACQUIRE) != rticket)
+            Spin_pause(&iter);
+         break;
+      case RWL_BRLOCK:
+         while (__atomic_exchange_n(&lock_p->writer, 1, __ATOMIC_SEQ_CST))
+            Spin_pause(&iter);
+         for (r = 0; r < lock_p->thread_count; r++)
+            while (__atomic_load_n(&lock_p->slots[r].reading, __ATOMIC_SEQ_CST))
+               Spin_pause(&iter);
+         break;
+   }
+   if (lock_p->hist != NULL) Record(lock_p, rank, 1, hr_now_ns() - start);
+}  /* rwl_wrlock */
+
+/*-----------------------------------------------------------------*/
+void rwl_wrunlock(rwl_t* lock_p, int rank) {
+   switch (lock_p->kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_unlock(&lock_p->rwlock);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_lock(&lock_p->mutex);
+         lock_p->active_writer = 0;
+         if (lock_p->waiting_writers > 0)
+            pthread_cond_signal(&lock_p->writer_ok);
+         else
+            pthread_cond_broadcast(&lock_p->readers_ok);
+         pthread_mutex_unlock(&lock_p->mutex);
+         break;
+      case RWL_PFT:
+         __atomic_fetch_and(&lock_p->rin, ~PFT_WBITS, __ATOMIC_RELEASE);
+         __atomic_fetch_add(&lock_p->wout, 1, __ATOMIC_RELEASE);
+         break;
+      case RWL_BRLOCK:
+         __atomic_store_n(&lock_p->writer, 0, __ATOMIC_RELEASE);
+         break;
+   }
+}  /* rwl_wrunlock */
+
+/*-----------------------------------------------------------------*/
+/* Función:     rwl_print_hist
+ * Propósito:   Combinar los histogramas de todos los threads e imprimir,
+ *              para lecturas y escrituras, el número de adquisiciones,
+ *              las cotas de p50/p99/p99.9 y los intervalos no vacíos
+ */
+void rwl_print_hist(rwl_t* lock_p) {
+   static const char* op_names[] = { "lectura", "escritura" };
+   static const double quantiles[] = { 0.5, 0.99, 0.999 };
+   unsigned long merged[RWL_HIST_BUCKETS], total, seen;
+   int op, b, r, q;
+
+   if (lock_p->hist == NULL) return;
+   printf("Latencia de adquisición (%s):\n", rwl_kind_name(lock_p->kind));
+   for (op = 0; op < 2; op++) {
+      total = 0;
+      for (b = 0; b < RWL_HIST_BUCKETS; b++) {
+         merged[b] = 0;
+         for (r = 0; r < lock_p->thread_count; r++)
+            merged[b] += lock_p->hist[r].buckets[op][b];
+         total += merged[b];
+      }
+      printf("   %-9s %lu adquisiciones", op_names[op], total);
+      if (total == 0) {
+         printf("\n");
+         continue;
+      }
+      for (q = 0; q < 3; q++) {
+         seen = 0;
+         for (b = 0; b < RWL_HIST_BUCKETS; b++) {
+            seen += merged[b];
+            if (seen >= quantiles[q]*total) break;
+         }
+         printf(", p%g < %llu ns", 100*quantiles[q], 1ULL << (b+1));
+      }
+      printf("\n");
+      for (b = 0; b < RWL_HIST_BUCKETS; b++)
+         if (merged[b] > 0)
+            printf("      [%10llu, %10llu) ns: %lu\n",
+                  b == 0 ? 0ULL : 1ULL << b, 1ULL << (b+1), merged[b]);
+   }
+}  /* rwl_print_hist */
+
+/*-----------------------------------------------------------------*/
+void rwl_destroy(rwl_t* lock_p) {
+   switch (lock_p->kind) {
+      case RWL_PTHREAD:
+         pthread_rwlock_destroy(&lock_p->rwlock);
+         break;
+      case RWL_WPREF:
+         pthread_mutex_destroy(&lock_p->mutex);
+         pthread_cond_destroy(&lock_p->readers_ok);
+         pthread_cond_destroy(&lock_p->writer_ok);
+         break;
+      case RWL_PFT:
+         break;
+      case RWL_BRLOCK:
+         free(lock_p->slots);
+         break;
+   }
+   free(lock_p->hist);
+}  /* rwl_destroy */
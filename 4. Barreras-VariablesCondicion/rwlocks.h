@@ -0,0 +1,73 @@
+/* Archivo:   rwlocks.h
+ * Propósito: Archivo de cabecera para rwlocks.c, que implementa varios
+ *            locks de read y write intercambiables en tiempo de ejecución:
+ *
+ *            pthread  pthread_rwlock_t (preferencia de lectores en glibc)
+ *            wpref    Preferencia de escritores (mutex + variables de condición)
+ *            pft      Phase-fair ticket lock (Brandenburg y Anderson, 2010):
+ *                     lectores y escritores se alternan por fases
+ *            brlock   "Big-reader" lock: cada lector escribe solo en su propia
+ *                     línea de cache; el escritor revisa todas
+ *
+ *            Cada lock puede registrar histogramas de latencia de adquisición
+ *            por thread (potencias de 2 en nanosegundos).
+ *
+ * Nota:      rank debe estar en [0, thread_count). brlock lo usa para elegir
+ *            la ranura del lector; los demás solo para los histogramas.
+ */
+#ifndef _RWLOCKS_H_
+#define _RWLOCKS_H_
+
+#include <pthread.h>
+
+#define RWL_CACHE_LINE 64
+#define RWL_HIST_BUCKETS 32
+
+typedef enum { RWL_PTHREAD, RWL_WPREF, RWL_PFT, RWL_BRLOCK } rwl_kind_t;
+
+/* Estadísticas de un thread: [0] lecturas, [1] escrituras */
+struct rwl_hist_s {
+   unsigned long buckets[2][RWL_HIST_BUCKETS];
+} __attribute__((aligned(RWL_CACHE_LINE)));
+
+/* Ranura por lector del big-reader lock */
+struct rwl_slot_s {
+   int reading;
+} __attribute__((aligned(RWL_CACHE_LINE)));
+
+typedef struct {
+   rwl_kind_t kind;
+   int        thread_count;
+   struct rwl_hist_s* hist;   /* NULL si no se miden latencias */
+
+   /* pthread */
+   pthread_rwlock_t rwlock;
+
+   /* wpref */
+   pthread_mutex_t mutex;
+   pthread_cond_t  readers_ok;
+   pthread_cond_t  writer_ok;
+   int active_readers, active_writer, waiting_writers;
+
+   /* pft: cada contador en su propia línea de cache */
+   unsigned rin  __attribute__((aligned(RWL_CACHE_LINE)));
+   unsigned rout __attribute__((aligned(RWL_CACHE_LINE)));
+   unsigned win  __attribute__((aligned(RWL_CACHE_LINE)));
+   unsigned wout __attribute__((aligned(RWL_CACHE_LINE)));
+
+   /* brlock */
+   int writer __attribute__((aligned(RWL_CACHE_LINE)));
+   struct rwl_slot_s* slots;
+} rwl_t;
+
+int  rwl_parse_kind(const char* name, rwl_kind_t* kind_p);
+const char* rwl_kind_name(rwl_kind_t kind);
+void rwl_init(rwl_t* lock_p, rwl_kind_t kind, int thread_count, int measure);
+void rwl_rdlock(rwl_t* lock_p, int rank);
+void rwl_rdunlock(rwl_t* lock_p, int rank);
+void rwl_wrlock(rwl_t* lock_p, int rank);
+void rwl_wrunlock(rwl_t* lock_p, int rank);
+void rwl_print_hist(rwl_t* lock_p);
+void rwl_destroy(rwl_t* lock_p);
+
+#endif
@@ -0,0 +1,132 @@
+/* Archivo:
+ *    sense_barrier.c
+ *
+ * Propósito:
+ *    Sincronizar threads con una barrera centralizada con inversión de
+ *    sentido (sense reversal): un contador atómico y una bandera de
+ *    sentido sirven para todas las barreras, sin mutex.
+ *
+ * Entrada:
+ *    Ninguna
+ * Salida:
+ *    Time for BARRIER_COUNT barriers
+ *
+ * Compilar:
+ *    gcc -O2 -g -Wall -o ejecutable sense_barrier.c futex_sync.c -lpthread
+ *    timer.h y futex_sync.h deben estar disponibles
+ *
+ * Ejecutar:
+ *    ./ejecutable <thread_count> [spin]
+ *    spin: iteraciones de espera activa antes de dormir en el futex
+ *    (por defecto DEFAULT_SPIN; 0 duerme de inmediato)
+ *
+ * Notas:
+ *    1. A diferencia de busy_barrier.c y semaphores_barrier.c no hace
+ *       falta un contador o un semáforo por barrera: la memoria es O(1) y
+ *       la barrera se puede reutilizar indefinidamente.
+ *    2. La barrera es fx_barrier de futex_sync.c. Su palabra generation
+ *       hace de bandera de sentido: cada thread la lee antes de
+ *       decrementar count, el último en llegar repone count y después la
+ *       incrementa (el bit bajo se invierte), y los demás esperan a que
+ *       cambie respecto del valor que leyeron. No puede volver a cambiar
+ *       antes de que un thread lento lo vea, porque la barrera siguiente
+ *       no se completa sin él.
+ *    3. La espera es activa con pause durante spin iteraciones y después
+ *       el thread duerme con FUTEX_WAIT; el contador de threads dormidos
+ *       que evita perder despertares está explicado en la nota 3 de
+ *       futex_sync.c.
+ *    4. count y generation están en líneas de cache distintas: las
+ *       llegadas no invalidan la línea en la que esperan los demás.
+ *    5. Solo Linux (futex). El flag de compilación DEBUG imprimirá un
+ *       mensaje después de cada barrera.
+ *    6. El tiempo de BARRIER_COUNT barreras incluye crear y esperar a los
+ *       threads. comparar_barreras.sh mide esta barrera (tipo futex) y la
+ *       de sentido puramente activa (tipo sense) con barrier_driver.c,
+ *       sobre un pool de threads y con muchos más episodios.
+ *
+ * IPP:   Sección 4.8 (págs. 176 y sigs.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "timer.h"
+#include "futex_sync.h"
+
+#define BARRIER_COUNT 100
+#define DEFAULT_SPIN 4000
+
+int thread_count;
+int spin;
+fx_barrier_t barrier;
+
+void Usage(char* prog_name);
+void *Thread_work(void* rank);
+
+/*--------------------------------------------------------------------*/
+int main(int argc, char* argv[]) {
+   long       thread;
+   pthread_t* thread_handles;
+   double start, finish;
+
+   if (argc != 2 && argc != 3)
+      Usage(argv[0]);
+   thread_count = strtol(argv[1], NULL, 10);
+   spin = argc == 3 ? strtol(argv[2], NULL, 10) : DEFAULT_SPIN;
+
+   thread_handles = malloc (thread_count*sizeof(pthread_t));
+   fx_barrier_init(&barrier, thread_count, spin);
+
+   GET_TIME(start);
+   for (thread = 0; thread < thread_count; thread++)
+      pthread_create(&thread_handles[thread], NULL,
+          Thread_work, (void*) thread);
+
+   for (thread = 0; thread < thread_count; thread++) {
+      pthread_join(thread_handles[thread], NULL);
+   }
+   GET_TIME(finish);
+   printf("Tiempo transcurrido = %e segundos\n", finish - start);
+
+   free(thread_handles);
+   return 0;
+}  /* main */
+
+
+/*--------------------------------------------------------------------
+ * Función:     Usage
+ * Propósito:   Imprimir línea de comando para función y terminar
+ * En arg:      prog_name
+ */
+void Usage(char* prog_name) {
+
+   fprintf(stderr, "Usar: %s <numero de threads> [spin]\n", prog_name);
+   exit(0);
+}  /* Usage */
+
+
+/*-------------------------------------------------------------------
+ * Función:     Thread_work
+ * Propósito:   Ejecutar las barreras BARRIER_COUNT
+ * En arg:      rank
+ * Var Global:  barrier
+ * Val Retorno: Ignorado
+ */
+void *Thread_work(void* rank) {
+#  ifdef DEBUG
+   long my_rank = (long) rank;
+#  endif
+   int i;
+
+   for (i = 0; i < BARRIER_COUNT; i++) {
+      fx_barrier_wait(&barrier);
+#     ifdef DEBUG
+      if (my_rank == 0) {
+         printf("Todos los threads completaron la barrera %d\n", i);
+         fflush(stdout);
+      }
+#     endif
+   }
+
+   return NULL;
+}  /* Thread_work */
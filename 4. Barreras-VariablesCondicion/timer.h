@@ -2,8 +2,10 @@
  *
  * Propósito:  Defina una macro que devuelva el número de segundos que 
  *             han transcurrido desde algún momento en el pasado. 
- *             El temporizador debe devolver tiempos con una precisión 
- *             de microsegundos.
+ *             Usa CLOCK_MONOTONIC_RAW: resolución de nanosegundos y no
+ *             salta si NTP corrige la hora, como gettimeofday. Para
+ *             regiones cortas o contadores con nombre, ver
+ *             ../comun/hrtimer.h.
  *
  * Nota:       El argumento pasado a la macro GET_TIME debe ser un doble, 
  *             *no* un puntero a un doble.
@@ -26,13 +28,13 @@
 #ifndef _TIMER_H_
 #define _TIMER_H_
 
-#include <sys/time.h>
+#include <time.h>
 
 /* El argumento now debería ser un doble (no un puntero a un doble)*/
 #define GET_TIME(now) { \
-   struct timeval t; \
-   gettimeofday(&t, NULL); \
-   now = t.tv_sec + t.tv_usec/1000000.0; \
+   struct timespec t; \
+   clock_gettime(CLOCK_MONOTONIC_RAW, &t); \
+   now = t.tv_sec + t.tv_nsec/1000000000.0; \
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,385 @@
+/* Archivo:   workload.c
+ *
+ * Propósito: Implementar el generador de carga de los programas de listas
+ *            enlazadas (ver workload.h).
+ *
+ * Compilar:  Se enlaza con el programa que lo usa, por ejemplo
+ *            gcc -O2 -g -Wall -I. -o ejecutable listaEnlazada_OneMutex.c batch.c pool.c latency.c lock_prof.c workload.c rng.c my_rand.c -lpthread -lm
+ *
+ * Opciones (después de los argumentos propios de cada programa):
+ *    -k <n>        keys insertadas por el thread principal    (1000)
+ *    -o <n>        operaciones en total                       (100000)
+ *    -s <p>        fracción de búsquedas                      (0.8)
+ *    -i <p>        fracción de inserciones                    (0.1)
+ *    -d <dist>     uniform, zipf, hotspot o seq               (uniform)
+ *    -z <theta>    parámetro de zipf, en (0, 1)               (0.99)
+ *    -H <f>,<p>    hotspot: fracción del rango y probabilidad (0.1,0.9)
+ *    -p <fases>    lista peso:busq:ins separada por comas, por ejemplo
+ *                  0.8:0.99:0.005,0.2:0.1:0.1 (reemplaza a -s e -i)
+ *    -a <política> afinidad de los threads: none, compact, scatter o
+ *                  node (ver comun/affinity.h)                (none)
+ *    -f <archivo>  leer las mismas opciones de un archivo, una por línea,
+ *                  como "nombre valor" con nombres keys, ops, search,
+ *                  insert, dist, theta, hot, phases y affinity. '#' inicia
+ *                  un comentario.
+ *
+ * Notas:
+ *    1. La operación y la key salen de dos valores consecutivos del
+ *       flujo del thread. Con xoshiro256++ no están correlacionados, como
+ *       sí lo estaban con el LCG de my_rand. Las keys se eligen con
+ *       multiplicación y desplazamiento en lugar de %.
+ *    2. zeta(n, theta) para Zipf se calcula exactamente para los primeros
+ *       ZETA_EXACT términos y con la integral para el resto.
+ *
+ * Referencia: J. Gray et al., "Quickly Generating Billion-Record Synthetic
+ *             Databases", SIGMOD 1994 (generador de Zipf).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rng.h"
+#include "workload.h"
+
+#define ZETA_EXACT 10000
+#define SCATTER    2654435761ULL
+
+static const char* dist_names[] = { "uniform", "zipf", "hotspot", "seq" };
+
+/* Valores de -s e -i mientras se leen las opciones */
+static double opt_search, opt_insert;
+
+/*-----------------------------------------------------------------*/
+/* Función:    wl_init
+ * Propósito:  Cargar los valores por defecto
+ */
+void wl_init(wl_config_t* cfg, int max_key) {
+   memset(cfg, 0, sizeof(wl_config_t));
+   cfg->inserts_in_main = 1000;
+   cfg->total_ops = 100000;
+   cfg->max_key = max_key;
+   cfg->dist = WL_UNIFORM;
+   cfg->zipf_theta = 0.99;
+   cfg->hot_fraction = 0.1;
+   cfg->hot_probability = 0.9;
+   cfg->phase_count = 0;
+   cfg->affinity = AF_NONE;
+}  /* wl_init */
+
+/*-----------------------------------------------------------------*/
+void wl_usage(void) {
+   fprintf(stderr, "Opciones de carga:\n");
+   fprintf(stderr, "   -k <keys iniciales>  -o <operaciones>\n");
+   fprintf(stderr, "   -s <busquedas>  -i <inserciones>\n");
+   fprintf(stderr, "   -d uniform|zipf|hotspot|seq  -z <theta>  -H <fraccion>,<prob>\n");
+   fprintf(stderr, "   -p <peso>:<busq>:<ins>[,...]  -f <archivo>\n");
+   fprintf(stderr, "   -a none|compact|scatter|node\n");
+}  /* wl_usage */
+
+/*-----------------------------------------------------------------*/
+static void Bad_option(const char* name, const char* value) {
+   fprintf(stderr, "Opción de carga inválida: %s %s\n", name,
+         value == NULL ? "" : value);
+   wl_usage();
+   exit(0);
+}  /* Bad_option */
+
+/*-----------------------------------------------------------------*/
+static void Parse_phases(wl_config_t* cfg, const char* spec) {
+   const char* p = spec;
+   wl_phase_t* ph;
+   int used;
+
+   cfg->phase_count = 0;
+   while (*p != '\0') {
+      if (cfg->phase_count == WL_MAX_PHASES) Bad_option("phases", spec);
+      ph = &cfg->phases[cfg->phase_count];
+      if (sscanf(p, "%lf:%lf:%lf%n", &ph->weight, &ph->search,
+               &ph->insert, &used) != 3 || ph->weight <= 0 ||
+            ph->search < 0 || ph->insert < 0 ||
+            ph->search + ph->insert > 1.0)
+         Bad_option("phases", spec);
+      cfg->phase_count++;
+      p += used;
+      if (*p == ',') p++;
+      else if (*p != '\0') Bad_option("phases", spec);
+   }
+}  /* Parse_phases */
+
+/*-----------------------------------------------------------------*/
+static void Read_file(wl_config_t* cfg, const char* path);
+
+/*-----------------------------------------------------------------*/
+/* Función:    Set_option
+ * Propósito:  Aplicar una opción por nombre largo
+ */
+static void Set_option(wl_config_t* cfg, const char* name,
+      const char* value) {
+   int d;
+
+   if (value == NULL) Bad_option(name, value);
+   if (strcmp(name, "keys") == 0) {
+      cfg->inserts_in_main = strtol(value, NULL, 10);
+   } else if (strcmp(name, "ops") == 0) {
+      cfg->total_ops = strtol(value, NULL, 10);
+   } else if (strcmp(name, "search") == 0) {
+      opt_search = strtod(value, NULL);
+      if (opt_search < 0 || opt_search > 1) Bad_option(name, value);
+   } else if (strcmp(name, "insert") == 0) {
+      opt_insert = strtod(value, NULL);
+      if (opt_insert < 0 || opt_insert > 1) Bad_option(name, value);
+   } else if (strcmp(name, "dist") == 0) {
+      for (d = WL_UNIFORM; d <= WL_SEQUENTIAL; d++)
+         if (strcmp(value, dist_names[d]) == 0) break;
+      if (d > WL_SEQUENTIAL) Bad_option(name, value);
+      cfg->dist = (wl_dist_t) d;
+   } else if (strcmp(name, "theta") == 0) {
+      cfg->zipf_theta = strtod(value, NULL);
+      if (cfg->zipf_theta <= 0 || cfg->zipf_theta >= 1)
+         Bad_option(name, value);
+   } else if (strcmp(name, "hot") == 0) {
+      if (sscanf(value, "%lf,%lf", &cfg->hot_fraction,
+               &cfg->hot_probability) != 2 ||
+            cfg->hot_fraction <= 0 || cfg->hot_fraction >= 1 ||
+            cfg->hot_probability < 0 || cfg->hot_probability > 1)
+         Bad_option(name, value);
+   } else if (strcmp(name, "phases") == 0) {
+      Parse_phases(cfg, value);
+   } else if (strcmp(name, "affinity") == 0) {
+      if (!af_parse_policy(value, &cfg->affinity)) Bad_option(name, value);
+   } else if (strcmp(name, "file") == 0) {
+      Read_file(cfg, value);
+   } else {
+      Bad_option(name, value);
+   }
+}  /* Set_option */
+
+/*-----------------------------------------------------------------*/
+static void Read_file(wl_config_t* cfg, const char* path) {
+   char line[512], name[64], value[448];
+   char* hash;
+   FILE* fp = fopen(path, "r");
+
+   if (fp == NULL) {
+      fprintf(stderr, "No se puede abrir %s\n", path);
+      exit(0);
+   }
+   while (fgets(line, sizeof(line), fp) != NULL) {
+      if ((hash = strchr(line, '#')) != NULL) *hash = '\0';
+      if (sscanf(line, "%63s %447s", name, value) == 2)
+         Set_option(cfg, name, value);
+      else if (sscanf(line, "%63s", name) == 1)
+         Bad_option(name, NULL);
+   }
+   fclose(fp);
+}  /* Read_file */
+
+/*-----------------------------------------------------------------*/
+/* Función:     wl_parse_args
+ * Propósito:   Leer las opciones de carga de argv[first..argc-1]
+ * Val Retorno: 1 si había opciones, 0 si no (el programa debe pedir la
+ *              entrada de forma interactiva). Termina el programa si una
+ *              opción es inválida.
+ */
+int wl_parse_args(wl_config_t* cfg, int argc, char* argv[], int first) {
+   static const char letters[] = "kosidzHpaf";
+   static const char* names[] = { "keys", "ops", "search", "insert", "dist",
+      "theta", "hot", "phases", "affinity", "file" };
+   const char* l;
+   int a;
+
+   if (first >= argc) return 0;
+   opt_search = 0.8;
+   opt_insert = 0.1;
+   for (a = first; a < argc; a += 2) {
+      if (argv[a][0] != '-' || argv[a][1] == '\0' || argv[a][2] != '\0' ||
+            (l = strchr(letters, argv[a][1])) == NULL)
+         Bad_option(argv[a], NULL);
+      Set_option(cfg, names[l - letters], a+1 < argc ? argv[a+1] : NULL);
+   }
+   /* Las eliminaciones son el resto: search + insert no puede pasar de 1 */
+   if (opt_search + opt_insert > 1.0) {
+      fprintf(stderr, "Opción de carga inválida: -s %g -i %g suman más de 1\n",
+            opt_search, opt_insert);
+      wl_usage();
+      exit(0);
+   }
+   if (cfg->phase_count == 0)
+      wl_set_mix(cfg, opt_search, opt_insert);
+   else
+      wl_prepare(cfg);
+   return 1;
+}  /* wl_parse_args */
+
+/*-----------------------------------------------------------------*/
+/* Función:    wl_set_mix
+ * Propósito:  Usar una sola fase con la mezcla dada
+ */
+void wl_set_mix(wl_config_t* cfg, double search, double insert) {
+   cfg->phase_count = 1;
+   cfg->phases[0].weight = 1.0;
+   cfg->phases[0].search = search;
+   cfg->phases[0].insert = insert;
+   wl_prepare(cfg);
+}  /* wl_set_mix */
+
+/*-----------------------------------------------------------------*/
+static double Zeta(long n, double theta) {
+   long i, exact = n < ZETA_EXACT ? n : ZETA_EXACT;
+   double sum = 0.0;
+
+   for (i = 1; i <= exact; i++)
+      sum += pow((double) i, -theta);
+   if (n > exact)
+      sum += (pow(n + 0.5, 1.0 - theta) - pow(exact + 0.5, 1.0 - theta))
+            / (1.0 - theta);
+   return sum;
+}  /* Zeta */
+
+/*-----------------------------------------------------------------*/
+/* Función:    wl_prepare
+ * Propósito:  Calcular las constantes que dependen de la configuración
+ */
+void wl_prepare(wl_config_t* cfg) {
+   double n = cfg->max_key, theta = cfg->zipf_theta;
+
+   if (cfg->dist != WL_ZIPF) return;
+   cfg->zipf_zetan = Zeta(cfg->max_key, theta);
+   cfg->zipf_alpha = 1.0 / (1.0 - theta);
+   cfg->zipf_eta = (1.0 - pow(2.0/n, 1.0 - theta))
+         / (1.0 - Zeta(2, theta)/cfg->zipf_zetan);
+}  /* wl_prepare */
+
+/*-----------------------------------------------------------------*/
+void wl_print(const wl_config_t* cfg) {
+   int p;
+
+   printf("Carga: distribución %s", dist_names[cfg->dist]);
+   if (cfg->dist == WL_ZIPF)
+      printf(" (theta = %.3f)", cfg->zipf_theta);
+   else if (cfg->dist == WL_HOTSPOT)
+      printf(" (%.1f%% de las ops en %.1f%% de las keys)",
+            100*cfg->hot_probability, 100*cfg->hot_fraction);
+   printf(", %d fase(s)\n", cfg->phase_count);
+   for (p = 0; p < cfg->phase_count; p++)
+      printf("   fase %d: peso %.3f, %.1f%% búsquedas, %.1f%% inserciones, "
+            "%.1f%% eliminaciones\n", p, cfg->phases[p].weight,
+            100*cfg->phases[p].search, 100*cfg->phases[p].insert,
+            100*(1.0 - cfg->phases[p].search - cfg->phases[p].insert));
+}  /* wl_print */
+
+/*-----------------------------------------------------------------*/
+static void Set_phase_end(wl_thread_t* gen) {
+   const wl_config_t* cfg = gen->cfg;
+   double total = 0.0, upto = 0.0;
+   int p;
+
+   for (p = 0; p < cfg->phase_count; p++) {
+      total += cfg->phases[p].weight;
+      if (p <= gen->phase) upto += cfg->phases[p].weight;
+   }
+   gen->phase_end = (int) (gen->ops_total * upto / total);
+}  /* Set_phase_end */
+
+/*-----------------------------------------------------------------*/
+/* Función:    wl_thread_init
+ * Propósito:  Preparar el generador de un thread. Todos parten de
+ *             WL_SEED y el thread rank salta a su propio flujo.
+ */
+void wl_thread_init(wl_thread_t* gen, const wl_config_t* cfg, long rank,
+      int thread_count, int ops_total) {
+   rng_t r;
+
+   rng_thread_init(&r, WL_SEED, rank);
+   rng_bulk_init(&gen->rng, &r);
+   gen->rand_pos = WL_RNG_BATCH;
+   gen->cfg = cfg;
+   gen->ops_total = ops_total;
+   gen->ops_done = 0;
+   gen->phase = 0;
+   gen->next_seq = (unsigned long) rank * (cfg->max_key / thread_count);
+   Set_phase_end(gen);
+}  /* wl_thread_init */
+
+/*-----------------------------------------------------------------*/
+/* Siguiente valor de 64 bits; rellena el buffer cuando se agota */
+static inline uint64_t Next_u64(wl_thread_t* gen) {
+   if (gen->rand_pos == WL_RNG_BATCH) {
+      rng_fill_u64(&gen->rng, gen->rand_buf, WL_RNG_BATCH);
+      gen->rand_pos = 0;
+   }
+   return gen->rand_buf[gen->rand_pos++];
+}  /* Next_u64 */
+
+/*-----------------------------------------------------------------*/
+static inline double Next_double(wl_thread_t* gen) {
+   return (Next_u64(gen) >> 11) * 0x1.0p-53;
+}  /* Next_double */
+
+/*-----------------------------------------------------------------*/
+/* Entero en [0, bound), como rng_below */
+static inline long Next_below(wl_thread_t* gen, long bound) {
+   return (long) (((Next_u64(gen) >> 32) * (uint64_t) bound) >> 32);
+}  /* Next_below */
+
+/*-----------------------------------------------------------------*/
+static int Next_key(wl_thread_t* gen) {
+   const wl_config_t* cfg = gen->cfg;
+   double u, uz;
+   long rank, hot_keys;
+
+   switch (cfg->dist) {
+      case WL_ZIPF:
+         u = Next_double(gen);
+         uz = u * cfg->zipf_zetan;
+         if (uz < 1.0)
+            rank = 0;
+         else if (uz < 1.0 + pow(0.5, cfg->zipf_theta))
+            rank = 1;
+         else
+            rank = (long) (cfg->max_key *
+                  pow(cfg->zipf_eta*u - cfg->zipf_eta + 1.0, cfg->zipf_alpha));
+         if (rank >= cfg->max_key) rank = cfg->max_key - 1;
+         /* Dispersar las keys populares por toda la lista */
+         return (int) ((unsigned long long) rank * SCATTER % cfg->max_key);
+      case WL_HOTSPOT:
+         hot_keys = (long) (cfg->hot_fraction * cfg->max_key);
+         if (hot_keys < 1) hot_keys = 1;
+         if (Next_double(gen) < cfg->hot_probability)
+            return Next_below(gen, hot_keys);
+         return hot_keys + Next_below(gen, cfg->max_key - hot_keys);
+      case WL_SEQUENTIAL:
+         return (int) (gen->next_seq++ % cfg->max_key);
+      case WL_UNIFORM:
+      default:
+         return Next_below(gen, cfg->max_key);
+   }
+}  /* Next_key */
+
+/*-----------------------------------------------------------------*/
+/* Función:     wl_next
+ * Propósito:   Elegir la siguiente operación y su key
+ * Sal arg:     key_p
+ * Val Retorno: WL_MEMBER, WL_INSERT o WL_DELETE
+ */
+wl_op_t wl_next(wl_thread_t* gen, int* key_p) {
+   const wl_phase_t* ph;
+   double which_op;
+
+   while (gen->ops_done >= gen->phase_end &&
+         gen->phase < gen->cfg->phase_count - 1) {
+      gen->phase++;
+      Set_phase_end(gen);
+   }
+   ph = &gen->cfg->phases[gen->phase];
+   gen->ops_done++;
+
+   which_op = Next_double(gen);
+   *key_p = Next_key(gen);
+   if (which_op < ph->search)
+      return WL_MEMBER;
+   else if (which_op < ph->search + ph->insert)
+      return WL_INSERT;
+   else
+      return WL_DELETE;
+}  /* wl_next */
@@ -0,0 +1,88 @@
+/* Archivo:   workload.h
+ * Propósito: Archivo de cabecera para workload.c, que genera la secuencia de
+ *            operaciones de los programas de listas enlazadas: distribución
+ *            de las keys, mezcla de operaciones por fases y configuración
+ *            desde la línea de comandos o un archivo.
+ *
+ * Distribuciones de keys:
+ *    uniform   Uniforme en [0, max_key), igual que los programas originales
+ *    zipf      Zipf con parámetro theta en (0, 1); el rango i-ésimo más
+ *              popular se dispersa en [0, max_key) con un hash
+ *    hotspot   Con probabilidad hot_probability la key cae en el primer
+ *              hot_fraction del rango; si no, en el resto
+ *    seq       Cada thread recorre su propio tramo del rango en orden
+ *
+ * Fases: cada fase tiene un peso relativo y su propia mezcla de búsquedas
+ *        e inserciones (el resto son eliminaciones). Cada thread reparte sus
+ *        operaciones entre las fases en proporción a los pesos, así que
+ *        todas las fases avanzan a la vez en todos los threads.
+ *
+ * Números aleatorios: cada thread tiene su propio flujo de xoshiro256++
+ *        (rng.h) y lo consume de a WL_RNG_BATCH valores de 64 bits
+ *        generados con rng_fill_u64.
+ */
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+#include <stdint.h>
+#include "rng.h"
+#include "../comun/affinity.h"
+
+#define WL_MAX_PHASES 16
+#define WL_RNG_BATCH  256
+#define WL_SEED       1
+
+typedef enum { WL_UNIFORM, WL_ZIPF, WL_HOTSPOT, WL_SEQUENTIAL } wl_dist_t;
+typedef enum { WL_MEMBER, WL_INSERT, WL_DELETE } wl_op_t;
+
+typedef struct {
+   double weight;
+   double search;
+   double insert;
+} wl_phase_t;
+
+typedef struct {
+   int        inserts_in_main;
+   int        total_ops;
+   int        max_key;
+   wl_dist_t  dist;
+   double     zipf_theta;
+   double     hot_fraction;
+   double     hot_probability;
+   int        phase_count;
+   wl_phase_t phases[WL_MAX_PHASES];
+   af_policy_t affinity;     /* Política de afinidad de los threads (-a) */
+   /* Constantes de Zipf calculadas por wl_prepare */
+   double     zipf_zetan, zipf_alpha, zipf_eta;
+} wl_config_t;
+
+/* Operaciones que hizo un thread. Cada thread escribe las suyas una sola
+ * vez, al terminar, y main las suma: no hace falta relleno */
+typedef struct {
+   int member, insert, delete;
+} wl_counts_t;
+
+/* Estado privado de cada thread */
+typedef struct {
+   rng_bulk_t rng;
+   uint64_t rand_buf[WL_RNG_BATCH];
+   int      rand_pos;
+   const wl_config_t* cfg;
+   int      ops_total;
+   int      ops_done;
+   int      phase;
+   int      phase_end;
+   unsigned long next_seq;
+} wl_thread_t;
+
+void    wl_init(wl_config_t* cfg, int max_key);
+int     wl_parse_args(wl_config_t* cfg, int argc, char* argv[], int first);
+void    wl_set_mix(wl_config_t* cfg, double search, double insert);
+void    wl_prepare(wl_config_t* cfg);
+void    wl_print(const wl_config_t* cfg);
+void    wl_usage(void);
+void    wl_thread_init(wl_thread_t* gen, const wl_config_t* cfg,
+              long rank, int thread_count, int ops_total);
+wl_op_t wl_next(wl_thread_t* gen, int* key_p);
+
+#endif
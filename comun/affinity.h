@@ -0,0 +1,345 @@
+/* Archivo:   affinity.h
+ * Propósito: Fijar cada thread a una CPU o a un nodo NUMA según una
+ *            política, para que el sistema operativo no los migre en medio
+ *            de una medición, y ubicar memoria en un nodo o repartida entre
+ *            todos. Sirve desde C y desde C++; todo es inline.
+ *
+ *            none      No se fija nada (el comportamiento de siempre)
+ *            compact   Threads consecutivos en CPUs vecinas: primero los
+ *                      hyperthreads de un núcleo, después los núcleos de
+ *                      un nodo y después el nodo siguiente
+ *            scatter   Threads consecutivos lo más lejos posible: un
+ *                      thread por nodo, después un núcleo por nodo y los
+ *                      hyperthreads al final
+ *            node      El thread r puede usar cualquier CPU del nodo
+ *                      r % nodos; el sistema operativo lo mueve solo
+ *                      dentro de su nodo
+ *
+ * Ejemplo:
+ *    #include "../comun/affinity.h"
+ *    . . .
+ *    af_placement_t placement;
+ *    af_policy_t policy;
+ *    if (!af_parse_policy(argv[k], &policy)) Usage(argv[0]);
+ *    af_init(&placement, policy, thread_count);
+ *    af_report(&placement, stdout);
+ *    . . .   en cada thread:
+ *       af_bind(&placement, my_rank);
+ *
+ * Notas:
+ *    1. La topología se lee de /sys/devices/system/node y
+ *       /sys/devices/system/cpu; solo se usan las CPUs permitidas al
+ *       proceso (taskset, cgroups). Sin /sys/devices/system/node se supone
+ *       un solo nodo.
+ *    2. Si hay más threads que CPUs, el thread r usa la misma CPU que el
+ *       r % CPUs.
+ *    3. Se usan directamente las llamadas al sistema sched_setaffinity y
+ *       mbind, así que no hace falta _GNU_SOURCE ni enlazar con libnuma.
+ *       sched_setaffinity(0, ...) afecta solo al thread que llama, como
+ *       pthread_setaffinity_np(pthread_self(), ...).
+ *    4. Linux ubica cada página en el nodo del thread que la escribe por
+ *       primera vez (first touch). Para que una política sirva, los datos
+ *       de cada thread los tiene que inicializar ese thread, después de
+ *       af_bind; af_membind y af_interleave imponen el nodo a una región
+ *       antes de tocarla.
+ */
+#ifndef _AFFINITY_H_
+#define _AFFINITY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define AF_MAX_CPUS    1024
+#define AF_MAX_NODES   64
+#define AF_MASK_WORDS  (AF_MAX_CPUS/(8*sizeof(unsigned long)))
+
+#define AF_MPOL_PREFERRED  1
+#define AF_MPOL_BIND       2
+#define AF_MPOL_INTERLEAVE 3
+#define AF_MPOL_LOCAL      4
+
+typedef enum { AF_NONE, AF_COMPACT, AF_SCATTER, AF_NODE, AF_POLICIES }
+   af_policy_t;
+
+typedef struct {
+   af_policy_t policy;
+   int thread_count;
+   int cpu_count;
+   int node_count;
+   int order[AF_MAX_CPUS];     /* CPU del thread r: order[r % cpu_count] */
+   int cpu_node[AF_MAX_CPUS];  /* Nodo de cada CPU, por número de CPU */
+   int nodes[AF_MAX_NODES];    /* Nodos con CPUs permitidas */
+} af_placement_t;
+
+/* Una CPU mientras se calcula el orden */
+typedef struct {
+   int cpu, node, package, core, smt, core_index;
+} af_cpu_t;
+
+/*-----------------------------------------------------------------*/
+static inline const char* af_policy_name(af_policy_t policy) {
+   static const char* names[AF_POLICIES] = { "none", "compact", "scatter",
+      "node" };
+   return names[policy];
+}  /* af_policy_name */
+
+/*-----------------------------------------------------------------*/
+/* Val Retorno: 1 si name es una política, 0 si no */
+static inline int af_parse_policy(const char* name, af_policy_t* policy_p) {
+   int p;
+
+   for (p = 0; p < AF_POLICIES; p++)
+      if (strcmp(name, af_policy_name((af_policy_t) p)) == 0) {
+         *policy_p = (af_policy_t) p;
+         return 1;
+      }
+   return 0;
+}  /* af_parse_policy */
+
+/*-----------------------------------------------------------------*/
+/* Leer un entero de un archivo de /sys, o def si no existe */
+static inline int af_read_int(const char* path, int def) {
+   FILE* fp = fopen(path, "r");
+   int value = def;
+
+   if (fp == NULL) return def;
+   if (fscanf(fp, "%d", &value) != 1) value = def;
+   fclose(fp);
+   return value;
+}  /* af_read_int */
+
+/*-----------------------------------------------------------------*/
+/* Marcar en node_of[] las CPUs de una lista como "0-3,8-11"
+ * Val Retorno: 1 si se pudo leer el archivo */
+static inline int af_read_cpulist(const char* path, int node, int node_of[]) {
+   FILE* fp = fopen(path, "r");
+   int first, last, cpu, c;
+
+   if (fp == NULL) return 0;
+   while (fscanf(fp, "%d", &first) == 1) {
+      last = first;
+      if ((c = fgetc(fp)) == '-') {
+         if (fscanf(fp, "%d", &last) != 1) break;
+         c = fgetc(fp);
+      }
+      for (cpu = first; cpu <= last && cpu < AF_MAX_CPUS; cpu++)
+         node_of[cpu] = node;
+      if (c != ',') break;
+   }
+   fclose(fp);
+   return 1;
+}  /* af_read_cpulist */
+
+/*-----------------------------------------------------------------*/
+static inline int af_compact_before(const af_cpu_t* a, const af_cpu_t* b) {
+   if (a->node != b->node) return a->node < b->node;
+   if (a->package != b->package) return a->package < b->package;
+   if (a->core != b->core) return a->core < b->core;
+   return a->cpu < b->cpu;
+}  /* af_compact_before */
+
+/*-----------------------------------------------------------------*/
+static inline int af_scatter_before(const af_cpu_t* a, const af_cpu_t* b) {
+   if (a->smt != b->smt) return a->smt < b->smt;
+   if (a->core_index != b->core_index) return a->core_index < b->core_index;
+   if (a->node != b->node) return a->node < b->node;
+   return a->cpu < b->cpu;
+}  /* af_scatter_before */
+
+/*-----------------------------------------------------------------*/
+/* Ordenar por inserción: pocas CPUs y se hace una sola vez */
+static inline void af_sort(af_cpu_t cpus[], int n,
+      int (*before)(const af_cpu_t*, const af_cpu_t*)) {
+   af_cpu_t tmp;
+   int i, j;
+
+   for (i = 1; i < n; i++) {
+      tmp = cpus[i];
+      for (j = i; j > 0 && before(&tmp, &cpus[j-1]); j--)
+         cpus[j] = cpus[j-1];
+      cpus[j] = tmp;
+   }
+}  /* af_sort */
+
+/*-----------------------------------------------------------------*/
+/* Función:    af_init
+ * Propósito:  Leer la topología y calcular qué CPU o nodo le toca a
+ *             cada uno de thread_count threads con la política dada
+ */
+static inline void af_init(af_placement_t* pl, af_policy_t policy,
+      int thread_count) {
+   static af_cpu_t cpus[AF_MAX_CPUS];
+   unsigned long allowed[AF_MASK_WORDS];
+   int node_of[AF_MAX_CPUS];
+   char path[128];
+   int cpu, node, n = 0, i, j, have_nodes = 0;
+
+   pl->policy = policy;
+   pl->thread_count = thread_count;
+   pl->node_count = 0;
+
+   memset(allowed, 0, sizeof(allowed));
+   if (syscall(SYS_sched_getaffinity, 0, sizeof(allowed), allowed) <= 0) {
+      memset(allowed, 0, sizeof(allowed));
+      allowed[0] = 1;
+   }
+
+   for (cpu = 0; cpu < AF_MAX_CPUS; cpu++) node_of[cpu] = 0;
+   for (node = 0; node < AF_MAX_NODES; node++) {
+      sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+      have_nodes |= af_read_cpulist(path, node, node_of);
+   }
+
+   for (cpu = 0; cpu < AF_MAX_CPUS; cpu++) {
+      if (!(allowed[cpu/(8*sizeof(unsigned long))]
+               & (1UL << (cpu % (8*sizeof(unsigned long))))))
+         continue;
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+      cpus[n].core = af_read_int(path, cpu);
+      sprintf(path,
+            "/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+            cpu);
+      cpus[n].package = af_read_int(path, 0);
+      cpus[n].cpu = cpu;
+      cpus[n].node = have_nodes ? node_of[cpu] : 0;
+      n++;
+   }
+   pl->cpu_count = n;
+
+   /* Orden compacto; de ahí salen el hyperthread dentro del núcleo, el
+    * número de núcleo dentro del nodo y la lista de nodos */
+   af_sort(cpus, n, af_compact_before);
+   for (i = 0; i < n; i++) {
+      cpus[i].smt = 0;
+      cpus[i].core_index = 0;
+      if (i > 0 && cpus[i].node == cpus[i-1].node) {
+         j = i - 1;
+         if (cpus[i].package == cpus[j].package
+               && cpus[i].core == cpus[j].core) {
+            cpus[i].smt = cpus[j].smt + 1;
+            cpus[i].core_index = cpus[j].core_index;
+         } else {
+            cpus[i].core_index = cpus[j].core_index + 1;
+         }
+      }
+      if (i == 0 || cpus[i].node != cpus[i-1].node)
+         if (pl->node_count < AF_MAX_NODES)
+            pl->nodes[pl->node_count++] = cpus[i].node;
+      pl->cpu_node[cpus[i].cpu] = cpus[i].node;
+   }
+   if (policy == AF_SCATTER) af_sort(cpus, n, af_scatter_before);
+   for (i = 0; i < n; i++) pl->order[i] = cpus[i].cpu;
+}  /* af_init */
+
+/*-----------------------------------------------------------------*/
+/* CPU que le toca al thread rank con compact o scatter */
+static inline int af_cpu_of(const af_placement_t* pl, long rank) {
+   return pl->order[rank % pl->cpu_count];
+}  /* af_cpu_of */
+
+/*-----------------------------------------------------------------*/
+/* Nodo NUMA en que corre el thread rank, o -1 con none */
+static inline int af_node_of(const af_placement_t* pl, long rank) {
+   switch (pl->policy) {
+      case AF_COMPACT:
+      case AF_SCATTER:
+         return pl->cpu_node[af_cpu_of(pl, rank)];
+      case AF_NODE:
+         return pl->nodes[rank % pl->node_count];
+      default:
+         return -1;
+   }
+}  /* af_node_of */
+
+/*-----------------------------------------------------------------*/
+/* Función:     af_bind
+ * Propósito:   Fijar el thread que llama según la política, como el
+ *              thread rank
+ * Val Retorno: 0 si se fijó, -1 con none o si el sistema no lo permitió
+ */
+static inline int af_bind(const af_placement_t* pl, long rank) {
+   unsigned long mask[AF_MASK_WORDS];
+   const int bits = 8*sizeof(unsigned long);
+   int i, cpu, node;
+
+   if (pl == NULL || pl->policy == AF_NONE) return -1;
+   memset(mask, 0, sizeof(mask));
+   if (pl->policy == AF_NODE) {
+      node = af_node_of(pl, rank);
+      for (i = 0; i < pl->cpu_count; i++) {
+         cpu = pl->order[i];
+         if (pl->cpu_node[cpu] == node)
+            mask[cpu/bits] |= 1UL << (cpu % bits);
+      }
+   } else {
+      cpu = af_cpu_of(pl, rank);
+      mask[cpu/bits] |= 1UL << (cpu % bits);
+   }
+   return syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0
+         ? 0 : -1;
+}  /* af_bind */
+
+/*-----------------------------------------------------------------*/
+/* Llamar a mbind con los nodos de node_mask */
+static inline int af_mbind(void* addr, size_t len, int mode,
+      unsigned long node_mask) {
+   unsigned long mask[1];
+   long page = sysconf(_SC_PAGESIZE);
+   char* start = (char*) ((unsigned long) addr & ~(page - 1));
+
+   mask[0] = node_mask;
+   return syscall(SYS_mbind, start, len + ((char*) addr - start), mode,
+         mask, 8*sizeof(mask) + 1, 0) == 0 ? 0 : -1;
+}  /* af_mbind */
+
+/*-----------------------------------------------------------------*/
+/* Ubicar las páginas de [addr, addr+len) en node. Hay que llamarla antes
+ * de tocarlas. Val Retorno: 0 si se pudo */
+static inline int af_membind(void* addr, size_t len, int node) {
+   if (node < 0 || node >= (int) (8*sizeof(unsigned long))) return -1;
+   return af_mbind(addr, len, AF_MPOL_BIND, 1UL << node);
+}  /* af_membind */
+
+/*-----------------------------------------------------------------*/
+/* Repartir las páginas de [addr, addr+len) entre los nodos de pl, de a
+ * una. Val Retorno: 0 si se pudo */
+static inline int af_interleave(const af_placement_t* pl, void* addr,
+      size_t len) {
+   unsigned long node_mask = 0;
+   int i;
+
+   for (i = 0; i < pl->node_count; i++)
+      if (pl->nodes[i] < (int) (8*sizeof(unsigned long)))
+         node_mask |= 1UL << pl->nodes[i];
+   return af_mbind(addr, len, AF_MPOL_INTERLEAVE, node_mask);
+}  /* af_interleave */
+
+/*-----------------------------------------------------------------*/
+/* Imprimir la política y dónde queda cada thread */
+static inline void af_report(const af_placement_t* pl, FILE* fp) {
+   long rank;
+
+   fprintf(fp, "Afinidad: %s, %d CPU(s) en %d nodo(s) NUMA",
+         af_policy_name(pl->policy), pl->cpu_count, pl->node_count);
+   if (pl->policy == AF_NONE) {
+      fprintf(fp, "\n");
+      return;
+   }
+   fprintf(fp, "; thread->%s:", pl->policy == AF_NODE ? "nodo" : "CPU");
+   for (rank = 0; rank < pl->thread_count; rank++) {
+      if (rank == 16) {
+         fprintf(fp, " ...");
+         break;
+      }
+      if (pl->policy == AF_NODE)
+         fprintf(fp, " %ld->%d", rank, af_node_of(pl, rank));
+      else
+         fprintf(fp, " %ld->%d", rank, af_cpu_of(pl, rank));
+   }
+   fprintf(fp, "\n");
+}  /* af_report */
+
+#endif
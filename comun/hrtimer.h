@@ -0,0 +1,274 @@
+/* Archivo:   hrtimer.h
+ * Propósito: Medir tiempos con el mismo reloj que GET_TIME de timer.h
+ *            (CLOCK_MONOTONIC_RAW), pero en nanosegundos enteros, con el
+ *            contador de ciclos para regiones cortas y con contadores con
+ *            nombre. Sirve desde C y desde C++; todo es inline, no hay que
+ *            enlazar nada.
+ *
+ *            hr_now, hr_now_ns    CLOCK_MONOTONIC_RAW: no retrocede ni lo
+ *                                 ajusta NTP
+ *            hr_start, hr_stop    Contador de ciclos (TSC) con barreras de
+ *                                 serialización, para regiones de cientos
+ *                                 de ciclos. hr_ticks_to_ns convierte con
+ *                                 una frecuencia calibrada una sola vez.
+ *            HR_SCOPE(nombre)     Mide desde la declaración hasta el final
+ *                                 del bloque y lo acumula en el contador
+ *                                 nombre. hr_report imprime todos.
+ *
+ * Ejemplo:
+ *    #include "../comun/hrtimer.h"
+ *    . . .
+ *    void block_multiplication(...) {
+ *       HR_SCOPE("block_multiplication");
+ *       . . .
+ *    }
+ *    . . .
+ *    hr_report(stdout);
+ *
+ * Notas:
+ *    1. Si el procesador no tiene TSC invariante (o no es x86), hr_start y
+ *       hr_stop devuelven nanosegundos de CLOCK_MONOTONIC_RAW, así que el
+ *       resto funciona igual con menos resolución.
+ *    2. Los contadores se suman con operaciones atómicas: HR_SCOPE se
+ *       puede usar dentro de funciones que ejecutan varios threads.
+ *    3. La tabla de contadores (HR_MAX_COUNTERS), su lock y la calibración
+ *       se definen aquí como símbolos weak: cada archivo fuente que incluye
+ *       hrtimer.h emite una copia y el enlazador se queda con una sola. Así
+ *       todo el programa comparte los contadores, hr_report imprime los de
+ *       todos los archivos y el TSC se calibra una sola vez.
+ *    4. En C, HR_SCOPE usa __attribute__((cleanup)) de gcc/clang; en C++,
+ *       un objeto que mide en su destructor.
+ */
+#ifndef _HRTIMER_H_
+#define _HRTIMER_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#define HR_MAX_COUNTERS    64
+#define HR_CALIBRATION_NS  20000000LL
+
+typedef struct {
+   const char* name;
+   unsigned long long ticks;
+   unsigned long long calls;
+} hr_counter_t;
+
+/* Compartidos por todo el programa (ver nota 3) */
+#ifdef __cplusplus
+extern "C" {
+#endif
+hr_counter_t hr_counters[HR_MAX_COUNTERS] __attribute__((weak));
+int hr_counter_count __attribute__((weak)) = 0;
+int hr_counter_lock __attribute__((weak)) = 0;
+double hr_ns_per_tick_cache __attribute__((weak)) = 0.0;
+#ifdef __cplusplus
+}
+#endif
+
+/*-----------------------------------------------------------------*/
+/* Nanosegundos de CLOCK_MONOTONIC_RAW */
+static inline long long hr_now_ns(void) {
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+   return t.tv_sec*1000000000LL + t.tv_nsec;
+}  /* hr_now_ns */
+
+/*-----------------------------------------------------------------*/
+/* Segundos, como GET_TIME */
+static inline double hr_now(void) {
+   return 1.0e-9*hr_now_ns();
+}  /* hr_now */
+
+/*-----------------------------------------------------------------*/
+/* 1 si el TSC avanza a frecuencia constante (CPUID 0x80000007, EDX 8) */
+static inline int hr_tsc_invariant(void) {
+#  if defined(__x86_64__) || defined(__i386__)
+   unsigned a, b, c, d;
+
+   if (!__get_cpuid(0x80000007, &a, &b, &c, &d)) return 0;
+   return (d >> 8) & 1;
+#  else
+   return 0;
+#  endif
+}  /* hr_tsc_invariant */
+
+#if defined(__x86_64__) || defined(__i386__)
+/*-----------------------------------------------------------------*/
+/* Leer el TSC sin que nada de lo anterior ni de lo siguiente se cruce */
+static inline unsigned long long hr_tsc_begin(void) {
+   unsigned long long t;
+
+   _mm_lfence();
+   t = __rdtsc();
+   _mm_lfence();
+   return t;
+}  /* hr_tsc_begin */
+
+/*-----------------------------------------------------------------*/
+/* rdtscp espera a que termine todo lo anterior */
+static inline unsigned long long hr_tsc_end(void) {
+   unsigned long long t;
+   unsigned aux;
+
+   t = __rdtscp(&aux);
+   _mm_lfence();
+   return t;
+}  /* hr_tsc_end */
+#endif
+
+/*-----------------------------------------------------------------*/
+/* Función:     hr_ns_per_tick
+ * Propósito:   Calibrar el TSC contra CLOCK_MONOTONIC_RAW la primera vez
+ * Val Retorno: Nanosegundos por tick de hr_start/hr_stop
+ */
+static inline double hr_ns_per_tick(void) {
+   if (hr_ns_per_tick_cache > 0.0) return hr_ns_per_tick_cache;
+   if (hr_ns_per_tick_cache < 0.0) return 1.0;
+#  if defined(__x86_64__) || defined(__i386__)
+   if (hr_tsc_invariant()) {
+      long long t0, t1;
+      unsigned long long c0, c1;
+
+      t0 = hr_now_ns();
+      c0 = hr_tsc_begin();
+      do {
+         t1 = hr_now_ns();
+      } while (t1 - t0 < HR_CALIBRATION_NS);
+      c1 = hr_tsc_end();
+      hr_ns_per_tick_cache = (double) (t1 - t0)/(c1 - c0);
+      return hr_ns_per_tick_cache;
+   }
+#  endif
+   hr_ns_per_tick_cache = -1.0;   /* Sin TSC: los ticks son ns */
+   return 1.0;
+}  /* hr_ns_per_tick */
+
+/*-----------------------------------------------------------------*/
+/* Principio de una región. La primera vez calibra, antes de medir. */
+static inline unsigned long long hr_start(void) {
+   if (hr_ns_per_tick_cache == 0.0) hr_ns_per_tick();
+#  if defined(__x86_64__) || defined(__i386__)
+   if (hr_ns_per_tick_cache > 0.0) return hr_tsc_begin();
+#  endif
+   return hr_now_ns();
+}  /* hr_start */
+
+/*-----------------------------------------------------------------*/
+/* Final de una región empezada con hr_start */
+static inline unsigned long long hr_stop(void) {
+#  if defined(__x86_64__) || defined(__i386__)
+   if (hr_ns_per_tick_cache > 0.0) return hr_tsc_end();
+#  endif
+   return hr_now_ns();
+}  /* hr_stop */
+
+/*-----------------------------------------------------------------*/
+static inline double hr_ticks_to_ns(unsigned long long ticks) {
+   return ticks*hr_ns_per_tick();
+}  /* hr_ticks_to_ns */
+
+/*-----------------------------------------------------------------*/
+/* Función:     hr_counter
+ * Propósito:   Buscar el contador name o crearlo si no existe. También
+ *              calibra el TSC, así la calibración no cae dentro de una
+ *              región medida.
+ * Val Retorno: El contador, o NULL si ya hay HR_MAX_COUNTERS
+ */
+static inline hr_counter_t* hr_counter(const char* name) {
+   hr_counter_t* c = NULL;
+   int i;
+
+   hr_ns_per_tick();
+   while (__atomic_exchange_n(&hr_counter_lock, 1, __ATOMIC_ACQUIRE))
+      ;
+   for (i = 0; i < hr_counter_count; i++)
+      if (strcmp(hr_counters[i].name, name) == 0) {
+         c = &hr_counters[i];
+         break;
+      }
+   if (c == NULL && hr_counter_count < HR_MAX_COUNTERS) {
+      c = &hr_counters[hr_counter_count++];
+      c->name = name;
+   }
+   __atomic_store_n(&hr_counter_lock, 0, __ATOMIC_RELEASE);
+   return c;
+}  /* hr_counter */
+
+/*-----------------------------------------------------------------*/
+static inline void hr_counter_add(hr_counter_t* c, unsigned long long ticks) {
+   if (c == NULL) return;
+   __atomic_fetch_add(&c->ticks, ticks, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&c->calls, 1, __ATOMIC_RELAXED);
+}  /* hr_counter_add */
+
+/*-----------------------------------------------------------------*/
+/* Imprimir cada contador: llamadas, tiempo total y tiempo por llamada */
+static inline void hr_report(FILE* fp) {
+   int i;
+   double ns;
+
+   if (hr_counter_count == 0) return;
+   fprintf(fp, "%-28s %12s %14s %14s\n", "contador", "llamadas", "total (ms)",
+         "ns/llamada");
+   for (i = 0; i < hr_counter_count; i++) {
+      ns = hr_ticks_to_ns(hr_counters[i].ticks);
+      fprintf(fp, "%-28s %12llu %14.3f %14.1f\n", hr_counters[i].name,
+            hr_counters[i].calls, 1.0e-6*ns,
+            hr_counters[i].calls ? ns/hr_counters[i].calls : 0.0);
+   }
+}  /* hr_report */
+
+/*-----------------------------------------------------------------*/
+/* HR_SCOPE: el contador se busca una sola vez por lugar del código */
+#define HR_CAT2(a, b) a##b
+#define HR_CAT(a, b)  HR_CAT2(a, b)
+
+#ifdef __cplusplus
+class hr_scope {
+public:
+    explicit hr_scope(hr_counter_t* c) : counter(c), t0(hr_start()) {}
+    ~hr_scope() { hr_counter_add(counter, hr_stop() - t0); }
+    hr_scope(const hr_scope&) = delete;
+    hr_scope& operator=(const hr_scope&) = delete;
+private:
+    hr_counter_t* counter;
+    unsigned long long t0;
+};
+
+#define HR_SCOPE(name) \
+    static hr_counter_t* const HR_CAT(hr_c_, __LINE__) = hr_counter(name); \
+    hr_scope HR_CAT(hr_s_, __LINE__)(HR_CAT(hr_c_, __LINE__))
+#else
+typedef struct {
+   hr_counter_t* counter;
+   unsigned long long t0;
+} hr_scope_t;
+
+static inline void hr_scope_end(hr_scope_t* s) {
+   hr_counter_add(s->counter, hr_stop() - s->t0);
+}  /* hr_scope_end */
+
+static inline hr_counter_t* hr_counter_once(hr_counter_t** c_p,
+      const char* name) {
+   hr_counter_t* c = __atomic_load_n(c_p, __ATOMIC_ACQUIRE);
+
+   if (c == NULL) {
+      c = hr_counter(name);
+      __atomic_store_n(c_p, c, __ATOMIC_RELEASE);
+   }
+   return c;
+}  /* hr_counter_once */
+
+#define HR_SCOPE(name) \
+   static hr_counter_t* HR_CAT(hr_c_, __LINE__) = NULL; \
+   hr_scope_t HR_CAT(hr_s_, __LINE__) __attribute__((cleanup(hr_scope_end))) \
+      = { hr_counter_once(&HR_CAT(hr_c_, __LINE__), name), hr_start() }
+#endif
+
+#endif
@@ -0,0 +1,232 @@
+/* Archivo:   matalloc.h
+ * Propósito: Reservar la memoria de matrices grandes eligiendo el tamaño de
+ *            página y el nodo NUMA. Con páginas de 4 KB, una matriz de
+ *            8192 x 8192 doubles (512 MB) ocupa 131072 páginas y el
+ *            recorrido de B por columnas falla en el TLB en casi cada
+ *            acceso; con páginas de 2 MB son 256. Sirve desde C y desde
+ *            C++; todo es inline.
+ *
+ *            4k    mmap con MADV_NOHUGEPAGE: páginas de 4 KB aunque el
+ *                  sistema tenga transparent huge pages en "always"
+ *            thp   mmap alineado a 2 MB con MADV_HUGEPAGE: el kernel usa
+ *                  páginas de 2 MB cuando puede (transparent huge pages)
+ *            2m    mmap con MAP_HUGETLB de 2 MB: páginas reservadas en
+ *                  /proc/sys/vm/nr_hugepages
+ *            1g    mmap con MAP_HUGETLB de 1 GB: páginas reservadas al
+ *                  arrancar (hugepagesz=1G hugepages=N)
+ *
+ *            NUMA: none (first touch), local (el nodo del thread que toca
+ *            cada página) o interleave (las páginas repartidas de a una
+ *            entre todos los nodos, ver affinity.h).
+ *
+ * Ejemplo:
+ *    #include "../comun/matalloc.h"
+ *    . . .
+ *    ma_block_t block;
+ *    double* a = (double*) ma_alloc(&block, n*n*sizeof(double), MA_THP,
+ *          MA_NUMA_NONE);
+ *    . . .
+ *    ma_report(&block, "A", stdout);
+ *    ma_free(&block);
+ *
+ * Notas:
+ *    1. Si no hay páginas 2m o 1g reservadas, ma_alloc avisa una sola vez
+ *       por stderr y usa thp; block.pages dice qué se usó.
+ *    2. ma_huge_bytes lee /proc/self/smaps para saber cuánto de la región
+ *       quedó realmente en páginas grandes (AnonHugePages para thp,
+ *       Private_Hugetlb para 2m y 1g). Con thp solo se sabe después de
+ *       tocar la memoria. smaps cuenta por región del kernel, y el kernel
+ *       puede juntar dos reservas vecinas en una: el valor se limita a
+ *       block.mapped, pero puede incluir páginas de la vecina.
+ *    3. La memoria de mmap empieza en cero y ninguna página se ubica hasta
+ *       que se escribe (first touch), así que la política NUMA se aplica
+ *       antes de devolver el puntero.
+ */
+#ifndef _MATALLOC_H_
+#define _MATALLOC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "affinity.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#define MA_2M_SIZE (2UL << 20)
+#define MA_1G_SIZE (1UL << 30)
+
+typedef enum { MA_4K, MA_THP, MA_2M, MA_1G, MA_PAGE_KINDS } ma_pages_t;
+typedef enum { MA_NUMA_NONE, MA_NUMA_LOCAL, MA_NUMA_INTERLEAVE,
+   MA_NUMA_KINDS } ma_numa_t;
+
+typedef struct {
+   void* ptr;
+   size_t bytes;            /* Pedidos */
+   size_t mapped;           /* Reservados, múltiplo de la página */
+   ma_pages_t requested;
+   ma_pages_t pages;        /* Lo que se usó */
+   ma_numa_t numa;
+} ma_block_t;
+
+static int ma_warned __attribute__((unused)) = 0;
+
+/*-----------------------------------------------------------------*/
+static inline const char* ma_pages_name(ma_pages_t pages) {
+   static const char* names[MA_PAGE_KINDS] = { "4k", "thp", "2m", "1g" };
+   return names[pages];
+}  /* ma_pages_name */
+
+/*-----------------------------------------------------------------*/
+static inline const char* ma_numa_name(ma_numa_t numa) {
+   static const char* names[MA_NUMA_KINDS] = { "none", "local",
+      "interleave" };
+   return names[numa];
+}  /* ma_numa_name */
+
+/*-----------------------------------------------------------------*/
+/* Val Retorno: 1 si name es un tipo de página, 0 si no */
+static inline int ma_parse_pages(const char* name, ma_pages_t* pages_p) {
+   int p;
+
+   for (p = 0; p < MA_PAGE_KINDS; p++)
+      if (strcmp(name, ma_pages_name((ma_pages_t) p)) == 0) {
+         *pages_p = (ma_pages_t) p;
+         return 1;
+      }
+   return 0;
+}  /* ma_parse_pages */
+
+/*-----------------------------------------------------------------*/
+static inline int ma_parse_numa(const char* name, ma_numa_t* numa_p) {
+   int p;
+
+   for (p = 0; p < MA_NUMA_KINDS; p++)
+      if (strcmp(name, ma_numa_name((ma_numa_t) p)) == 0) {
+         *numa_p = (ma_numa_t) p;
+         return 1;
+      }
+   return 0;
+}  /* ma_parse_numa */
+
+/*-----------------------------------------------------------------*/
+/* Región de bytes alineada a align con mmap, o NULL */
+static inline void* ma_map_aligned(size_t bytes, size_t align) {
+   char *p, *start;
+
+   p = (char*) mmap(NULL, bytes + align, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (p == MAP_FAILED) return NULL;
+   start = (char*) (((unsigned long) p + align - 1) & ~(align - 1));
+   if (start > p) munmap(p, start - p);
+   munmap(start + bytes, (p + bytes + align) - (start + bytes));
+   return start;
+}  /* ma_map_aligned */
+
+/*-----------------------------------------------------------------*/
+/* Función:     ma_alloc
+ * Propósito:   Reservar bytes con el tipo de página y la política NUMA
+ *              pedidos
+ * Val Retorno: El puntero (también en block->ptr); termina el programa
+ *              si no hay memoria
+ */
+static inline void* ma_alloc(ma_block_t* block, size_t bytes,
+      ma_pages_t pages, ma_numa_t numa) {
+   af_placement_t* pl;
+   size_t page = pages == MA_1G ? MA_1G_SIZE
+               : pages == MA_4K ? (size_t) sysconf(_SC_PAGESIZE) : MA_2M_SIZE;
+   void* p = NULL;
+   int huge_flag;
+
+   if (bytes == 0) bytes = 1;
+   block->bytes = bytes;
+   block->requested = pages;
+   block->numa = numa;
+   block->mapped = (bytes + page - 1) & ~(page - 1);
+
+   if (pages == MA_2M || pages == MA_1G) {
+      huge_flag = (pages == MA_2M ? 21 : 30) << MAP_HUGE_SHIFT;
+      p = mmap(NULL, block->mapped, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag, -1, 0);
+      if (p == MAP_FAILED) {
+         p = NULL;
+         if (!ma_warned) {
+            fprintf(stderr, "matalloc: no hay páginas de %s reservadas; "
+                  "se usa thp (ver /proc/sys/vm/nr_hugepages)\n",
+                  ma_pages_name(pages));
+            ma_warned = 1;
+         }
+         pages = MA_THP;
+         block->mapped = (bytes + MA_2M_SIZE - 1) & ~(MA_2M_SIZE - 1);
+      }
+   }
+   if (p == NULL) {
+      p = ma_map_aligned(block->mapped, pages == MA_THP ? MA_2M_SIZE
+            : (size_t) sysconf(_SC_PAGESIZE));
+      if (p == NULL) {
+         fprintf(stderr, "La memoria falló.\n");
+         exit(1);
+      }
+      madvise(p, block->mapped, pages == MA_THP ? MADV_HUGEPAGE
+            : MADV_NOHUGEPAGE);
+   }
+   block->ptr = p;
+   block->pages = pages;
+
+   if (numa == MA_NUMA_LOCAL) {
+      af_mbind(p, block->mapped, AF_MPOL_LOCAL, 0);
+   } else if (numa == MA_NUMA_INTERLEAVE) {
+      pl = (af_placement_t*) malloc(sizeof(af_placement_t));
+      if (pl != NULL) {
+         af_init(pl, AF_NONE, 1);
+         af_interleave(pl, p, block->mapped);
+         free(pl);
+      }
+   }
+   return p;
+}  /* ma_alloc */
+
+/*-----------------------------------------------------------------*/
+static inline void ma_free(ma_block_t* block) {
+   if (block->ptr != NULL) munmap(block->ptr, block->mapped);
+   block->ptr = NULL;
+}  /* ma_free */
+
+/*-----------------------------------------------------------------*/
+/* Bytes de la región que están en páginas grandes, según smaps */
+static inline size_t ma_huge_bytes(const ma_block_t* block) {
+   unsigned long start, end, lo = (unsigned long) block->ptr,
+         hi = lo + block->mapped;
+   char line[256];
+   size_t kb, total = 0;
+   int inside = 0;
+   FILE* fp = fopen("/proc/self/smaps", "r");
+
+   if (fp == NULL || block->ptr == NULL) {
+      if (fp != NULL) fclose(fp);
+      return 0;
+   }
+   while (fgets(line, sizeof(line), fp) != NULL) {
+      if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+         inside = start < hi && end > lo;
+      else if (inside && (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1
+               || sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1))
+         total += kb*1024;
+   }
+   fclose(fp);
+   return total < block->mapped ? total : block->mapped;
+}  /* ma_huge_bytes */
+
+/*-----------------------------------------------------------------*/
+static inline void ma_report(const ma_block_t* block, const char* label,
+      FILE* fp) {
+   fprintf(fp, "%s: %.1f MB, páginas %s", label, block->bytes/1048576.0,
+         ma_pages_name(block->pages));
+   if (block->pages != block->requested)
+      fprintf(fp, " (pedidas %s)", ma_pages_name(block->requested));
+   fprintf(fp, ", NUMA %s, %.1f MB en páginas grandes\n",
+         ma_numa_name(block->numa), ma_huge_bytes(block)/1048576.0);
+}  /* ma_report */
+
+#endif
@@ -0,0 +1,310 @@
+/* Archivo:   matfile.h
+ * Propósito: Leer y escribir matrices en un formato binario simple con
+ *            mmap, sin copiar ni convertir los datos: el programa recibe un
+ *            puntero a la zona de datos del archivo y las páginas se leen
+ *            del disco a medida que se usan. Sirve desde C y desde C++;
+ *            todo es inline.
+ *
+ *            Formato: una cabecera de 64 bytes (mf_header_t) y, desde
+ *            data_offset (múltiplo de alignment), rows*cols elementos de
+ *            dtype en orden de filas (row) o de columnas (col), sin huecos.
+ *
+ *            dtype    f64 (double), f32 (float), i32, i64
+ *            layout   row: el elemento (i, j) está en i*cols + j
+ *                     col: el elemento (i, j) está en j*rows + i
+ *
+ * Ejemplo:
+ *    #include "../comun/matfile.h"
+ *    . . .
+ *    mf_file_t fa, fc;
+ *    if (mf_open(&fa, "A.mat", 0) != 0) exit(1);
+ *    if (fa.header->dtype == MF_F64 && fa.header->layout == MF_ROW)
+ *       a = (double*) fa.data;               sin copiar
+ *    . . .
+ *    mf_create(&fc, "C.mat", n, n, MF_F64, MF_ROW, MF_DEFAULT_ALIGN);
+ *    c = (double*) fc.data;                  empieza en cero
+ *    . . .
+ *    mf_close(&fc);
+ *    mf_close(&fa);
+ *
+ * Notas:
+ *    1. Los enteros de la cabecera están en el orden de bytes de la
+ *       máquina que escribió el archivo; mf_open lo comprueba con el campo
+ *       endian y rechaza archivos de otro orden.
+ *    2. El alineamiento por defecto es 4096: la zona de datos empieza en
+ *       una página, así que con mmap queda alineada a la página en memoria.
+ *    3. mf_create agranda el archivo con ftruncate: los datos empiezan en
+ *       cero y el sistema de archivos no reserva bloques hasta que se
+ *       escriben.
+ *    4. Las funciones devuelven 0 si todo salió bien y -1 si no, después
+ *       de imprimir el motivo por stderr.
+ *       Si mf_create falla borra el archivo, que ya estaba truncado.
+ */
+#ifndef _MATFILE_H_
+#define _MATFILE_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MF_MAGIC "MATBIN\r\n"
+#define MF_VERSION 1
+#define MF_ENDIAN 0x01020304
+#define MF_DEFAULT_ALIGN 4096
+
+typedef enum { MF_F64, MF_F32, MF_I32, MF_I64, MF_DTYPES } mf_dtype_t;
+typedef enum { MF_ROW, MF_COL, MF_LAYOUTS } mf_layout_t;
+
+typedef struct {
+   char magic[8];           /* MF_MAGIC, sin el '\0' */
+   uint32_t version;
+   uint32_t endian;         /* MF_ENDIAN en el orden del que escribió */
+   uint32_t dtype;          /* mf_dtype_t */
+   uint32_t layout;         /* mf_layout_t */
+   uint64_t rows;
+   uint64_t cols;
+   uint64_t alignment;      /* Potencia de 2 */
+   uint64_t data_offset;    /* Múltiplo de alignment */
+   uint64_t data_bytes;     /* rows*cols*tamaño de dtype */
+} mf_header_t;
+
+typedef struct {
+   int fd;
+   int writable;
+   void* base;              /* Todo el archivo mapeado */
+   size_t size;
+   mf_header_t* header;     /* = base */
+   void* data;              /* = base + data_offset */
+} mf_file_t;
+
+/*-----------------------------------------------------------------*/
+static inline size_t mf_dtype_size(mf_dtype_t dtype) {
+   return dtype == MF_F32 || dtype == MF_I32 ? 4 : 8;
+}  /* mf_dtype_size */
+
+/*-----------------------------------------------------------------*/
+static inline const char* mf_dtype_name(mf_dtype_t dtype) {
+   static const char* names[MF_DTYPES] = { "f64", "f32", "i32", "i64" };
+   return names[dtype];
+}  /* mf_dtype_name */
+
+/*-----------------------------------------------------------------*/
+static inline const char* mf_layout_name(mf_layout_t layout) {
+   static const char* names[MF_LAYOUTS] = { "row", "col" };
+   return names[layout];
+}  /* mf_layout_name */
+
+/*-----------------------------------------------------------------*/
+/* Val Retorno: 1 si name es un dtype, 0 si no */
+static inline int mf_parse_dtype(const char* name, mf_dtype_t* dtype_p) {
+   int d;
+
+   for (d = 0; d < MF_DTYPES; d++)
+      if (strcmp(name, mf_dtype_name((mf_dtype_t) d)) == 0) {
+         *dtype_p = (mf_dtype_t) d;
+         return 1;
+      }
+   return 0;
+}  /* mf_parse_dtype */
+
+/*-----------------------------------------------------------------*/
+static inline int mf_parse_layout(const char* name, mf_layout_t* layout_p) {
+   int l;
+
+   for (l = 0; l < MF_LAYOUTS; l++)
+      if (strcmp(name, mf_layout_name((mf_layout_t) l)) == 0) {
+         *layout_p = (mf_layout_t) l;
+         return 1;
+      }
+   return 0;
+}  /* mf_parse_layout */
+
+/*-----------------------------------------------------------------*/
+/* Posición del elemento (i, j) en la zona de datos, en elementos */
+static inline size_t mf_index(const mf_header_t* h, size_t i, size_t j) {
+   return h->layout == MF_ROW ? i*h->cols + j : j*h->rows + i;
+}  /* mf_index */
+
+/*-----------------------------------------------------------------*/
+/* Lee el elemento (i, j) convertido a double */
+static inline double mf_get(const mf_file_t* f, size_t i, size_t j) {
+   size_t k = mf_index(f->header, i, j);
+
+   switch (f->header->dtype) {
+      case MF_F32: return ((const float*) f->data)[k];
+      case MF_I32: return ((const int32_t*) f->data)[k];
+      case MF_I64: return (double) ((const int64_t*) f->data)[k];
+      default:     return ((const double*) f->data)[k];
+   }
+}  /* mf_get */
+
+/*-----------------------------------------------------------------*/
+/* Escribe x en el elemento (i, j), convertido al dtype del archivo */
+static inline void mf_set(mf_file_t* f, size_t i, size_t j, double x) {
+   size_t k = mf_index(f->header, i, j);
+
+   switch (f->header->dtype) {
+      case MF_F32: ((float*) f->data)[k] = (float) x; break;
+      case MF_I32: ((int32_t*) f->data)[k] = (int32_t) x; break;
+      case MF_I64: ((int64_t*) f->data)[k] = (int64_t) x; break;
+      default:     ((double*) f->data)[k] = x; break;
+   }
+}  /* mf_set */
+
+/*-----------------------------------------------------------------*/
+static inline int mf_map(mf_file_t* f, const char* path) {
+   f->base = mmap(NULL, f->size, f->writable ? PROT_READ | PROT_WRITE
+         : PROT_READ, MAP_SHARED, f->fd, 0);
+   if (f->base == MAP_FAILED) {
+      fprintf(stderr, "matfile: no se pudo mapear %s (%s)\n", path,
+            strerror(errno));
+      close(f->fd);
+      f->fd = -1;
+      f->base = NULL;
+      return -1;
+   }
+   f->header = (mf_header_t*) f->base;
+   f->data = (char*) f->base + f->header->data_offset;
+   return 0;
+}  /* mf_map */
+
+/*-----------------------------------------------------------------*/
+/* Función:     mf_create
+ * Propósito:   Crear (o reemplazar) path con una matriz de rows x cols en
+ *              cero y dejarla mapeada para escribir
+ * En arg:      alignment: potencia de 2 >= 64 (MF_DEFAULT_ALIGN)
+ */
+static inline int mf_create(mf_file_t* f, const char* path, size_t rows,
+      size_t cols, mf_dtype_t dtype, mf_layout_t layout, size_t alignment) {
+   mf_header_t h;
+
+   if (alignment < sizeof(mf_header_t) || (alignment & (alignment - 1))) {
+      fprintf(stderr, "matfile: alineamiento %zu inválido\n", alignment);
+      return -1;
+   }
+   memset(&h, 0, sizeof(h));
+   memcpy(h.magic, MF_MAGIC, sizeof(h.magic));
+   h.version = MF_VERSION;
+   h.endian = MF_ENDIAN;
+   h.dtype = dtype;
+   h.layout = layout;
+   h.rows = rows;
+   h.cols = cols;
+   h.alignment = alignment;
+   h.data_offset = alignment;
+   h.data_bytes = rows*cols*mf_dtype_size(dtype);
+
+   f->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (f->fd < 0) {
+      fprintf(stderr, "matfile: no se pudo crear %s (%s)\n", path,
+            strerror(errno));
+      return -1;
+   }
+   f->writable = 1;
+   f->size = h.data_offset + h.data_bytes;
+   if (ftruncate(f->fd, f->size) != 0 ||
+         pwrite(f->fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h)) {
+      fprintf(stderr, "matfile: no se pudo escribir %s (%s)\n", path,
+            strerror(errno));
+      close(f->fd);
+      f->fd = -1;
+      unlink(path);
+      return -1;
+   }
+   if (mf_map(f, path) != 0) {
+      unlink(path);
+      return -1;
+   }
+   return 0;
+}  /* mf_create */
+
+/*-----------------------------------------------------------------*/
+/* Función:     mf_open
+ * Propósito:   Mapear path, de solo lectura si writable es 0, después de
+ *              comprobar que la cabecera es válida y que el archivo tiene
+ *              todos los datos
+ */
+static inline int mf_open(mf_file_t* f, const char* path, int writable) {
+   mf_header_t h;
+   struct stat st;
+   const char* error = NULL;
+
+   f->fd = open(path, writable ? O_RDWR : O_RDONLY);
+   if (f->fd < 0) {
+      fprintf(stderr, "matfile: no se pudo abrir %s (%s)\n", path,
+            strerror(errno));
+      return -1;
+   }
+   f->writable = writable;
+   if (pread(f->fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) ||
+         fstat(f->fd, &st) != 0)
+      error = "el archivo es demasiado corto";
+   else if (memcmp(h.magic, MF_MAGIC, sizeof(h.magic)) != 0)
+      error = "no es una matriz binaria";
+   else if (h.endian != MF_ENDIAN)
+      error = "se escribió con otro orden de bytes";
+   else if (h.version != MF_VERSION)
+      error = "versión desconocida";
+   else if (h.dtype >= MF_DTYPES || h.layout >= MF_LAYOUTS)
+      error = "dtype o layout desconocido";
+   else if (h.data_offset < sizeof(h) || h.alignment == 0 ||
+         (h.alignment & (h.alignment - 1)) != 0 ||
+         h.data_offset % h.alignment != 0 ||
+         h.data_bytes != h.rows*h.cols*mf_dtype_size((mf_dtype_t) h.dtype))
+      error = "cabecera inconsistente";
+   else if ((uint64_t) st.st_size < h.data_offset + h.data_bytes)
+      error = "faltan datos";
+   if (error != NULL) {
+      fprintf(stderr, "matfile: %s: %s\n", path, error);
+      close(f->fd);
+      f->fd = -1;
+      return -1;
+   }
+   f->size = h.data_offset + h.data_bytes;
+   return mf_map(f, path);
+}  /* mf_open */
+
+/*-----------------------------------------------------------------*/
+/* Aviso al kernel sobre cómo se va a recorrer la zona de datos:
+ * MADV_SEQUENTIAL, MADV_RANDOM o MADV_WILLNEED (empezar a leer ya) */
+static inline void mf_advise(mf_file_t* f, int advice) {
+   madvise(f->base, f->size, advice);
+}  /* mf_advise */
+
+/*-----------------------------------------------------------------*/
+/* Escribe al disco lo modificado; mf_close no espera a que termine */
+static inline int mf_sync(mf_file_t* f) {
+   if (msync(f->base, f->size, MS_SYNC) != 0) {
+      fprintf(stderr, "matfile: msync falló (%s)\n", strerror(errno));
+      return -1;
+   }
+   return 0;
+}  /* mf_sync */
+
+/*-----------------------------------------------------------------*/
+static inline void mf_close(mf_file_t* f) {
+   if (f->base != NULL) munmap(f->base, f->size);
+   if (f->fd >= 0) close(f->fd);
+   f->base = NULL;
+   f->fd = -1;
+}  /* mf_close */
+
+/*-----------------------------------------------------------------*/
+static inline void mf_report(const mf_file_t* f, const char* label,
+      FILE* fp) {
+   const mf_header_t* h = f->header;
+
+   fprintf(fp, "%s: %llu x %llu, %s, %s, datos en %llu (alineados a %llu), "
+         "%.1f MB\n", label, (unsigned long long) h->rows,
+         (unsigned long long) h->cols, mf_dtype_name((mf_dtype_t) h->dtype),
+         mf_layout_name((mf_layout_t) h->layout),
+         (unsigned long long) h->data_offset,
+         (unsigned long long) h->alignment, h->data_bytes/1048576.0);
+}  /* mf_report */
+
+#endif
@@ -0,0 +1,198 @@
+/* Archivo:   perfcount.h
+ * Propósito: Leer los contadores de hardware del procesador con
+ *            perf_event_open alrededor de una región del programa, para
+ *            saber por qué una versión es más rápida que otra y no solo
+ *            cuánto: ciclos, instrucciones, IPC, fallos de L1d, de último
+ *            nivel de cache y de TLB de datos, saltos mal predichos y
+ *            fallos de página. Sirve desde C y desde C++; todo es inline.
+ *
+ * Ejemplo:
+ *    #include "../comun/perfcount.h"
+ *    . . .
+ *    pc_counters_t pc;
+ *    pc_open(&pc);
+ *    pc_start(&pc);
+ *    región medida
+ *    pc_stop(&pc);
+ *    pc_report(&pc, "bloque 32", stdout);
+ *    pc_close(&pc);
+ *
+ * Notas:
+ *    1. Cada evento se abre por separado: si uno no existe o no está
+ *       permitido (perf_event_paranoid, máquinas virtuales sin PMU,
+ *       contenedores), se imprime "n/d" en su lugar y los demás se
+ *       miden igual. Si no se pudo abrir ninguno de hardware, pc_open
+ *       avisa una sola vez por stderr y el programa sigue.
+ *    2. Solo se cuenta en modo usuario (exclude_kernel), que es lo que
+ *       permite perf_event_paranoid = 2 sin privilegios.
+ *    3. Con inherit, los threads creados después de pc_open también se
+ *       cuentan; hay que llamar a pc_stop después de los pthread_join, o
+ *       después de que termine la fase si los threads son de un pool que
+ *       se creó después de pc_open (ver 4. Barreras-VariablesCondicion/pool.h).
+ *    4. Si hay más eventos que contadores físicos, el kernel los alterna y
+ *       los valores se escalan por tiempo habilitado / tiempo contando;
+ *       pc_report los marca con '*'.
+ */
+#ifndef _PERFCOUNT_H_
+#define _PERFCOUNT_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+enum { PC_CYCLES, PC_INSTRUCTIONS, PC_L1D_MISSES, PC_LLC_MISSES,
+   PC_DTLB_MISSES, PC_BRANCH_MISSES, PC_PAGE_FAULTS, PC_EVENTS };
+
+typedef struct {
+   int fd[PC_EVENTS];                    /* -1 si no está disponible */
+   double value[PC_EVENTS];
+   int scaled[PC_EVENTS];
+} pc_counters_t;
+
+static int pc_warned __attribute__((unused)) = 0;
+
+#define PC_CACHE_MISS(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/*-----------------------------------------------------------------*/
+/* Tipo y configuración de perf_event_attr del evento e */
+static inline void pc_event_config(int e, unsigned* type_p,
+      unsigned long long* config_p) {
+   static const unsigned types[PC_EVENTS] = { PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE };
+   static const unsigned long long configs[PC_EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PC_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D),
+      PC_CACHE_MISS(PERF_COUNT_HW_CACHE_LL),
+      PC_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB),
+      PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS };
+
+   *type_p = types[e];
+   *config_p = configs[e];
+}  /* pc_event_config */
+
+/*-----------------------------------------------------------------*/
+static inline const char* pc_event_name(int e) {
+   static const char* names[PC_EVENTS] = { "ciclos", "instrucciones",
+      "L1d-miss", "LLC-miss", "dTLB-miss", "branch-miss", "page-faults" };
+   return names[e];
+}  /* pc_event_name */
+
+/*-----------------------------------------------------------------*/
+/* Función:     pc_open
+ * Propósito:   Abrir todos los eventos que se puedan, deshabilitados
+ * Val Retorno: Cuántos eventos se abrieron
+ */
+static inline int pc_open(pc_counters_t* pc) {
+   struct perf_event_attr attr;
+   int e, opened = 0, hardware = 0, err = 0;
+
+   for (e = 0; e < PC_EVENTS; e++) {
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      pc_event_config(e, &attr.type, (unsigned long long*) &attr.config);
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      pc->fd[e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      pc->value[e] = 0.0;
+      pc->scaled[e] = 0;
+      if (pc->fd[e] >= 0) {
+         opened++;
+         if (attr.type != PERF_TYPE_SOFTWARE) hardware++;
+      } else if (err == 0) {
+         err = errno;
+      }
+   }
+   if (hardware == 0 && !pc_warned) {
+      fprintf(stderr, "perfcount: sin contadores de hardware (%s); ver "
+            "/proc/sys/kernel/perf_event_paranoid\n", strerror(err));
+      pc_warned = 1;
+   }
+   return opened;
+}  /* pc_open */
+
+/*-----------------------------------------------------------------*/
+static inline void pc_start(pc_counters_t* pc) {
+   int e;
+
+   for (e = 0; e < PC_EVENTS; e++)
+      if (pc->fd[e] >= 0) {
+         ioctl(pc->fd[e], PERF_EVENT_IOC_RESET, 0);
+         ioctl(pc->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+      }
+}  /* pc_start */
+
+/*-----------------------------------------------------------------*/
+/* Detener los contadores y leerlos, escalando si se multiplexaron */
+static inline void pc_stop(pc_counters_t* pc) {
+   unsigned long long buf[3];   /* valor, tiempo habilitado, contando */
+   int e;
+
+   for (e = 0; e < PC_EVENTS; e++)
+      if (pc->fd[e] >= 0)
+         ioctl(pc->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+   for (e = 0; e < PC_EVENTS; e++) {
+      pc->value[e] = 0.0;
+      pc->scaled[e] = 0;
+      if (pc->fd[e] < 0 || read(pc->fd[e], buf, sizeof(buf)) != sizeof(buf))
+         continue;
+      pc->value[e] = (double) buf[0];
+      if (buf[2] > 0 && buf[2] < buf[1]) {
+         pc->value[e] *= (double) buf[1]/buf[2];
+         pc->scaled[e] = 1;
+      }
+   }
+}  /* pc_stop */
+
+/*-----------------------------------------------------------------*/
+/* Valor del evento e en la última región, o -1 si no está disponible */
+static inline double pc_value(const pc_counters_t* pc, int e) {
+   return pc->fd[e] >= 0 ? pc->value[e] : -1.0;
+}  /* pc_value */
+
+/*-----------------------------------------------------------------*/
+/* Imprimir una línea por evento, con IPC y fallos por 1000 instrucciones
+ * cuando se pudieron medir */
+static inline void pc_report(const pc_counters_t* pc, const char* label,
+      FILE* fp) {
+   double instr = pc_value(pc, PC_INSTRUCTIONS);
+   int e;
+
+   fprintf(fp, "Contadores (%s):\n", label);
+   for (e = 0; e < PC_EVENTS; e++) {
+      if (pc->fd[e] < 0) {
+         fprintf(fp, "   %-14s %16s\n", pc_event_name(e), "n/d");
+         continue;
+      }
+      fprintf(fp, "   %-14s %16.0f%s", pc_event_name(e), pc->value[e],
+            pc->scaled[e] ? "*" : " ");
+      if (e == PC_INSTRUCTIONS && pc_value(pc, PC_CYCLES) > 0)
+         fprintf(fp, "   IPC %.2f", instr/pc_value(pc, PC_CYCLES));
+      else if (e >= PC_L1D_MISSES && e <= PC_BRANCH_MISSES && instr > 0)
+         fprintf(fp, "   %.2f por 1000 instrucciones",
+               1000.0*pc->value[e]/instr);
+      fprintf(fp, "\n");
+   }
+}  /* pc_report */
+
+/*-----------------------------------------------------------------*/
+static inline void pc_close(pc_counters_t* pc) {
+   int e;
+
+   for (e = 0; e < PC_EVENTS; e++)
+      if (pc->fd[e] >= 0) {
+         close(pc->fd[e]);
+         pc->fd[e] = -1;
+      }
+}  /* pc_close */
+
+#endif
@@ -0,0 +1,341 @@
+/* Archivo:   sparse.h
+ * Propósito: Guardar matrices dispersas (casi todos los elementos en cero)
+ *            sin los ceros y multiplicarlas por un vector (SpMV) o por una
+ *            matriz densa (SpMM). Sirve desde C y desde C++; todo es
+ *            inline.
+ *
+ *            CSR    por filas: los elementos distintos de cero de la fila
+ *                   i están en val[ptr[i] .. ptr[i+1]) y sus columnas en
+ *                   idx. SpMV lee x salteado y escribe y en orden.
+ *            CSC    lo mismo por columnas. SpMV lee x en orden y suma en y
+ *                   salteado, así que cada thread necesita su propio y.
+ *            BCSR   CSR de bloques de r x c: se guarda entero (con sus
+ *                   ceros) cada bloque que tiene algún elemento distinto de
+ *                   cero. Menos índices y accesos a x de a c seguidos, a
+ *                   cambio de multiplicar algunos ceros (ver relleno).
+ *
+ *            Los kernels trabajan sobre un rango [first, last) de filas
+ *            (de bloques en BCSR, de columnas en CSC) para que el programa
+ *            reparta los rangos entre threads como quiera.
+ *
+ * Ejemplo:
+ *    #include "../comun/sparse.h"
+ *    . . .
+ *    sp_csr_t a;
+ *    sp_csr_from_dense(&a, dense, n, n, n);
+ *    sp_csr_spmv(&a, x, y, 0, a.rows);        y = A*x
+ *    sp_csr_free(&a);
+ *
+ * Notas:
+ *    1. Las matrices densas se pasan por filas: el elemento (i, j) está en
+ *       dense[i*ld + j]. En SpMM, X tiene cols filas de k columnas y Y
+ *       rows filas de k columnas.
+ *    2. Los índices de columna son int (hasta 2^31 - 1 columnas) y ptr es
+ *       long, así que nnz puede pasar de 2^31.
+ *    3. Si no hay memoria o el tamaño de bloque de BCSR es inválido, las
+ *       conversiones imprimen un mensaje y terminan el programa.
+ *    4. Los bloques de BCSR tienen a lo sumo SP_MAX_BLOCK filas: el SpMV
+ *       acumula una fila de bloques en un arreglo local.
+ */
+#ifndef _SPARSE_H_
+#define _SPARSE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SP_MAX_BLOCK 64
+
+typedef struct {
+   long rows, cols, nnz;
+   long* ptr;               /* rows + 1 */
+   int* idx;                /* nnz columnas */
+   double* val;             /* nnz valores */
+} sp_csr_t;
+
+typedef struct {
+   long rows, cols, nnz;
+   long* ptr;               /* cols + 1 */
+   int* idx;                /* nnz filas */
+   double* val;
+} sp_csc_t;
+
+typedef struct {
+   long rows, cols, nnz;    /* nnz: elementos distintos de cero */
+   int r, c;                /* Tamaño de los bloques */
+   long brows, bcols;       /* Filas y columnas de bloques */
+   long blocks;
+   long* ptr;               /* brows + 1 */
+   int* idx;                /* blocks columnas de bloque */
+   double* val;             /* blocks*r*c valores, cada bloque por filas */
+} sp_bcsr_t;
+
+/*-----------------------------------------------------------------*/
+static inline void* sp_alloc(size_t bytes) {
+   void* p = malloc(bytes > 0 ? bytes : 1);
+
+   if (p == NULL) {
+      fprintf(stderr, "sparse: la memoria falló\n");
+      exit(1);
+   }
+   return p;
+}  /* sp_alloc */
+
+/*-----------------------------------------------------------------*/
+/* Función:     sp_csr_from_dense
+ * Propósito:   Convertir una matriz densa de rows x cols a CSR en dos
+ *              pasadas: contar los elementos de cada fila y copiarlos
+ */
+static inline void sp_csr_from_dense(sp_csr_t* a, const double* dense,
+      long rows, long cols, long ld) {
+   long i, j, k;
+
+   a->rows = rows;
+   a->cols = cols;
+   a->ptr = (long*) sp_alloc((rows + 1)*sizeof(long));
+   a->ptr[0] = 0;
+   for (i = 0; i < rows; i++) {
+      k = 0;
+      for (j = 0; j < cols; j++)
+         if (dense[i*ld + j] != 0.0) k++;
+      a->ptr[i+1] = a->ptr[i] + k;
+   }
+   a->nnz = a->ptr[rows];
+   a->idx = (int*) sp_alloc(a->nnz*sizeof(int));
+   a->val = (double*) sp_alloc(a->nnz*sizeof(double));
+   for (i = 0; i < rows; i++) {
+      k = a->ptr[i];
+      for (j = 0; j < cols; j++)
+         if (dense[i*ld + j] != 0.0) {
+            a->idx[k] = (int) j;
+            a->val[k++] = dense[i*ld + j];
+         }
+   }
+}  /* sp_csr_from_dense */
+
+/*-----------------------------------------------------------------*/
+/* Igual que sp_csr_from_dense, pero recorriendo la densa por filas y
+ * contando por columnas, para no leerla salteada */
+static inline void sp_csc_from_dense(sp_csc_t* a, const double* dense,
+      long rows, long cols, long ld) {
+   long i, j, * next;
+
+   a->rows = rows;
+   a->cols = cols;
+   a->ptr = (long*) sp_alloc((cols + 1)*sizeof(long));
+   memset(a->ptr, 0, (cols + 1)*sizeof(long));
+   for (i = 0; i < rows; i++)
+      for (j = 0; j < cols; j++)
+         if (dense[i*ld + j] != 0.0) a->ptr[j+1]++;
+   for (j = 0; j < cols; j++) a->ptr[j+1] += a->ptr[j];
+   a->nnz = a->ptr[cols];
+   a->idx = (int*) sp_alloc(a->nnz*sizeof(int));
+   a->val = (double*) sp_alloc(a->nnz*sizeof(double));
+   next = (long*) sp_alloc(cols*sizeof(long));
+   memcpy(next, a->ptr, cols*sizeof(long));
+   for (i = 0; i < rows; i++)
+      for (j = 0; j < cols; j++)
+         if (dense[i*ld + j] != 0.0) {
+            a->idx[next[j]] = (int) i;
+            a->val[next[j]++] = dense[i*ld + j];
+         }
+   free(next);
+}  /* sp_csc_from_dense */
+
+/*-----------------------------------------------------------------*/
+/* Función:     sp_bcsr_from_dense
+ * Propósito:   Convertir a bloques de r x c. Los bloques del borde que se
+ *              salen de la matriz se completan con ceros
+ */
+static inline void sp_bcsr_from_dense(sp_bcsr_t* a, const double* dense,
+      long rows, long cols, long ld, int r, int c) {
+   long bi, bj, i, j, k, iEnd, jEnd;
+   char* used;
+
+   if (r <= 0 || c <= 0 || r > SP_MAX_BLOCK) {
+      fprintf(stderr, "sparse: bloque de %d x %d inválido (filas entre 1 y %d)\n",
+            r, c, SP_MAX_BLOCK);
+      exit(1);
+   }
+   a->rows = rows;
+   a->cols = cols;
+   a->r = r;
+   a->c = c;
+   a->brows = (rows + r - 1)/r;
+   a->bcols = (cols + c - 1)/c;
+   a->nnz = 0;
+   a->ptr = (long*) sp_alloc((a->brows + 1)*sizeof(long));
+   used = (char*) sp_alloc(a->bcols);
+
+   /* Primera pasada: qué bloques de cada fila de bloques se guardan */
+   a->ptr[0] = 0;
+   for (bi = 0; bi < a->brows; bi++) {
+      memset(used, 0, a->bcols);
+      iEnd = (bi + 1)*r < rows ? (bi + 1)*r : rows;
+      for (i = bi*r; i < iEnd; i++)
+         for (j = 0; j < cols; j++)
+            if (dense[i*ld + j] != 0.0) {
+               used[j/c] = 1;
+               a->nnz++;
+            }
+      k = 0;
+      for (bj = 0; bj < a->bcols; bj++) k += used[bj];
+      a->ptr[bi+1] = a->ptr[bi] + k;
+   }
+   a->blocks = a->ptr[a->brows];
+   a->idx = (int*) sp_alloc(a->blocks*sizeof(int));
+   a->val = (double*) sp_alloc(a->blocks*r*c*sizeof(double));
+   memset(a->val, 0, a->blocks*r*c*sizeof(double));
+
+   for (bi = 0; bi < a->brows; bi++) {
+      memset(used, 0, a->bcols);
+      iEnd = (bi + 1)*r < rows ? (bi + 1)*r : rows;
+      for (i = bi*r; i < iEnd; i++)
+         for (j = 0; j < cols; j++)
+            if (dense[i*ld + j] != 0.0) used[j/c] = 1;
+      k = a->ptr[bi];
+      for (bj = 0; bj < a->bcols; bj++) {
+         if (!used[bj]) continue;
+         a->idx[k] = (int) bj;
+         jEnd = (bj + 1)*c < cols ? (bj + 1)*c : cols;
+         for (i = bi*r; i < iEnd; i++)
+            for (j = bj*c; j < jEnd; j++)
+               a->val[k*r*c + (i - bi*r)*c + (j - bj*c)] = dense[i*ld + j];
+         k++;
+      }
+   }
+   free(used);
+}  /* sp_bcsr_from_dense */
+
+/*-----------------------------------------------------------------*/
+/* Valores guardados / elementos distintos de cero: 1 si no hay relleno */
+static inline double sp_bcsr_fill(const sp_bcsr_t* a) {
+   return a->nnz > 0 ? (double) a->blocks*a->r*a->c/a->nnz : 1.0;
+}  /* sp_bcsr_fill */
+
+/*-----------------------------------------------------------------*/
+static inline void sp_csr_free(sp_csr_t* a) {
+   free(a->ptr);
+   free(a->idx);
+   free(a->val);
+}  /* sp_csr_free */
+
+/*-----------------------------------------------------------------*/
+static inline void sp_csc_free(sp_csc_t* a) {
+   free(a->ptr);
+   free(a->idx);
+   free(a->val);
+}  /* sp_csc_free */
+
+/*-----------------------------------------------------------------*/
+static inline void sp_bcsr_free(sp_bcsr_t* a) {
+   free(a->ptr);
+   free(a->idx);
+   free(a->val);
+}  /* sp_bcsr_free */
+
+/*-----------------------------------------------------------------*/
+/* y[i] = fila i de A por x, para las filas [first, last) */
+static inline void sp_csr_spmv(const sp_csr_t* a, const double* x,
+      double* y, long first, long last) {
+   long i, k;
+   double sum;
+
+   for (i = first; i < last; i++) {
+      sum = 0.0;
+      for (k = a->ptr[i]; k < a->ptr[i+1]; k++)
+         sum += a->val[k]*x[a->idx[k]];
+      y[i] = sum;
+   }
+}  /* sp_csr_spmv */
+
+/*-----------------------------------------------------------------*/
+/* y += columnas [first, last) de A por x[first .. last). y tiene que
+ * empezar en cero y no puede ser el mismo para dos rangos a la vez */
+static inline void sp_csc_spmv(const sp_csc_t* a, const double* x,
+      double* y, long first, long last) {
+   long j, k;
+   double xj;
+
+   for (j = first; j < last; j++) {
+      xj = x[j];
+      for (k = a->ptr[j]; k < a->ptr[j+1]; k++)
+         y[a->idx[k]] += a->val[k]*xj;
+   }
+}  /* sp_csc_spmv */
+
+/*-----------------------------------------------------------------*/
+/* y = A*x para las filas de bloques [first, last) */
+static inline void sp_bcsr_spmv(const sp_bcsr_t* a, const double* x,
+      double* y, long first, long last) {
+   int r = a->r, c = a->c, ii, jj, iEnd, jEnd;
+   long bi, k;
+   const double* block;
+   double sum[SP_MAX_BLOCK];
+
+   for (bi = first; bi < last; bi++) {
+      iEnd = a->rows - bi*r < r ? (int) (a->rows - bi*r) : r;
+      for (ii = 0; ii < r; ii++) sum[ii] = 0.0;
+      for (k = a->ptr[bi]; k < a->ptr[bi+1]; k++) {
+         block = a->val + k*r*c;
+         const double* xb = x + (long) a->idx[k]*c;
+         jEnd = a->cols - (long) a->idx[k]*c < c
+              ? (int) (a->cols - (long) a->idx[k]*c) : c;
+         for (ii = 0; ii < iEnd; ii++)
+            for (jj = 0; jj < jEnd; jj++)
+               sum[ii] += block[ii*c + jj]*xb[jj];
+      }
+      for (ii = 0; ii < iEnd; ii++) y[bi*r + ii] = sum[ii];
+   }
+}  /* sp_bcsr_spmv */
+
+/*-----------------------------------------------------------------*/
+/* Filas [first, last) de Y = A*X, con X de cols x k e Y de rows x k */
+static inline void sp_csr_spmm(const sp_csr_t* a, const double* x,
+      long ldx, double* y, long ldy, long k, long first, long last) {
+   long i, p, j;
+   double v;
+   const double* xrow;
+
+   for (i = first; i < last; i++) {
+      double* yrow = y + i*ldy;
+      for (j = 0; j < k; j++) yrow[j] = 0.0;
+      for (p = a->ptr[i]; p < a->ptr[i+1]; p++) {
+         v = a->val[p];
+         xrow = x + (long) a->idx[p]*ldx;
+         for (j = 0; j < k; j++) yrow[j] += v*xrow[j];
+      }
+   }
+}  /* sp_csr_spmm */
+
+/*-----------------------------------------------------------------*/
+/* Filas de bloques [first, last) de Y = A*X */
+static inline void sp_bcsr_spmm(const sp_bcsr_t* a, const double* x,
+      long ldx, double* y, long ldy, long k, long first, long last) {
+   int r = a->r, c = a->c, ii, jj, iEnd, jEnd;
+   long bi, p, j;
+   double v;
+   const double* block;
+
+   for (bi = first; bi < last; bi++) {
+      iEnd = a->rows - bi*r < r ? (int) (a->rows - bi*r) : r;
+      for (ii = 0; ii < iEnd; ii++)
+         for (j = 0; j < k; j++) y[(bi*r + ii)*ldy + j] = 0.0;
+      for (p = a->ptr[bi]; p < a->ptr[bi+1]; p++) {
+         block = a->val + p*r*c;
+         jEnd = a->cols - (long) a->idx[p]*c < c
+              ? (int) (a->cols - (long) a->idx[p]*c) : c;
+         for (ii = 0; ii < iEnd; ii++) {
+            double* yrow = y + (bi*r + ii)*ldy;
+            for (jj = 0; jj < jEnd; jj++) {
+               v = block[ii*c + jj];
+               if (v == 0.0) continue;
+               const double* xrow = x + ((long) a->idx[p]*c + jj)*ldx;
+               for (j = 0; j < k; j++) yrow[j] += v*xrow[j];
+            }
+         }
+      }
+   }
+}  /* sp_bcsr_spmm */
+
+#endif
@@ -0,0 +1,456 @@
+/* Archivo:   worksteal.h
+ * Propósito: Planificador de tareas con robo de trabajo (work stealing)
+ *            para algoritmos recursivos, cuyo árbol de tareas es irregular
+ *            y se reparte mal con una partición estática. Cada worker tiene
+ *            una deque de Chase-Lev: empuja y saca tareas por abajo (LIFO,
+ *            aprovecha la cache) y, cuando se queda sin trabajo, le roba a
+ *            otro por arriba (FIFO, las tareas más grandes). Sirve desde C
+ *            y desde C++; todo es inline.
+ *
+ *            ws_init, ws_destroy  Crear y terminar worker_count - 1 threads;
+ *                                 el que llama a ws_run es el worker 0. Con
+ *                                 placement distinto de NULL, el worker r
+ *                                 se fija con af_bind (affinity.h)
+ *            ws_run               Ejecutar fn(arg) con todos los workers y
+ *                                 volver cuando termina
+ *            ws_spawn, ws_sync    Fork/join: ws_spawn deja una tarea en la
+ *                                 deque del worker actual para que la
+ *                                 ejecute él o un ladrón; ws_sync espera a
+ *                                 que termine, ejecutando o robando otras
+ *                                 mientras tanto
+ *            ws_report            Tareas, robos y utilización de cada
+ *                                 worker en el último ws_run
+ *
+ * Ejemplo:
+ *    #include "../comun/worksteal.h"
+ *    . . .
+ *    struct fib_s { int n; long result; };
+ *    void Fib(void* arg) {
+ *       struct fib_s* f = (struct fib_s*) arg;
+ *       struct fib_s a, b;
+ *       ws_task_t t;
+ *       if (f->n < 2) { f->result = f->n; return; }
+ *       a.n = f->n - 1;
+ *       b.n = f->n - 2;
+ *       ws_spawn(&t, Fib, &a);     a lo puede ejecutar otro worker
+ *       Fib(&b);
+ *       ws_sync(&t);
+ *       f->result = a.result + b.result;
+ *    }
+ *    . . .
+ *    ws_init(&sched, worker_count, NULL);
+ *    ws_run(&sched, Fib, &root);
+ *    ws_report(&sched, stdout);
+ *    ws_destroy(&sched);
+ *
+ * Notas:
+ *    1. La tarea (ws_task_t) la reserva quien la crea, normalmente en su
+ *       pila; por eso cada ws_spawn necesita su ws_sync antes de volver de
+ *       la función. Las tareas se sincronizan en orden inverso al que se
+ *       crearon.
+ *    2. Los órdenes de memoria de la deque siguen a Lê, Pop, Cohen y
+ *       Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+ *       Memory Models" (PPoPP 2013). Cuando la deque se llena se duplica;
+ *       el arreglo viejo se libera en ws_destroy porque un ladrón todavía
+ *       puede estar leyéndolo.
+ *    3. La utilización es 1 - (tiempo sin tarea que ejecutar) / (tiempo
+ *       de ws_run). El tiempo que un worker pasa en ws_sync esperando a
+ *       una tarea que le robaron y sin encontrar otra cuenta como ocioso.
+ *    4. Un worker que falla WS_STEAL_ROUNDS rondas de robo seguidas cede
+ *       la CPU con sched_yield, para no quitársela a los que trabajan si
+ *       hay más workers que CPUs. Entre dos ws_run los workers duermen.
+ *    5. Cada archivo fuente que incluye worksteal.h tiene su propio
+ *       ws_self; un programa debe crear y usar el planificador desde un
+ *       solo archivo.
+ */
+#ifndef _WORKSTEAL_H_
+#define _WORKSTEAL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "hrtimer.h"
+#include "affinity.h"
+
+#define WS_CACHE_LINE      64
+#define WS_INITIAL_SIZE    256
+#define WS_STEAL_ROUNDS    64
+
+typedef void (*ws_fn_t)(void* arg);
+
+typedef struct {
+   ws_fn_t fn;
+   void* arg;
+   int done;
+} ws_task_t;
+
+/* Arreglo circular de la deque; size es potencia de 2 */
+typedef struct ws_array_s {
+   long size;
+   ws_task_t** buf;
+   struct ws_array_s* next;      /* Arreglos reemplazados */
+} ws_array_t;
+
+typedef struct ws_worker_s {
+   long top __attribute__((aligned(WS_CACHE_LINE)));
+   long bottom __attribute__((aligned(WS_CACHE_LINE)));
+   ws_array_t* array;
+   struct ws_sched_s* sched;
+   const af_placement_t* placement;
+   int id;
+   unsigned long long seed;
+   pthread_t thread;
+
+   /* Estadísticas del último ws_run, las escribe solo el worker */
+   long tasks;
+   long steals;
+   long failed_steals;
+   long long idle_ns;
+   long long idle_since;         /* 0 si está trabajando */
+} ws_worker_t;
+
+typedef struct ws_sched_s {
+   int worker_count;
+   ws_worker_t* workers;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   int generation;
+   int stop;
+   int active __attribute__((aligned(WS_CACHE_LINE)));
+   int finished;
+   long long run_ns;
+} ws_sched_t;
+
+static __thread ws_worker_t* ws_self __attribute__((unused)) = NULL;
+
+/*-----------------------------------------------------------------*/
+static inline ws_array_t* ws_array_new(long size) {
+   ws_array_t* a = (ws_array_t*) malloc(sizeof(ws_array_t));
+
+   if (a != NULL) a->buf = (ws_task_t**) malloc(size*sizeof(ws_task_t*));
+   if (a == NULL || a->buf == NULL) {
+      fprintf(stderr, "worksteal: la memoria falló\n");
+      exit(1);
+   }
+   a->size = size;
+   a->next = NULL;
+   return a;
+}  /* ws_array_new */
+
+/*-----------------------------------------------------------------*/
+/* Duplicar el arreglo de w; solo lo llama el dueño */
+static inline ws_array_t* ws_grow(ws_worker_t* w, ws_array_t* a,
+      long top, long bottom) {
+   ws_array_t* bigger = ws_array_new(2*a->size);
+   long i;
+
+   for (i = top; i < bottom; i++)
+      bigger->buf[i & (bigger->size - 1)] = a->buf[i & (a->size - 1)];
+   bigger->next = a;
+   __atomic_store_n(&w->array, bigger, __ATOMIC_RELEASE);
+   return bigger;
+}  /* ws_grow */
+
+/*-----------------------------------------------------------------*/
+/* Empujar t en la deque de w (solo el dueño) */
+static inline void ws_push(ws_worker_t* w, ws_task_t* t) {
+   long b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+   long top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+   ws_array_t* a = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+
+   if (b - top > a->size - 1) a = ws_grow(w, a, top, b);
+   __atomic_store_n(&a->buf[b & (a->size - 1)], t, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+}  /* ws_push */
+
+/*-----------------------------------------------------------------*/
+/* Sacar la última tarea de la deque de w (solo el dueño), o NULL */
+static inline ws_task_t* ws_take(ws_worker_t* w) {
+   long b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+   ws_array_t* a = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+   ws_task_t* t = NULL;
+   long top;
+
+   __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   top = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+   if (top <= b) {
+      t = __atomic_load_n(&a->buf[b & (a->size - 1)], __ATOMIC_RELAXED);
+      if (top == b) {
+         /* Última tarea: compite con los ladrones */
+         if (!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            t = NULL;
+         __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+      }
+   } else {
+      __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+   }
+   return t;
+}  /* ws_take */
+
+/*-----------------------------------------------------------------*/
+/* Robar la primera tarea de la deque de w, o NULL si está vacía o
+ * perdió la carrera con otro */
+static inline ws_task_t* ws_steal(ws_worker_t* w) {
+   long top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+   long b;
+   ws_array_t* a;
+   ws_task_t* t;
+
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+   if (top >= b) return NULL;
+   a = __atomic_load_n(&w->array, __ATOMIC_ACQUIRE);
+   t = __atomic_load_n(&a->buf[top & (a->size - 1)], __ATOMIC_RELAXED);
+   if (!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      return NULL;
+   return t;
+}  /* ws_steal */
+
+/*-----------------------------------------------------------------*/
+static inline void ws_idle_begin(ws_worker_t* w) {
+   if (w->idle_since == 0) w->idle_since = hr_now_ns();
+}  /* ws_idle_begin */
+
+/*-----------------------------------------------------------------*/
+static inline void ws_idle_end(ws_worker_t* w) {
+   if (w->idle_since != 0) {
+      w->idle_ns += hr_now_ns() - w->idle_since;
+      w->idle_since = 0;
+   }
+}  /* ws_idle_end */
+
+/*-----------------------------------------------------------------*/
+static inline void ws_execute(ws_worker_t* w, ws_task_t* t) {
+   ws_idle_end(w);
+   w->tasks++;
+   t->fn(t->arg);
+   __atomic_store_n(&t->done, 1, __ATOMIC_RELEASE);
+}  /* ws_execute */
+
+/*-----------------------------------------------------------------*/
+/* Intentar robar una vez a cada uno de los demás workers, empezando por
+ * uno al azar; ejecutar lo robado. Val Retorno: 1 si ejecutó una tarea */
+static inline int ws_try_steal(ws_worker_t* w) {
+   ws_sched_t* s = w->sched;
+   ws_task_t* t;
+   int i, victim;
+
+   if (s->worker_count < 2) return 0;
+   w->seed ^= w->seed << 13;
+   w->seed ^= w->seed >> 7;
+   w->seed ^= w->seed << 17;
+   victim = (int) (w->seed % (s->worker_count - 1));
+   for (i = 0; i < s->worker_count - 1; i++) {
+      victim = (victim + 1) % s->worker_count;
+      if (victim == w->id) victim = (victim + 1) % s->worker_count;
+      t = ws_steal(&s->workers[victim]);
+      if (t != NULL) {
+         w->steals++;
+         ws_execute(w, t);
+         return 1;
+      }
+      w->failed_steals++;
+   }
+   return 0;
+}  /* ws_try_steal */
+
+/*-----------------------------------------------------------------*/
+/* Crear una tarea que ejecuta fn(arg) en paralelo con el que llama */
+static inline void ws_spawn(ws_task_t* t, ws_fn_t fn, void* arg) {
+   t->fn = fn;
+   t->arg = arg;
+   t->done = 0;
+   ws_push(ws_self, t);
+}  /* ws_spawn */
+
+/*-----------------------------------------------------------------*/
+/* Esperar a que termine t, trabajando mientras tanto */
+static inline void ws_sync(ws_task_t* t) {
+   ws_worker_t* w = ws_self;
+   ws_task_t* mine;
+   int rounds = 0;
+
+   while (!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) {
+      mine = ws_take(w);
+      if (mine != NULL) {
+         ws_execute(w, mine);
+      } else if (ws_try_steal(w)) {
+         rounds = 0;
+      } else {
+         ws_idle_begin(w);
+         if (++rounds >= WS_STEAL_ROUNDS) {
+            sched_yield();
+            rounds = 0;
+         }
+      }
+   }
+   ws_idle_end(w);
+}  /* ws_sync */
+
+/*-----------------------------------------------------------------*/
+/* Función:    ws_worker_main
+ * Propósito:  Dormir entre ws_run y robar tareas durante cada uno
+ */
+static inline void* ws_worker_main(void* arg) {
+   ws_worker_t* w = (ws_worker_t*) arg;
+   ws_sched_t* s = w->sched;
+   int my_generation = 0, rounds = 0;
+
+   ws_self = w;
+   af_bind(w->placement, w->id);
+   for (;;) {
+      pthread_mutex_lock(&s->mutex);
+      while (s->generation == my_generation && !s->stop)
+         pthread_cond_wait(&s->cond, &s->mutex);
+      my_generation = s->generation;
+      if (s->stop) {
+         pthread_mutex_unlock(&s->mutex);
+         return NULL;
+      }
+      pthread_mutex_unlock(&s->mutex);
+
+      ws_idle_begin(w);
+      while (__atomic_load_n(&s->active, __ATOMIC_ACQUIRE)) {
+         if (ws_try_steal(w)) {
+            rounds = 0;
+         } else {
+            ws_idle_begin(w);
+            if (++rounds >= WS_STEAL_ROUNDS) {
+               sched_yield();
+               rounds = 0;
+            }
+         }
+      }
+      ws_idle_end(w);
+      __atomic_add_fetch(&s->finished, 1, __ATOMIC_RELEASE);
+   }
+}  /* ws_worker_main */
+
+/*-----------------------------------------------------------------*/
+/* Función:    ws_init
+ * Propósito:  Crear el planificador con worker_count workers, contando
+ *             al thread que llama a ws_run, que se fija como el worker 0
+ * En arg:     placement: dónde fijar cada worker, o NULL para no fijarlos
+ */
+static inline void ws_init(ws_sched_t* s, int worker_count,
+      const af_placement_t* placement) {
+   int i;
+
+   if (worker_count < 1) worker_count = 1;
+   s->worker_count = worker_count;
+   s->workers = NULL;
+   if (posix_memalign((void**) &s->workers, WS_CACHE_LINE,
+            worker_count*sizeof(ws_worker_t)) != 0) {
+      fprintf(stderr, "worksteal: la memoria falló\n");
+      exit(1);
+   }
+   pthread_mutex_init(&s->mutex, NULL);
+   pthread_cond_init(&s->cond, NULL);
+   s->generation = 0;
+   s->stop = 0;
+   s->active = 0;
+   s->finished = 0;
+   s->run_ns = 0;
+   for (i = 0; i < worker_count; i++) {
+      ws_worker_t* w = &s->workers[i];
+      w->top = w->bottom = 0;
+      w->array = ws_array_new(WS_INITIAL_SIZE);
+      w->sched = s;
+      w->placement = placement;
+      w->id = i;
+      w->seed = 0x9e3779b97f4a7c15ULL*(i + 1);
+      w->tasks = w->steals = w->failed_steals = 0;
+      w->idle_ns = w->idle_since = 0;
+   }
+   af_bind(placement, 0);
+   for (i = 1; i < worker_count; i++)
+      pthread_create(&s->workers[i].thread, NULL, ws_worker_main,
+            &s->workers[i]);
+}  /* ws_init */
+
+/*-----------------------------------------------------------------*/
+/* Función:    ws_run
+ * Propósito:  Ejecutar fn(arg) en el thread que llama, como worker 0,
+ *             mientras los demás roban las tareas que cree
+ */
+static inline void ws_run(ws_sched_t* s, ws_fn_t fn, void* arg) {
+   ws_worker_t* w0 = &s->workers[0];
+   long long start;
+   int i;
+
+   for (i = 0; i < s->worker_count; i++) {
+      s->workers[i].tasks = s->workers[i].steals = 0;
+      s->workers[i].failed_steals = 0;
+      s->workers[i].idle_ns = s->workers[i].idle_since = 0;
+   }
+   s->finished = 0;
+   ws_self = w0;
+   start = hr_now_ns();
+   __atomic_store_n(&s->active, 1, __ATOMIC_RELEASE);
+   pthread_mutex_lock(&s->mutex);
+   s->generation++;
+   pthread_cond_broadcast(&s->cond);
+   pthread_mutex_unlock(&s->mutex);
+
+   w0->tasks++;
+   fn(arg);
+
+   __atomic_store_n(&s->active, 0, __ATOMIC_RELEASE);
+   s->run_ns = hr_now_ns() - start;
+   while (__atomic_load_n(&s->finished, __ATOMIC_ACQUIRE)
+         < s->worker_count - 1)
+      sched_yield();
+}  /* ws_run */
+
+/*-----------------------------------------------------------------*/
+/* Imprimir una línea por worker y el total del último ws_run */
+static inline void ws_report(const ws_sched_t* s, FILE* fp) {
+   long tasks = 0, steals = 0, failed = 0;
+   double busy = 0.0, util;
+   int i;
+
+   fprintf(fp, "%-8s %12s %10s %14s %12s\n", "worker", "tareas", "robos",
+         "robos fallidos", "utilización");
+   for (i = 0; i < s->worker_count; i++) {
+      const ws_worker_t* w = &s->workers[i];
+      util = s->run_ns > 0 ? 1.0 - (double) w->idle_ns/s->run_ns : 0.0;
+      if (util < 0.0) util = 0.0;
+      fprintf(fp, "%-8d %12ld %10ld %14ld %11.1f%%\n", i, w->tasks,
+            w->steals, w->failed_steals, 100.0*util);
+      tasks += w->tasks;
+      steals += w->steals;
+      failed += w->failed_steals;
+      busy += util;
+   }
+   fprintf(fp, "%-8s %12ld %10ld %14ld %11.1f%%\n", "total", tasks, steals,
+         failed, 100.0*busy/s->worker_count);
+}  /* ws_report */
+
+/*-----------------------------------------------------------------*/
+static inline void ws_destroy(ws_sched_t* s) {
+   ws_array_t *a, *next;
+   int i;
+
+   pthread_mutex_lock(&s->mutex);
+   s->stop = 1;
+   pthread_cond_broadcast(&s->cond);
+   pthread_mutex_unlock(&s->mutex);
+   for (i = 1; i < s->worker_count; i++)
+      pthread_join(s->workers[i].thread, NULL);
+   for (i = 0; i < s->worker_count; i++)
+      for (a = s->workers[i].array; a != NULL; a = next) {
+         next = a->next;
+         free(a->buf);
+         free(a);
+      }
+   pthread_mutex_destroy(&s->mutex);
+   pthread_cond_destroy(&s->cond);
+   free(s->workers);
+}  /* ws_destroy */
+
+#endif